@@ -0,0 +1,45 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include "Typedef.hpp"
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Monotonic allocator for the nodes of an AST. Nodes are carved one after the other out of large
+// buffers, so a tree built in one pass lies close together in memory, and all of them are freed at
+// once when the arena is destroyed. Their destructors are never run, so the nodes keep their lists
+// in ast_vectors allocated in the arena too, and nothing else that would need freeing.
+class Arena
+{
+public:
+    Arena() = default;
+
+    Arena(const Arena&) = delete;
+
+    Arena& operator=(const Arena&) = delete;
+
+    template <typename T, typename... Args>
+    ast_ptr<T> create(Args&&... args)
+    {
+        void* memory = resource.allocate(sizeof(T), alignof(T));
+        return ast_ptr<T>{new (memory) T(std::forward<Args>(args)...)};
+    }
+
+    // The memory resource of the ast_vectors of the nodes.
+    std::pmr::memory_resource* memoryResource() { return &resource; }
+
+    // Keeps the nodes of `other` alive as long as this arena, to merge ASTs parsed separately.
+    void adopt(std::unique_ptr<Arena> other) { adopted.push_back(std::move(other)); }
+
+private:
+    // Size of the first buffer, the following ones grow geometrically.
+    static constexpr size_t INITIAL_SIZE = 64u * 1024u;
+
+    std::pmr::monotonic_buffer_resource resource{INITIAL_SIZE};
+    std::vector<std::unique_ptr<Arena>> adopted;
+};
+
+#endif // ARENA_HPP
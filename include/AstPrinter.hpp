@@ -1,32 +1,29 @@
 #ifndef ASTPRINTER_HPP
 #define ASTPRINTER_HPP
-#include "ExprNode.hpp"
-#include "Visitor.hpp"
+
+#include "FlatAst.hpp"
 #include <sstream>
+#include <string>
 
-class AstPrinter : public ExprVisitor<std::any>
+// Prints a flat AST as S-expressions, one top-level statement per line (--dump-ast).
+class AstPrinter
 {
+public:
+    std::string print(const FlatAst& ast);
+
 private:
-    void parenthesize(const std::string_view name, std::initializer_list<const Expr*> exprs);
     std::stringstream stream;
 
-public:
-    std::string print(const std::vector<unique_expr_ptr>& expressions);
-
-    std::any visit(const BinaryExpr& expr) override;
-    std::any visit(const UnaryExpr& expr) override;
-    std::any visit(const GroupingExpr& expr) override;
-    std::any visit(const LiteralExpr& expr) override;
-    std::any visit(const AssignExpr& expr) override;
-    std::any visit(const CallExpr& expr) override;
-    std::any visit(const SetExpr& expr) override;
-    std::any visit(const GetExpr& expr) override;
-    std::any visit(const SuperExpr& expr) override;
-    std::any visit(const LogicalExpr& expr) override;
-    std::any visit(const ThisExpr& expr) override;
-    std::any visit(const VarExpr& expr) override;
-    std::any visit(const ListExpr& expr) override;
-    std::any visit(const IncrementExpr& expr) override;
-    std::any visit(const DecrementExpr& expr) override;
+    void print(const FlatAst& ast, FlatAst::Index node);
+
+    // Prints the operand after a space, or `()` if it is NONE.
+    void printOperand(const FlatAst& ast, FlatAst::Index operand);
+
+    void parenthesize(const FlatAst& ast, std::string_view name,
+                      std::initializer_list<FlatAst::Index> operands);
+
+    void parenthesize(const FlatAst& ast, std::string_view name,
+                      std::span<const FlatAst::Index> operands);
 };
-#endif // ASTPRINTER_HPP
\ No newline at end of file
+
+#endif // ASTPRINTER_HPP
@@ -5,6 +5,7 @@
 #include "FunctionType.hpp"
 #include <chrono>
 #include <iostream>
+#include <span>
 #include <sstream>
 #include <string>
 
@@ -13,7 +14,7 @@ class ClockCallable : public Callable
 public:
     size_t getArity() const override;
 
-    std::any call(Interpreter& interpreter, const std::vector<std::any>& args) const override;
+    Value call(Interpreter& interpreter, std::span<const Value> args) const override;
 
     std::string toString() const override;
 
@@ -24,18 +25,26 @@ private:
 class PrintCallable : public Callable
 {
 public:
-    explicit PrintCallable(size_t arity = 0u) : arity{arity} {}
-
     size_t getArity() const override;
 
-    std::any call(Interpreter& interpreter, const std::vector<std::any>& args) const override;
+    bool isVariadic() const override;
 
-    std::string toString() const override;
+    Value call(Interpreter& interpreter, std::span<const Value> args) const override;
 
-private:
-    size_t arity;
+    std::string toString() const override;
 };
 
-std::string stringify(const std::any& item, std::stringstream& stream);
+// Implementations of the native functions, shared by the tree-walking interpreter and the VM.
+Value clockNative(std::span<const Value> args);
+
+Value printNative(std::span<const Value> args);
+
+// Writes the printed form of the value to the stream.
+void stringify(const Value& item, std::stringstream& stream);
+
+// Formats a number the way Lox prints it: in fixed notation, with the fewest decimals that read
+// back as the same number, or in the shortest such form beyond 2^53. Shared by printing and by
+// concatenating numbers to strings.
+std::string numberToString(double number);
 
 #endif // BUILT_IN_HPP
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef BYTECODE_FILE_HPP
+#define BYTECODE_FILE_HPP
+
+#include "Compiler.hpp"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Versioned binary format of a CompiledProgram, written by `main --compile` and to the bytecode
+// cache. The file holds no pointers: functions, strings and globals are numbered tables that refer
+// to each other by index, and the code and line tables of every function are stored as is, so
+// loading a file copies them out in bulk, creates an object for every function and interns the
+// string constants. Numbers are stored in the byte order of the machine writing the file, which is
+// checked when loading it.
+namespace BytecodeFile
+{
+    // Thrown when loading a file that isn't bytecode, was written by another version of the format,
+    // is truncated or holds code that fails verification.
+    struct FormatError : public std::runtime_error
+    {
+        using std::runtime_error::runtime_error;
+    };
+
+    // Bumped on every change of the format or the instruction set.
+    constexpr uint32_t VERSION = 2u;
+
+    // Whether the contents start like a bytecode file, of any version.
+    bool isBytecode(std::string_view contents) noexcept;
+
+    // `source_hash` identifies the source the program was compiled from, see hashSource.
+    std::string write(const CompiledProgram& program, uint64_t source_hash = 0u);
+
+    // The program refers to nothing in the contents, so they may be unmapped once it is loaded.
+    // Every function is checked by the BytecodeVerifier, since the VM runs the code as is. Throws
+    // a FormatError if the contents aren't a bytecode file of this version.
+    CompiledProgram read(std::string_view contents);
+
+    // The source hash written to the file, without loading the program.
+    uint64_t sourceHash(std::string_view contents);
+
+    // 64-bit FNV-1a hash of a script, keying the bytecode cache.
+    uint64_t hashSource(std::string_view source) noexcept;
+}
+
+#endif // BYTECODE_FILE_HPP
@@ -0,0 +1,29 @@
+#ifndef BYTECODE_VERIFIER_HPP
+#define BYTECODE_VERIFIER_HPP
+
+#include "ClosureType.hpp"
+#include <cstddef>
+#include <stdexcept>
+
+// Static checks of bytecode. The VM trusts its input and checks no operand while running, so a
+// function loaded from a file has to be unable to read or write outside of its stack frame,
+// constants, globals and upvalues, and to jump anywhere but to the start of one of its
+// instructions. The Compiler runs its own functions through the same analysis for the size of
+// their stack frames.
+namespace BytecodeVerifier
+{
+    struct VerifyError : public std::runtime_error
+    {
+        using std::runtime_error::runtime_error;
+    };
+
+    // Decodes every instruction of the function and follows every path through its code, tracking
+    // the height of its stack frame. Every instruction has to be reached with the same height on
+    // every path, never pop below the called closure and only address slots below the top of the
+    // frame. `global_count` is the number of globals of the program. Returns the most values the
+    // frame holds at once, including the called closure. Throws a VerifyError naming the function
+    // and the offset of the first invalid instruction.
+    size_t verify(const CompiledFunction& function, size_t global_count);
+}
+
+#endif // BYTECODE_VERIFIER_HPP
@@ -0,0 +1,93 @@
+#ifndef CALL_STACK_HPP
+#define CALL_STACK_HPP
+
+#include "ClosureType.hpp"
+#include "Heap.hpp"
+#include "Value.hpp"
+#include <cassert>
+#include <span>
+#include <vector>
+
+// Local variables of the running functions, laid out in one contiguous buffer with a frame per
+// call. The Resolver assigns every local a slot relative to the start of its function's frame, so
+// calls and blocks need no allocation once the buffer has grown to the deepest call. Values are
+// addressed by position because growing the buffer moves them, the open upvalues pointing into the
+// buffer are moved along.
+class CallStack
+{
+public:
+    // Upvalues are allocated on `heap`.
+    explicit CallStack(Heap& heap) : heap{heap} {}
+
+    // Slot of the current frame.
+    Value& local(size_t slot)
+    {
+        assert(frame_base + slot < frame_top);
+        return values[frame_base + slot];
+    }
+
+    // End of the values in use.
+    size_t top() const { return frame_top; }
+
+    // Pushes a value above the current frame, e.g. an argument of a call being set up or a
+    // temporary that has to survive a garbage collection.
+    void push(Value value)
+    {
+        if (frame_top == values.size())
+        {
+            grow(frame_top + 1u);
+        }
+        values[frame_top++] = std::move(value);
+    }
+
+    // The `count` topmost values.
+    std::span<const Value> topValues(size_t count) const
+    {
+        assert(count <= frame_top);
+        return {values.data() + frame_top - count, count};
+    }
+
+    // Releases the values above `top`.
+    void popTo(size_t top);
+
+    // Makes the current frame at least `size` slots large. Calls get their frame on entering, this
+    // is for the scopes of top-level code, which runs in the bottom frame.
+    void extendFrame(size_t size);
+
+    // Starts a frame of `size` slots whose first slots are the `arg_count` topmost values, i.e. the
+    // arguments of the call. Returns the start of the caller's frame for leaveFrame().
+    size_t enterFrame(size_t arg_count, size_t size);
+
+    // Returns to the caller's frame. The callee's values are released by popping the arguments.
+    void leaveFrame(size_t caller_base) { frame_base = caller_base; }
+
+    // Returns an upvalue for a slot of the current frame. Closures capturing the same variable
+    // share its upvalue.
+    Value captureUpvalue(size_t slot)
+    {
+        return open_upvalues.capture(heap, &values[frame_base + slot]);
+    }
+
+    // Closes the upvalues of the current frame's slots starting at `slot`, the captured variables
+    // then live on in the upvalues.
+    void closeUpvalues(size_t slot) { closeUpvaluesFrom(frame_base + slot); }
+
+    // Marks the values in use and the open upvalues, which are roots for the garbage collector.
+    void mark(Heap& heap) const;
+
+private:
+    Heap& heap;
+    std::vector<Value> values;
+    size_t frame_base = 0u;
+    size_t frame_top = 0u;
+    OpenUpvalues open_upvalues;
+
+    void grow(size_t size) { open_upvalues.reserve(values, size); }
+
+    void closeUpvaluesFrom(size_t position)
+    {
+        open_upvalues.close(heap, values.data() + position);
+    }
+};
+
+#endif // CALL_STACK_HPP
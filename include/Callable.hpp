@@ -1,18 +1,24 @@
 #ifndef CALLABLE_HPP
 #define CALLABLE_HPP
 
-#include <any>
+#include "Object.hpp"
+#include "Value.hpp"
+#include <span>
 #include <string>
-#include <vector>
 
 class Interpreter;
 
-class Callable
+class Callable : public Object
 {
 public:
+    Callable() noexcept : Object{ObjectType::CALLABLE} {}
+
     virtual size_t getArity() const = 0;
 
-    virtual std::any call(Interpreter& interpreter, const std::vector<std::any>& args) const = 0;
+    // Variadic callables accept any number of arguments, so their arity is not checked.
+    virtual bool isVariadic() const { return false; }
+
+    virtual Value call(Interpreter& interpreter, std::span<const Value> args) const = 0;
 
     virtual std::string toString() const = 0;
 
@@ -0,0 +1,74 @@
+#ifndef CHUNK_HPP
+#define CHUNK_HPP
+
+#include "Value.hpp"
+#include <cstdint>
+#include <vector>
+
+// Instruction set of the bytecode VM. Operands follow the opcode in the instruction stream:
+// constant and global indices and jump offsets are 16-bit big endian, local and upvalue slots and
+// counts are a single byte. CONSTANT_LONG takes a 24-bit big endian index, for the literals of
+// chunks with more constants than a 16-bit index can address.
+enum class OpCode : uint8_t
+{
+    CONSTANT,      // [constant]      push constants[constant]
+    CONSTANT_LONG, // [constant]      push constants[constant]
+    NIL,           //                 push nil
+    _TRUE,         //                 push true
+    _FALSE,        //                 push false
+    POP,           //                 pop the top of the stack
+    GET_LOCAL,     // [slot]          push the local in slot
+    SET_LOCAL,     // [slot]          store the top of the stack in the local slot
+    GET_GLOBAL,    // [global]        push the global, error if it is undefined
+    DEFINE_GLOBAL, // [global]        pop the top of the stack into a new global
+    SET_GLOBAL,    // [global]        store the top of the stack in the global, error if undefined
+    GET_UPVALUE,   // [slot]          push the captured variable
+    SET_UPVALUE,   // [slot]          store the top of the stack in the captured variable
+    GET_SUBSCRIPT, // [name]          list, index -> list[index]
+    SET_SUBSCRIPT, // [name]          list, index, value -> value, after list[index] = value
+    EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    NOT,
+    NEGATE,
+    INCREMENT,     // [name]          add one to the number on top of the stack
+    DECREMENT,     // [name]          subtract one from the number on top of the stack
+    LIST,          // [count]         pop count values into a new list
+    JUMP,          // [offset]        jump forward
+    JUMP_IF_FALSE, // [offset]        jump forward if the top of the stack is falsy, without popping
+    LOOP,          // [offset]        jump backward
+    CALL,          // [count]         call the callee below count arguments
+    CLOSURE,       // [constant] ...  wrap a function in a closure, followed by an (is_local, slot)
+                   //                 byte pair for every captured variable
+    CLOSE_UPVALUE, //                 move the captured top of the stack to the heap and pop it
+    RETURN         //                 return the top of the stack from the current function
+};
+
+// A sequence of bytecode with the constants it refers to and the source line of every byte.
+struct Chunk
+{
+    std::vector<uint8_t> code;
+    std::vector<unsigned int> lines;
+    std::vector<Value> constants;
+
+    void write(uint8_t byte, unsigned int line)
+    {
+        code.push_back(byte);
+        lines.push_back(line);
+    }
+
+    // Returns the index of the added constant.
+    size_t addConstant(Value value)
+    {
+        constants.push_back(std::move(value));
+        return constants.size() - 1u;
+    }
+};
+
+#endif // CHUNK_HPP
@@ -0,0 +1,67 @@
+#ifndef CLOSURE_COMPILER_HPP
+#define CLOSURE_COMPILER_HPP
+
+#include "ExecNode.hpp"
+#include "ExprNode.hpp"
+#include "StmtNode.hpp"
+#include "Visitor.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Compiles a resolved AST into a tree of executable nodes ("closure compilation"). Operators,
+// operand shapes and variable slots are decided once here, the resulting nodes only do the work
+// that is left at runtime. The program behaves exactly like it does on the Interpreter.
+class ClosureCompiler : public ExprVisitor<Value>, public StmtVisitor
+{
+public:
+    NodeProgram compile(const ast_vector<unique_stmt_ptr>& statements);
+
+    Value visit(const BinaryExpr& expr) override;
+    Value visit(const UnaryExpr& expr) override;
+    Value visit(const GroupingExpr& expr) override;
+    Value visit(const LiteralExpr& expr) override;
+    Value visit(const AssignExpr& expr) override;
+    Value visit(const CallExpr& expr) override;
+    Value visit(const SetExpr& expr) override;
+    Value visit(const GetExpr& expr) override;
+    Value visit(const SuperExpr& expr) override;
+    Value visit(const LogicalExpr& expr) override;
+    Value visit(const ThisExpr& expr) override;
+    Value visit(const VarExpr& expr) override;
+    Value visit(const ListExpr& expr) override;
+    Value visit(const SubscriptExpr& expr) override;
+    Value visit(const IncrementExpr& expr) override;
+    Value visit(const DecrementExpr& expr) override;
+
+    void visit(const BlockStmt& stmt) override;
+    void visit(const ClassStmt& stmt) override;
+    void visit(const ExprStmt& stmt) override;
+    void visit(const FnStmt& stmt) override;
+    void visit(const IfStmt& stmt) override;
+    void visit(const PrintStmt& stmt) override;
+    void visit(const ReturnStmt& stmt) override;
+    void visit(const BreakStmt& stmt) override;
+    void visit(const ContinueStmt& stmt) override;
+    void visit(const VarStmt& stmt) override;
+    void visit(const WhileStmt& stmt) override;
+    void visit(const ForStmt& stmt) override;
+
+private:
+    // The visit methods leave the node they built here.
+    compiled_expr_ptr expr_node;
+    compiled_stmt_ptr stmt_node;
+
+    std::unordered_map<std::string_view, size_t> global_indices;
+    std::vector<std::string> globals;
+
+    compiled_expr_ptr compile(const Expr& expr);
+
+    compiled_stmt_ptr compile(const Stmt& stmt);
+
+    std::vector<compiled_stmt_ptr> compileAll(const ast_vector<unique_stmt_ptr>& statements);
+
+    size_t globalIndex(const Token& identifier);
+};
+
+#endif // CLOSURE_COMPILER_HPP
@@ -0,0 +1,102 @@
+#ifndef CLOSURE_TYPE_HPP
+#define CLOSURE_TYPE_HPP
+
+#include "Chunk.hpp"
+#include "Object.hpp"
+#include "Value.hpp"
+#include <span>
+#include <string>
+#include <vector>
+
+// Runtime objects of the bytecode VM.
+
+// A function compiled to bytecode. Every function declaration produces one at compile time, owned
+// by the compiled program; calling it requires wrapping it in a Closure at runtime.
+struct CompiledFunction : public Object
+{
+    CompiledFunction(std::string name, size_t arity);
+
+    std::string toString() const;
+
+    const std::string name;
+    const size_t arity;
+    size_t upvalue_count = 0u;
+    // Most values the function's call frame holds at once, including the called closure, so the VM
+    // can make room for the frame when calling it.
+    size_t max_stack_height = 0u;
+    Chunk chunk;
+};
+
+// A variable captured by a closure. While the variable is still on the stack the upvalue is "open"
+// and points into the stack. When the variable goes out of scope the value is moved into the
+// upvalue itself, and the upvalue is "closed". Shared by the VM and the AST engines.
+struct Upvalue : public Object
+{
+    explicit Upvalue(Value* location);
+
+    void trace(Heap& heap) const override;
+
+    Value* location;
+    Value closed;
+    // Next open upvalue, ordered by descending stack location.
+    Value next;
+};
+
+// The upvalues still pointing into a stack of values, ordered by descending location. Both the VM
+// and the CallStack of the AST engines address their values by pointer, and keep the upvalues
+// of their stack in one of these.
+class OpenUpvalues
+{
+public:
+    // Returns an upvalue for `local`, allocated on `heap`. Closures capturing the same variable
+    // share its upvalue.
+    Value capture(Heap& heap, Value* local);
+
+    // Closes the upvalues at or above `last`, the captured variables then live on in the
+    // upvalues.
+    void close(Heap& heap, const Value* last);
+
+    // Every open upvalue is a root of its own, since capturing links old upvalues to new ones
+    // without a write barrier.
+    void mark(Heap& heap) const;
+
+    // Forgets the open upvalues, once their stack has been abandoned.
+    void clear() noexcept { head = Value{}; }
+
+    // Makes `stack` at least `size` values large, moving the open upvalues along if it has to be
+    // reallocated. Returns the previous start of the stack, so the caller can move its own
+    // pointers into it.
+    const Value* reserve(std::vector<Value>& stack, size_t size);
+
+private:
+    Value head;
+};
+
+// A compiled function together with the variables it captured.
+struct Closure : public Object
+{
+    explicit Closure(CompiledFunction* function);
+
+    CompiledFunction* getFunction() const noexcept { return function.as<CompiledFunction>(); }
+
+    void trace(Heap& heap) const override;
+
+    const Value function;
+    std::vector<Value> upvalues;
+};
+
+using NativeFn = Value (*)(std::span<const Value> args);
+
+// A built-in function implemented in C++, used by the VM and the closure-compiling engine.
+struct NativeFunction : public Object
+{
+    NativeFunction(std::string name, size_t arity, bool is_variadic, NativeFn function);
+
+    // Printed representation of the function.
+    const std::string name;
+    const size_t arity;
+    const bool is_variadic;
+    const NativeFn function;
+};
+
+#endif // CLOSURE_TYPE_HPP
@@ -0,0 +1,189 @@
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+
+#include "Chunk.hpp"
+#include "ClosureType.hpp"
+#include "ExprNode.hpp"
+#include "StmtNode.hpp"
+#include "Visitor.hpp"
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Output of the Compiler, executed by the VM.
+struct CompiledProgram
+{
+    // The CompiledFunction holding the top-level code.
+    Value script;
+    // Names of the globals, indexed by the operands of the global opcodes.
+    std::vector<std::string> globals;
+    // The functions created by the Compiler. String literals and name constants are interned in
+    // the StringTable.
+    std::vector<std::unique_ptr<Object>> objects;
+};
+
+// Compiles a resolved AST to bytecode for the VM. Local variables live in stack slots of their
+// function's call frame, and variables captured by closures are accessed through upvalues.
+// Globals are numbered at compile time, so the VM never looks them up by name.
+class Compiler : public ExprVisitor<Value>, public StmtVisitor
+{
+public:
+    Compiler() = default;
+
+    // Returns nullopt if the program exceeds one of the limits of the bytecode format. The errors
+    // are reported to the Error logger.
+    std::optional<CompiledProgram> compile(const ast_vector<unique_stmt_ptr>& statements);
+
+    Value visit(const BinaryExpr& expr) override;
+    Value visit(const UnaryExpr& expr) override;
+    Value visit(const GroupingExpr& expr) override;
+    Value visit(const LiteralExpr& expr) override;
+    Value visit(const AssignExpr& expr) override;
+    Value visit(const CallExpr& expr) override;
+    Value visit(const SetExpr& expr) override;
+    Value visit(const GetExpr& expr) override;
+    Value visit(const SuperExpr& expr) override;
+    Value visit(const LogicalExpr& expr) override;
+    Value visit(const ThisExpr& expr) override;
+    Value visit(const VarExpr& expr) override;
+    Value visit(const ListExpr& expr) override;
+    Value visit(const SubscriptExpr& expr) override;
+    Value visit(const IncrementExpr& expr) override;
+    Value visit(const DecrementExpr& expr) override;
+
+    void visit(const BlockStmt& stmt) override;
+    void visit(const ClassStmt& stmt) override;
+    void visit(const ExprStmt& stmt) override;
+    void visit(const FnStmt& stmt) override;
+    void visit(const IfStmt& stmt) override;
+    void visit(const PrintStmt& stmt) override;
+    void visit(const ReturnStmt& stmt) override;
+    void visit(const BreakStmt& stmt) override;
+    void visit(const ContinueStmt& stmt) override;
+    void visit(const VarStmt& stmt) override;
+    void visit(const WhileStmt& stmt) override;
+    void visit(const ForStmt& stmt) override;
+
+private:
+    struct Local
+    {
+        std::string_view name;
+        size_t depth;
+        // Whether a closure captures the local, in which case it has to be moved to the heap when
+        // it goes out of scope.
+        bool is_captured = false;
+    };
+
+    struct UpvalueRef
+    {
+        // Slot of the captured variable, either in the enclosing function's locals or upvalues.
+        uint8_t index;
+        bool is_local;
+    };
+
+    struct Loop
+    {
+        // Scope depth outside of the loop body. Locals deeper than this are discarded when jumping
+        // out of the body.
+        size_t scope_depth;
+        std::vector<size_t> break_jumps;
+        std::vector<size_t> continue_jumps;
+    };
+
+    // Compilation state of the function being compiled.
+    struct FunctionState
+    {
+        FunctionState* enclosing;
+        Value function;
+        std::vector<Local> locals;
+        std::vector<UpvalueRef> upvalues;
+        std::vector<Loop> loops;
+        size_t scope_depth = 0u;
+        // Indices of the number and string constants, so a literal or name used repeatedly takes
+        // a single constant. Numbers are keyed by their bits and strings, which are interned, by
+        // address.
+        std::unordered_map<uint64_t, size_t> number_constants;
+        std::unordered_map<const Object*, size_t> string_constants;
+        bool has_too_many_constants = false;
+    };
+
+    FunctionState* current = nullptr;
+    std::unordered_map<std::string_view, uint16_t> global_indices;
+    std::vector<std::string> globals;
+    std::vector<std::unique_ptr<Object>> objects;
+    // Source line of the code being emitted.
+    unsigned int line = 1u;
+    bool had_error = false;
+
+    void compile(const Stmt& stmt);
+
+    void compile(const Expr& expr);
+
+    void compileFunction(const FnStmt& stmt);
+
+    // Sets the size of the call frame of a function whose code is complete.
+    void sizeFrame(CompiledFunction& function) const;
+
+    // Creates an object owned by the compiled program.
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        auto object = std::make_unique<T>(std::forward<Args>(args)...);
+        T* created = object.get();
+        objects.push_back(std::move(object));
+        return created;
+    }
+
+    Chunk& currentChunk() const noexcept;
+
+    void emitByte(uint8_t byte);
+
+    void emitOp(OpCode op);
+
+    void emitShort(uint16_t value);
+
+    void emitConstant(Value value);
+
+    size_t emitJump(OpCode op);
+
+    void patchJump(size_t offset);
+
+    void emitLoop(size_t loop_start);
+
+    // Index of the value in the constants of the current chunk, added unless it is already there.
+    size_t addConstant(Value value);
+
+    // Index of a constant referred to by a 16-bit operand.
+    uint16_t makeConstant(Value value);
+
+    uint16_t nameConstant(const Token& identifier);
+
+    // Reports that the current chunk has too many constants, once per chunk.
+    void tooManyConstants();
+
+    uint16_t globalIndex(const Token& identifier);
+
+    void beginScope();
+
+    void endScope();
+
+    void discardLocals(size_t depth);
+
+    void addLocal(const Token& identifier);
+
+    std::optional<uint8_t> resolveLocal(const FunctionState& state, std::string_view name) const;
+
+    std::optional<uint8_t> resolveUpvalue(FunctionState& state, std::string_view name);
+
+    uint8_t addUpvalue(FunctionState& state, uint8_t index, bool is_local);
+
+    void emitGetVariable(const Token& identifier);
+
+    void emitSetVariable(const Token& identifier);
+
+    void error(const std::string& message);
+};
+
+#endif // COMPILER_HPP
@@ -0,0 +1,100 @@
+#ifndef EXEC_NODE_HPP
+#define EXEC_NODE_HPP
+
+#include "CallStack.hpp"
+#include "ExecStatus.hpp"
+#include "Heap.hpp"
+#include "Object.hpp"
+#include "StmtNode.hpp"
+#include "Value.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Executable nodes of the closure-compiling engine. The ClosureCompiler turns every AST node into
+// a node specialized for its operator and the shape of its operands, so running the program needs
+// no visitor double dispatch and never re-inspects operators or variable slots.
+
+// Runtime state shared by all nodes of a running program.
+struct ExecContext
+{
+    ExecContext();
+
+    struct Global
+    {
+        Value value;
+        bool is_defined = false;
+    };
+
+    // Owner of the objects created by the program. Temporaries that have to survive the evaluation
+    // of another node are pushed onto the call stack, so the garbage collector sees them.
+    Heap heap;
+    // Globals, numbered at compile time.
+    std::vector<Global> globals;
+    // Frames of the running functions, holding their locals.
+    CallStack call_stack;
+    // Upvalues of the running function, nullptr in top-level code.
+    const std::vector<Value>* upvalues = nullptr;
+    // Value of the return statement being executed.
+    Value return_value;
+
+    void markRoots(Heap& heap) const;
+};
+
+class CompiledExpr
+{
+public:
+    virtual ~CompiledExpr() = default;
+
+    virtual Value eval(ExecContext& context) const = 0;
+};
+
+class CompiledStmt
+{
+public:
+    virtual ~CompiledStmt() = default;
+
+    virtual ExecStatus exec(ExecContext& context) const = 0;
+};
+
+using compiled_expr_ptr = std::unique_ptr<CompiledExpr>;
+using compiled_stmt_ptr = std::unique_ptr<CompiledStmt>;
+
+// A compiled function declaration.
+struct FunctionNode
+{
+    std::string name;
+    size_t arity;
+    // Storage of the function's scope, parameters come first in the call frame.
+    ScopeLayout layout;
+    // Where the variables the function captures are found when it is declared.
+    std::vector<UpvalueSlot> upvalues;
+    std::vector<compiled_stmt_ptr> body;
+};
+
+// A function of the closure-compiling engine, together with the variables it captured.
+struct NodeFunction : public Object
+{
+    NodeFunction(const FunctionNode* declaration, std::vector<Value> upvalues);
+
+    std::string toString() const;
+
+    void trace(Heap& heap) const override;
+
+    const FunctionNode* const declaration;
+    const std::vector<Value> upvalues;
+};
+
+// Output of the ClosureCompiler.
+struct NodeProgram
+{
+    std::vector<compiled_stmt_ptr> statements;
+    // Names of the globals, indexed like ExecContext::globals.
+    std::vector<std::string> globals;
+
+    // Runs the program, runtime errors are reported to the Error logger. Returns the statistics of
+    // the program's heap.
+    Heap::Statistics run() const;
+};
+
+#endif // EXEC_NODE_HPP
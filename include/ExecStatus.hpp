@@ -0,0 +1,15 @@
+#ifndef EXEC_STATUS_HPP
+#define EXEC_STATUS_HPP
+
+#include <cstdint>
+
+// How a statement finished. Loops consume BREAK and CONTINUE, function calls consume RETURN.
+enum class ExecStatus : uint8_t
+{
+    NORMAL,
+    BREAK,
+    CONTINUE,
+    RETURN
+};
+
+#endif // EXEC_STATUS_HPP
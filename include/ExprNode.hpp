@@ -4,16 +4,40 @@
 #include "Token.hpp"
 #include "Typedef.hpp"
 #include "Visitor.hpp"
+#include <cstdint>
 #include <vector>
 
+class String;
+
+// Runtime location of a variable, filled in by the Resolver. Variables that are not found in any
+// local scope are looked up as globals by their interned name. Locals live in a slot of their
+// function's call frame, functions nested in the declaring one reach them through one of their
+// upvalues.
+struct VariableSlot
+{
+    enum class Storage : uint8_t
+    {
+        GLOBAL,
+        FRAME,
+        UPVALUE
+    };
+
+    Storage storage = Storage::GLOBAL;
+    // Slot in the call frame or index of the upvalue.
+    size_t index = 0u;
+    // Name of a global, interned in the StringTable.
+    const String* name = nullptr;
+};
+
 struct AssignExpr : Expr
 {
     Token identifier;
     unique_expr_ptr value;
+    mutable VariableSlot slot; // Set by the Resolver.
 
     AssignExpr(Token identifier, unique_expr_ptr value);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct BinaryExpr : Expr
@@ -24,7 +48,7 @@ struct BinaryExpr : Expr
 
     BinaryExpr(unique_expr_ptr left, Token op, unique_expr_ptr right);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct UnaryExpr : Expr
@@ -34,7 +58,7 @@ struct UnaryExpr : Expr
 
     UnaryExpr(Token op, unique_expr_ptr right);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct IncrementExpr : Expr
@@ -47,10 +71,11 @@ struct IncrementExpr : Expr
 
     Token identifier;
     Type type;
+    mutable VariableSlot slot; // Set by the Resolver.
 
     IncrementExpr(Token identifier, Type type);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct DecrementExpr : Expr
@@ -63,21 +88,22 @@ struct DecrementExpr : Expr
 
     Token identifier;
     Type type;
+    mutable VariableSlot slot; // Set by the Resolver.
 
     DecrementExpr(Token identifier, Type type);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct CallExpr : Expr
 {
     unique_expr_ptr callee;
     Token paren;
-    std::vector<unique_expr_ptr> args;
+    ast_vector<unique_expr_ptr> args;
 
-    CallExpr(unique_expr_ptr callee, Token paren, std::vector<unique_expr_ptr> args);
+    CallExpr(unique_expr_ptr callee, Token paren, ast_vector<unique_expr_ptr> args);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct GetExpr : Expr
@@ -87,7 +113,7 @@ struct GetExpr : Expr
 
     GetExpr(unique_expr_ptr object, Token identifier);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct SetExpr : Expr
@@ -98,7 +124,7 @@ struct SetExpr : Expr
 
     SetExpr(unique_expr_ptr object, Token identifier, unique_expr_ptr value);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct GroupingExpr : Expr
@@ -107,16 +133,19 @@ struct GroupingExpr : Expr
 
     explicit GroupingExpr(unique_expr_ptr expression);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct LiteralExpr : Expr
 {
-    std::any literal;
+    // String literals are interned in the StringTable.
+    Value literal;
+    // Position of the literal in the source.
+    unsigned int offset;
 
-    explicit LiteralExpr(std::any literal);
+    LiteralExpr(Value literal, unsigned int offset);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct LogicalExpr : Expr
@@ -127,7 +156,7 @@ struct LogicalExpr : Expr
 
     LogicalExpr(unique_expr_ptr left, Token op, unique_expr_ptr right);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct SuperExpr : Expr
@@ -137,7 +166,7 @@ struct SuperExpr : Expr
 
     SuperExpr(Token keyword, Token method);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct ThisExpr : Expr
@@ -146,26 +175,27 @@ struct ThisExpr : Expr
 
     explicit ThisExpr(Token keyword);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct VarExpr : Expr
 {
     Token identifier;
+    mutable VariableSlot slot; // Set by the Resolver.
 
     explicit VarExpr(Token identifier);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct ListExpr : Expr
 {
     Token opening_bracket;
-    std::vector<unique_expr_ptr> items;
+    ast_vector<unique_expr_ptr> items;
 
-    ListExpr(Token opening_bracket, std::vector<unique_expr_ptr> items);
+    ListExpr(Token opening_bracket, ast_vector<unique_expr_ptr> items);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 struct SubscriptExpr : Expr
@@ -173,10 +203,11 @@ struct SubscriptExpr : Expr
     Token identifier;
     unique_expr_ptr index;
     unique_expr_ptr value;
+    mutable VariableSlot slot; // Set by the Resolver.
 
     SubscriptExpr(Token identifier, unique_expr_ptr index, unique_expr_ptr value);
 
-    std::any accept(ExprVisitor<std::any>& visitor) const override;
+    Value accept(ExprVisitor<Value>& visitor) const override;
 };
 
 #endif // EXPR_HPP
\ No newline at end of file
@@ -0,0 +1,189 @@
+#ifndef FLAT_AST_HPP
+#define FLAT_AST_HPP
+
+#include "ExprNode.hpp"
+#include "StmtNode.hpp"
+#include "Token.hpp"
+#include "Typedef.hpp"
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Compact alternative to the tree of Expr and Stmt nodes. The nodes are rows of a few parallel
+// tables (structure of arrays), children are referenced by 32-bit indices and tokens by their
+// offset in the source, so a node takes 13 bytes instead of a heap object with its own tokens.
+// Nodes are stored in pre-order, a node before its children, so walking the table visits the code
+// in the order it was written.
+//
+// Every node has a kind, the offset of its main token (0 for nodes without one) and two operands,
+// `lhs` and `rhs`. An operand is either a child node, NONE or the start of a list in the extra
+// table, laid out as its length followed by its items:
+//
+//   kind         token        lhs                         rhs
+//   ASSIGN       identifier   value
+//   BINARY       operator     left operand                right operand
+//   LOGICAL      operator     left operand                right operand
+//   UNARY        operator     operand
+//   GROUPING                  expression
+//   CALL         )            callee                      list of arguments
+//   NUMBER, STRING, TRUE, FALSE, NIL
+//                literal
+//   VARIABLE     identifier
+//   LIST         [                                        list of items
+//   SUBSCRIPT    identifier   index                       assigned value or NONE
+//   PREFIX_INCREMENT, POSTFIX_INCREMENT, PREFIX_DECREMENT, POSTFIX_DECREMENT
+//                identifier
+//   BLOCK                     list of statements
+//   EXPRESSION                expression
+//   FUNCTION     name         list of parameter offsets   list of statements
+//   IF                        list of the condition and   else branch or NONE
+//                             statement of every branch
+//   PRINT                     call of print
+//   RETURN       return       value or NONE
+//   BREAK        break
+//   CONTINUE     continue
+//   VAR          identifier   initializer or NONE
+//   WHILE                     condition                   body
+//   FOR                       start of the initializer,   body
+//                             condition and increment in
+//                             the extra table, each NONE
+//                             if omitted
+class FlatAst
+{
+public:
+    using Index = uint32_t;
+
+    static constexpr Index NONE = std::numeric_limits<Index>::max();
+
+    enum class Kind : uint8_t
+    {
+        // Expressions.
+        ASSIGN,
+        BINARY,
+        LOGICAL,
+        UNARY,
+        GROUPING,
+        CALL,
+        NUMBER,
+        STRING,
+        TRUE,
+        FALSE,
+        NIL,
+        VARIABLE,
+        LIST,
+        SUBSCRIPT,
+        PREFIX_INCREMENT,
+        POSTFIX_INCREMENT,
+        PREFIX_DECREMENT,
+        POSTFIX_DECREMENT,
+        // Statements.
+        BLOCK,
+        EXPRESSION,
+        FUNCTION,
+        IF,
+        PRINT,
+        RETURN,
+        BREAK,
+        CONTINUE,
+        VAR,
+        WHILE,
+        FOR
+    };
+
+    // Functions' variable capture, set by the Resolver.
+    struct FunctionInfo
+    {
+        ast_vector<UpvalueSlot> upvalues;
+        bool creates_closures = false;
+    };
+
+    // Starts an empty flat AST of `source`, to append the top-level statements to as they are
+    // parsed. The flat AST refers to the source, which has to outlive it.
+    explicit FlatAst(std::string_view source);
+
+    // Flattens the tree parsed from `source`.
+    FlatAst(std::string_view source, const ast_vector<unique_stmt_ptr>& statements);
+
+    // Flattens top-level statements after the ones appended before, so the tree of each can be
+    // released before the next is parsed. finish() has to be called after the last ones.
+    void append(const ast_vector<unique_stmt_ptr>& statements);
+
+    // Lists the top-level statements appended and trims the tables to their size.
+    void finish();
+
+    // The top-level statements.
+    std::span<const Index> statements() const { return list(root); }
+
+    size_t size() const { return kinds.size(); }
+
+    Kind kind(Index node) const { return kinds[node]; }
+
+    uint32_t offset(Index node) const { return offsets[node]; }
+
+    Index lhs(Index node) const { return lhs_operands[node]; }
+
+    Index rhs(Index node) const { return rhs_operands[node]; }
+
+    // The list starting at `start` in the extra table.
+    std::span<const Index> list(Index start) const
+    {
+        return {extra.data() + start + 1u, extra[start]};
+    }
+
+    // The `count` items starting at `start` in the extra table, for the clauses of a for loop.
+    std::span<const Index> items(Index start, size_t count) const
+    {
+        return {extra.data() + start, count};
+    }
+
+    // Lexeme of the node's main token, without the quotes of a string.
+    std::string_view lexeme(Index node) const { return lexemeAt(offsets[node]); }
+
+    // Lexeme of the token at `offset` in the source.
+    std::string_view lexemeAt(uint32_t offset) const;
+
+    // The node's main token, for error messages.
+    Token token(Index node) const;
+
+    Token tokenAt(uint32_t offset) const;
+
+    unsigned int lineAt(uint32_t offset) const;
+
+    // Memory taken by the tables, not counting the source or what the Resolver stores.
+    size_t memoryUsage() const;
+
+    // The layout of the scope of a block, for loop or function.
+    const ScopeLayout& layout(Index node) const;
+
+    const FunctionInfo& function(Index node) const;
+
+    // Set by the Resolver: where variables are stored, indexed by node, then the layouts of scopes
+    // and the captures of functions, sorted by node. The Resolver appends the entry of a node when
+    // it enters it, which keeps them sorted since the nodes are stored in pre-order.
+    mutable std::vector<VariableSlot> slots;
+    mutable std::deque<std::pair<Index, ScopeLayout>> layouts;
+    mutable std::deque<std::pair<Index, FunctionInfo>> functions;
+
+private:
+    class Builder;
+
+    std::string_view source;
+    // Offset of the start of every line, for the line numbers of error messages.
+    std::vector<uint32_t> line_starts;
+
+    std::vector<Kind> kinds;
+    std::vector<uint32_t> offsets;
+    std::vector<Index> lhs_operands;
+    std::vector<Index> rhs_operands;
+    std::vector<Index> extra;
+    // The top-level statements appended until finish() lists them in the extra table.
+    std::vector<Index> top_level;
+    // Start of the list of top-level statements in the extra table.
+    Index root = 0u;
+};
+
+#endif // FLAT_AST_HPP
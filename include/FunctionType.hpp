@@ -3,25 +3,27 @@
 
 #include "Callable.hpp"
 #include "Interpreter.hpp"
-#include <memory>
+#include <vector>
 
 struct FnStmt;
 
 class FunctionType : public Callable
 {
 public:
-    FunctionType(const FnStmt* declaration, std::shared_ptr<Environment> closure);
+    FunctionType(const FnStmt* declaration, std::vector<Value> upvalues);
 
     size_t getArity() const override;
 
-    std::any call(Interpreter& interpreter, const std::vector<std::any>& args) const override;
+    Value call(Interpreter& interpreter, std::span<const Value> args) const override;
 
     std::string toString() const override;
 
+    void trace(Heap& heap) const override;
+
 private:
-    size_t arity = 0u;
     const FnStmt* declaration;
-    std::shared_ptr<Environment> closure;
+    // The variables the function captured, see FnStmt::upvalues.
+    std::vector<Value> upvalues;
 };
 
 #endif // FUNCTION_TYPE_HPP
\ No newline at end of file
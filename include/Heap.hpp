@@ -0,0 +1,206 @@
+#ifndef HEAP_HPP
+#define HEAP_HPP
+
+#include "Object.hpp"
+#include "Value.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Owner of the objects created while a program runs, freed by a precise generational garbage
+// collector. Values don't own the objects they refer to, so a collection starts from the roots
+// marked by the engine running the program: its value stack, globals and call frames. Everything
+// reachable from them through Object::trace() survives, the other objects are freed. Since every
+// allocation may collect, an engine has to keep the objects it still needs reachable from its roots
+// before allocating, e.g. by pushing temporaries onto its value stack.
+//
+// Objects are bump-allocated in a nursery. Most of them, like the temporary strings and lists of a
+// loop body, die before it fills up, so a minor collection only traces the young objects reachable
+// from the roots and from the remembered old objects, and promotes the survivors to the old
+// generation. Objects are never moved: a survivor is promoted in place, and the nursery allocates
+// in the holes between the survivors until its block is mostly full. The old generation is
+// collected by a full collection once it has grown enough. Storing a reference into an object that
+// may be old has to go through writeBarrier(), so the minor collections find the young objects it
+// refers to.
+class Heap
+{
+public:
+    // Reported by --gc-stats.
+    struct Statistics
+    {
+        size_t minor_collections = 0u;
+        size_t full_collections = 0u;
+        // Pause of every collection, in the order they ran.
+        std::vector<std::chrono::nanoseconds> pauses;
+        size_t objects_allocated = 0u;
+        size_t objects_promoted = 0u;
+        size_t objects_reclaimed = 0u;
+        size_t bytes_reclaimed = 0u;
+    };
+
+    // `mark_roots` marks the values the engine refers to directly, it is called at the start of
+    // every collection.
+    explicit Heap(std::function<void(Heap&)> mark_roots);
+
+    Heap(const Heap&) = delete;
+
+    Heap& operator=(const Heap&) = delete;
+
+    ~Heap();
+
+    // Creates an object owned by the heap in the nursery. Collects garbage first if the nursery is
+    // full.
+    template <typename T, typename... Args>
+    T* allocate(Args&&... args)
+    {
+        static_assert(alignof(T) <= ALIGNMENT);
+        constexpr size_t size = (sizeof(T) + ALIGNMENT - 1u) & ~(ALIGNMENT - 1u);
+        static_assert(size <= BLOCK_SIZE - HEADER_SIZE);
+
+#ifdef JLOX_STRESS_GC
+        collectForStress();
+#endif
+        if (static_cast<size_t>(nursery_end - nursery_top) < size)
+        {
+            makeRoom(size);
+        }
+
+        T* object = new (nursery_top) T(std::forward<Args>(args)...);
+        nursery_top += size;
+        manage(object, size);
+        return object;
+    }
+
+    // Records that `value` was stored into `owner`. Old objects referring to young ones are
+    // remembered until the next collection, which treats them as roots of the young generation.
+    void writeBarrier(Object* owner, const Value& value)
+    {
+        if (!owner->is_young && owner->is_managed && !owner->is_remembered && value.isObject() &&
+            value.asObject()->is_young)
+        {
+            owner->is_remembered = true;
+            remembered_objects.push_back(owner);
+        }
+    }
+
+    void mark(const Value& value)
+    {
+        if (value.isObject())
+        {
+            mark(value.asObject());
+        }
+    }
+
+    void mark(Object* object);
+
+    // Collects the young generation only.
+    void collectNursery();
+
+    // Collects both generations.
+    void collect();
+
+    const Statistics& getStatistics() const;
+
+private:
+    // Nursery blocks are aligned to their size, so an object finds the header of its block from its
+    // own address.
+    struct Block
+    {
+        // Objects in the block that haven't been freed. Old blocks are freed with their last
+        // object.
+        size_t live_objects = 0u;
+    };
+
+    // Free range of the nursery block.
+    struct Hole
+    {
+        std::byte* start;
+        std::byte* end;
+
+        size_t size() const { return static_cast<size_t>(end - start); }
+    };
+
+    static constexpr size_t BLOCK_SIZE = 256u * 1024u;
+    static constexpr size_t ALIGNMENT = alignof(std::max_align_t);
+    static constexpr size_t HEADER_SIZE = (sizeof(Block) + ALIGNMENT - 1u) & ~(ALIGNMENT - 1u);
+    // Smaller holes between survivors aren't worth allocating in.
+    static constexpr size_t MIN_HOLE_SIZE = 256u;
+    // A nursery block with less free space left is given up for a new one.
+    static constexpr size_t MIN_NURSERY_SIZE = BLOCK_SIZE / 4u;
+    // Full collections start once the old generation holds this much memory, so short scripts
+    // never run one.
+    static constexpr size_t MIN_FULL_COLLECTION_SIZE = 1024u * 1024u;
+    // The next full collection starts once the old generation has grown by this factor.
+    static constexpr size_t GROWTH_FACTOR = 2u;
+
+    std::function<void(Heap&)> mark_roots;
+    // Objects that survived a collection, and the ones allocated since, linked through
+    // Object::next.
+    Object* old_objects = nullptr;
+    Object* young_objects = nullptr;
+    // Block the young objects are allocated in, its holes in ascending order, and the free space of
+    // the hole being allocated in.
+    Block* nursery = nullptr;
+    std::vector<Hole> holes;
+    size_t next_hole = 0u;
+    std::byte* nursery_top = nullptr;
+    std::byte* nursery_end = nullptr;
+    // Addresses of the young objects promoted by the running collection, kept to find the holes
+    // between them.
+    std::vector<std::byte*> survivors;
+    // Old objects that may refer to young ones.
+    std::vector<Object*> remembered_objects;
+    // Marked objects whose references haven't been traced yet.
+    std::vector<Object*> gray_objects;
+    // Whether the running collection is a minor one, which leaves the old objects alone.
+    bool is_minor_collection = false;
+    // Memory held by the old generation.
+    size_t old_bytes = 0u;
+    size_t next_full_collection = MIN_FULL_COLLECTION_SIZE;
+#ifdef JLOX_STRESS_GC
+    size_t stress_allocations = 0u;
+#endif
+    Statistics statistics;
+
+    void manage(Object* object, size_t size);
+
+    // Moves on to a hole of at least `size` bytes, collecting the young generation once the
+    // nursery is full.
+    void makeRoom(size_t size);
+
+    bool useNextHole(size_t size);
+
+#ifdef JLOX_STRESS_GC
+    void collectForStress();
+#endif
+
+    void traceGrayObjects();
+
+    // Frees the unmarked young objects and promotes the others.
+    void sweepYoung();
+
+    void sweepOld();
+
+    void free(Object* object);
+
+    void startNurseryBlock();
+
+    // Finds the holes left in the nursery block after the young generation has been swept.
+    void findHoles();
+
+    void recordPause(std::chrono::steady_clock::time_point start);
+
+    static Block* blockOf(const Object* object)
+    {
+        return reinterpret_cast<Block*>(reinterpret_cast<std::uintptr_t>(object) &
+                                        ~(BLOCK_SIZE - 1u));
+    }
+
+    static size_t sizeOf(const Object& object);
+};
+
+#endif // HEAP_HPP
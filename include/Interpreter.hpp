@@ -1,42 +1,45 @@
 #ifndef INTERPRETER_HPP
 #define INTERPRETER_HPP
 
+#include "CallStack.hpp"
 #include "Callable.hpp"
-#include "Environment.hpp"
+#include "ExecStatus.hpp"
 #include "ExprNode.hpp"
+#include "Heap.hpp"
 #include "RuntimeError.hpp"
 #include "StmtNode.hpp"
 #include "Visitor.hpp"
 #include <unordered_map>
 
-class Interpreter : public ExprVisitor<std::any>, public StmtVisitor
+class Interpreter : public ExprVisitor<Value>, public StmtVisitor
 {
 public:
     Interpreter();
 
-    void interpret(const std::vector<unique_stmt_ptr>& statements);
-
-    void executeBlock(const std::vector<unique_stmt_ptr>& statements,
-                      std::shared_ptr<Environment> enclosing_env);
-
-    void resolve(const Expr& expr_ptr, size_t depth);
-
-    std::any visit(const BinaryExpr& expr) override;
-    std::any visit(const UnaryExpr& expr) override;
-    std::any visit(const GroupingExpr& expr) override;
-    std::any visit(const LiteralExpr& expr) override;
-    std::any visit(const AssignExpr& expr) override;
-    std::any visit(const CallExpr& expr) override;
-    std::any visit(const SetExpr& expr) override;
-    std::any visit(const GetExpr& expr) override;
-    std::any visit(const SuperExpr& expr) override;
-    std::any visit(const LogicalExpr& expr) override;
-    std::any visit(const ThisExpr& expr) override;
-    std::any visit(const VarExpr& expr) override;
-    std::any visit(const ListExpr& expr) override;
-    std::any visit(const SubscriptExpr& expr) override;
-    std::any visit(const IncrementExpr& expr) override;
-    std::any visit(const DecrementExpr& expr) override;
+    void interpret(const ast_vector<unique_stmt_ptr>& statements);
+
+    // Runs a function whose `arg_count` arguments are the topmost values of the call stack.
+    Value callFunction(const FnStmt& declaration, const std::vector<Value>& upvalues,
+                       size_t arg_count);
+
+    const Heap::Statistics& getHeapStatistics() const;
+
+    Value visit(const BinaryExpr& expr) override;
+    Value visit(const UnaryExpr& expr) override;
+    Value visit(const GroupingExpr& expr) override;
+    Value visit(const LiteralExpr& expr) override;
+    Value visit(const AssignExpr& expr) override;
+    Value visit(const CallExpr& expr) override;
+    Value visit(const SetExpr& expr) override;
+    Value visit(const GetExpr& expr) override;
+    Value visit(const SuperExpr& expr) override;
+    Value visit(const LogicalExpr& expr) override;
+    Value visit(const ThisExpr& expr) override;
+    Value visit(const VarExpr& expr) override;
+    Value visit(const ListExpr& expr) override;
+    Value visit(const SubscriptExpr& expr) override;
+    Value visit(const IncrementExpr& expr) override;
+    Value visit(const DecrementExpr& expr) override;
 
     void visit(const BlockStmt& stmt) override;
     void visit(const ClassStmt& stmt) override;
@@ -51,39 +54,63 @@ public:
     void visit(const WhileStmt& stmt) override;
     void visit(const ForStmt& stmt) override;
 
-    class EnvironmentGuard
+    // Stops the program when the body of a lazily parsed function has errors on its first call.
+    // They were reported while parsing it, so it doesn't add a runtime error of its own.
+    class BodyErrors : public std::exception
+    {
+    };
+
+    class ScopeGuard
     {
     public:
-        EnvironmentGuard(Interpreter& interpreter, std::shared_ptr<Environment> env);
+        ScopeGuard(Interpreter& interpreter, const ScopeLayout& layout);
 
-        ~EnvironmentGuard();
+        ~ScopeGuard();
 
     private:
         Interpreter& interpreter;
-        std::shared_ptr<Environment> previous_env;
+        const ScopeLayout& layout;
     };
 
 private:
-    std::unique_ptr<Environment> globals = std::make_unique<Environment>();
-    Environment* const global_environment;
-    std::shared_ptr<Environment> environment;
-    std::unordered_map<const Expr*, size_t> locals;
+    // Owner of the objects created by the program. Temporaries that have to survive the evaluation
+    // of another expression are pushed onto the call stack, so the garbage collector sees them.
+    Heap heap;
+    // Keyed by the interned names the Resolver puts in the variable slots, so looking up a global
+    // hashes a pointer instead of its name.
+    std::unordered_map<const String*, Value> globals;
+    // Frames of the running functions, holding their locals.
+    CallStack call_stack;
+    // Upvalues of the running function, nullptr in top-level code.
+    const std::vector<Value>* upvalues = nullptr;
+    // How the statement being executed finished. Statement visitors return nothing, so they leave
+    // their status here and execute() hands it to the caller.
+    ExecStatus status = ExecStatus::NORMAL;
+    // Value of the return statement being executed.
+    Value return_value;
+
+    void markRoots(Heap& heap) const;
+
+    void checkNumberOperand(const Token& op, const Value& operand) const;
+
+    void checkNumberOperands(const Token& op, const Value& lhs, const Value& rhs) const;
 
-    void checkNumberOperand(const Token& op, const std::any& operand) const;
+    // Adds operands that aren't both numbers.
+    Value concatenate(const Token& op, const Value& left, const Value& right);
 
-    void checkNumberOperands(const Token& op, const std::any& lhs, const std::any& rhs) const;
+    Value evaluate(const Expr& expr);
 
-    bool isTruthy(const std::any& object) const;
+    ExecStatus execute(const Stmt& stmt);
 
-    bool isEqual(const std::any& lhs, const std::any& rhs) const;
+    ExecStatus executeStatements(const ast_vector<unique_stmt_ptr>& statements);
 
-    std::any evaluate(const Expr& expr);
+    void define(const Token& identifier, const VariableSlot& slot, const Value& value);
 
-    void execute(const Stmt& stmt);
+    Value& lookUpGlobal(const Token& identifier, const VariableSlot& slot);
 
-    shared_ptr_any lookUpVariable(const Token& identifier, const Expr* expr_ptr) const;
+    Value& lookUpVariable(const Token& identifier, const VariableSlot& slot);
 
-    void assignVariable(const Expr* expr_ptr, const Token& identifier, const std::any& value);
+    void assignVariable(const Token& identifier, const VariableSlot& slot, const Value& value);
 };
 
 #endif // INTERPRETER_HPP
\ No newline at end of file
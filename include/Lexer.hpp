@@ -2,21 +2,37 @@
 #define LEXER_HPP
 
 #include "Token.hpp"
-#include <unordered_map>
+#include <optional>
+#include <string_view>
 #include <vector>
 
+// Splits a source into tokens. The lexemes of the tokens are views of the source, which isn't
+// copied: the caller keeps it alive as long as the tokens and the AST parsed from them. Runs of
+// whitespace, identifier characters and digits, comments and strings are scanned with SSE2 or AVX2
+// vectors when JLOX_SIMD_LEXER is enabled and the target supports them.
 class Lexer
 {
 public:
-    explicit Lexer(std::string source);
+    explicit Lexer(std::string_view source);
 
+    // Scans `source` from `begin`, which is on line `line`. Tokens keep their offsets in the whole
+    // source, for the ParallelParser to lex pieces of a script independently.
+    Lexer(std::string_view source, unsigned int begin, unsigned int line);
+
+    // Scans the whole source at once.
     std::vector<Token> scanTokens();
 
-    static const std::unordered_map<std::string, TokenType> keywords;
+    std::string_view getSource() const { return source; }
+
+    // Scans the next token only, for the Parser to pull tokens as it goes instead of keeping all
+    // of them. Returns EOF tokens once the end of the source is reached.
+    Token nextToken();
+
+    // The type of the keyword spelled `lexeme`, or IDENTIFIER if it isn't one. Doesn't allocate.
+    static TokenType identifierType(std::string_view lexeme);
 
 private:
-    const std::string source;
-    std::vector<Token> tokens;
+    const std::string_view source;
     unsigned int start = 0;
     unsigned int current = 0;
     unsigned int line = 1;
@@ -27,11 +43,9 @@ private:
 
     bool isAlpha(char c) const;
 
-    bool isAlphaNumeric(char c) const;
-
     bool match(char expected);
 
-    std::string getLexeme(TokenType type) const;
+    std::string_view getLexeme(TokenType type) const;
 
     void advance();
 
@@ -39,15 +53,17 @@ private:
 
     char peekNext() const;
 
-    void addToken(TokenType type);
+    // Scans the characters of a token and returns its type, or nothing for a comment or an error.
+    std::optional<TokenType> scanToken();
 
-    void scanToken();
+    // Skips the whitespace before the next token, counting the line breaks.
+    void skipWhitespace();
 
-    void string();
+    std::optional<TokenType> string();
 
-    void number();
+    TokenType number();
 
-    void identifier();
+    TokenType identifier();
 };
 
 #endif // LEXER_HPP
\ No newline at end of file
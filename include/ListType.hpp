@@ -1,26 +1,36 @@
+#ifndef LIST_TYPE_HPP
+#define LIST_TYPE_HPP
+
+#include "Object.hpp"
+#include "Value.hpp"
 #include <algorithm>
-#include <any>
 #include <stdexcept>
 #include <vector>
 
-class List
+class List : public Object
 {
 public:
-    List() = default;
+    List();
 
-    explicit List(std::vector<std::any> values);
+    explicit List(std::vector<Value> values);
 
     size_t length() const noexcept;
 
-    std::any& at(int index);
+    Value& at(int index);
 
-    void append(const std::any& value);
+    void append(const Value& value);
 
-    std::any pop() noexcept;
+    Value pop() noexcept;
 
     void remove(int index);
 
+    void trace(Heap& heap) const override;
+
+    size_t ownedBytes() const noexcept override;
+
 private:
-    std::vector<std::any> values;
+    std::vector<Value> values;
     size_t len = 0u;
 };
+
+#endif // LIST_TYPE_HPP
@@ -29,9 +29,11 @@ namespace Error
 
     void addError(const Token& token, std::string message) noexcept;
 
-    extern bool hadError;
+    // Syntax errors are collected per thread, so that the ParallelParser's workers don't share a
+    // list. It merges their errors into the main thread's in source order.
+    extern thread_local bool hadError;
     extern bool hadRuntimeError;
-    extern std::vector<ErrorInfo> exceptionList;
+    extern thread_local std::vector<ErrorInfo> exceptionList;
 }
 
 #endif // LOGGER_HPP
\ No newline at end of file
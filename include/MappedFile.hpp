@@ -0,0 +1,30 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <string_view>
+
+// Read-only contents of a file. On POSIX systems the file is mapped into memory instead of being
+// copied, so its pages are read in as the lexer reaches them and can be dropped by the kernel
+// under memory pressure. Elsewhere it is read into a string.
+class MappedFile
+{
+public:
+    // Throws std::system_error if the file can't be opened or mapped.
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    std::string_view contents() const { return view; }
+
+private:
+    std::string_view view;
+    // Holds the contents when the file isn't mapped.
+    std::string buffer;
+};
+
+#endif // MAPPED_FILE_HPP
@@ -0,0 +1,63 @@
+#ifndef OBJECT_HPP
+#define OBJECT_HPP
+
+#include <cstddef>
+
+enum class ObjectType
+{
+    STRING,
+    LIST,
+    CALLABLE,
+    // Runtime objects of the bytecode VM.
+    FUNCTION,
+    CLOSURE,
+    UPVALUE,
+    NATIVE,
+    // Functions of the closure-compiling engine.
+    NODE_FUNCTION
+};
+
+class Heap;
+
+// Base class of every heap allocated value (strings, lists, functions and the VM's runtime
+// objects). Objects created while a program runs are owned by the Heap of the engine running it,
+// which frees them once they can't be reached anymore. Objects created before the program runs,
+// i.e. string literals and compiled functions, are owned by the StringTable or the compiled
+// program, and never refer to objects of a heap.
+class Object
+{
+public:
+    explicit Object(ObjectType type) noexcept : type{type} {}
+
+    Object(const Object&) = delete;
+
+    Object& operator=(const Object&) = delete;
+
+    virtual ~Object() = default;
+
+    ObjectType getType() const noexcept { return type; }
+
+    // Marks the objects this object refers to, called by the garbage collector.
+    virtual void trace(Heap& heap) const {}
+
+    // Memory owned by the object outside of itself, e.g. the characters of a string.
+    virtual size_t ownedBytes() const noexcept { return 0u; }
+
+private:
+    friend class Heap;
+
+    const ObjectType type;
+    // Whether a Heap owns the object.
+    bool is_managed = false;
+    bool is_marked = false;
+    // Whether the object was allocated since the last collection.
+    bool is_young = false;
+    // Whether the object is in the Heap's remembered set.
+    bool is_remembered = false;
+    // Size of the object itself, set by the Heap.
+    size_t size = 0u;
+    // Next object owned by the same Heap.
+    Object* next = nullptr;
+};
+
+#endif // OBJECT_HPP
@@ -0,0 +1,46 @@
+#ifndef PARALLEL_PARSER_HPP
+#define PARALLEL_PARSER_HPP
+
+#include "Parser.hpp"
+#include <string_view>
+#include <vector>
+
+// Lexes and parses a large script on several threads. A quick scan of the characters cuts the
+// script into chunks between top-level declarations, outside of any brackets, strings and
+// comments. The chunks are parsed independently by a pool of threads, and their statements and
+// errors are merged in source order. The AST is the same as when parsing on a single thread, and
+// the errors are reported in the same order, though recovering from a syntax error stops at the
+// end of its chunk.
+class ParallelParser
+{
+public:
+    // Where a chunk starts and ends in the script, and the line it starts on.
+    struct Chunk
+    {
+        unsigned int begin;
+        unsigned int end;
+        unsigned int line;
+    };
+
+    // Chunks are at least `chunk_size` bytes long, except the last one. `lazy_functions` is passed
+    // on to the Parser of every chunk.
+    explicit ParallelParser(unsigned int threads, size_t chunk_size = DEFAULT_CHUNK_SIZE,
+                            bool lazy_functions = false);
+
+    // The source has to outlive the AST, as with the Parser.
+    Ast parse(std::string_view source) const;
+
+    // Cuts the source before the first top-level fn, var, class, if, for or while statement after
+    // every `chunk_size` bytes. Such a keyword following a ; or } outside of any brackets can only
+    // start a new statement.
+    static std::vector<Chunk> split(std::string_view source, size_t chunk_size);
+
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 1024u * 1024u;
+
+private:
+    unsigned int threads;
+    size_t chunk_size;
+    bool lazy_functions;
+};
+
+#endif // PARALLEL_PARSER_HPP
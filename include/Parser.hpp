@@ -1,28 +1,58 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include "Arena.hpp"
 #include "ExprNode.hpp"
+#include "Lexer.hpp"
 #include "Logger.hpp"
 #include "StmtNode.hpp"
 #include "Token.hpp"
 #include "Typedef.hpp"
 
 #include <algorithm>
+#include <memory>
+#include <optional>
 #include <stdexcept>
 #include <vector>
 
+// A parsed script. Its nodes are allocated in the arena, which outlives them.
+struct Ast
+{
+    std::unique_ptr<Arena> arena;
+    ast_vector<unique_stmt_ptr> statements;
+};
+
+// Parses with a single token of lookahead. Tokens are pulled from a Lexer as the parser goes, so
+// only the current token and the previous one are kept at a time, or read from the tokens of a
+// whole script scanned beforehand.
 class Parser
 {
 public:
+    // The lexer has to outlive the parser. With `lazy_functions`, the bodies of top-level functions
+    // are only checked for balanced braces, and parsed on the first call of the function.
+    explicit Parser(Lexer& lexer, bool lazy_functions = false);
+
     explicit Parser(std::vector<Token> tokens);
 
-    std::vector<unique_stmt_ptr> parse();
+    Ast parse();
+
+    // Parses the next top-level declaration only, into an arena of its own, for callers that
+    // release the tree of each declaration before parsing the next. Returns no statements at the
+    // end of the script.
+    Ast parseDeclaration();
 
 private:
+    Lexer* lexer = nullptr;
+    bool lazy_functions = false;
     std::vector<Token> tokens;
-    unsigned int current = 0;
+    size_t next_token = 0u;
+    std::optional<Token> previous_token;
+    std::optional<Token> current_token;
+    std::unique_ptr<Arena> arena = std::make_unique<Arena>();
 
-    unique_stmt_ptr declaration();
+    // Only functions declared at the top level can be parsed lazily, the bodies of nested ones can
+    // capture variables of the enclosing code, which has to be resolved along with them.
+    unique_stmt_ptr declaration(bool lazy_function = false);
 
     unique_stmt_ptr classDecl();
 
@@ -30,7 +60,10 @@ private:
 
     unique_stmt_ptr statement();
 
-    unique_stmt_ptr function(const std::string& kind);
+    unique_stmt_ptr function(const std::string& kind, bool lazy = false);
+
+    // Consumes the braces of a function body and everything between them, without parsing it.
+    LazyBody skipBody(const std::string& kind);
 
     unique_stmt_ptr ifStatement();
 
@@ -38,7 +71,7 @@ private:
 
     unique_stmt_ptr whileStatement();
 
-    std::vector<unique_stmt_ptr> block();
+    ast_vector<unique_stmt_ptr> block();
 
     unique_stmt_ptr expressionStatement();
 
@@ -48,7 +81,7 @@ private:
 
     unique_expr_ptr lambda();
 
-    std::vector<unique_expr_ptr> list();
+    ast_vector<unique_expr_ptr> list();
 
     unique_expr_ptr subscript();
 
@@ -103,9 +136,11 @@ private:
 
     void advance();
 
+    Token pullToken();
+
     const Token& peek() const;
 
-    Token previous() const;
+    const Token& previous() const;
 
     class ParseError : public std::runtime_error
     {
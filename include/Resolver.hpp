@@ -1,18 +1,29 @@
 #ifndef RESOLVER_HPP
 #define RESOLVER_HPP
 
-#include "Interpreter.hpp"
+#include "ExprNode.hpp"
+#include "FlatAst.hpp"
+#include "StmtNode.hpp"
 #include "Visitor.hpp"
 #include <stack>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
-class Resolver : public ExprVisitor<std::any>, public StmtVisitor
+class Resolver : public ExprVisitor<Value>, public StmtVisitor
 {
 public:
-    explicit Resolver(Interpreter& interpreter);
+    Resolver();
 
-    void resolve(const std::vector<unique_stmt_ptr>& statements);
+    void resolve(const ast_vector<unique_stmt_ptr>& statements);
+
+    // Resolves the body of a top-level function parsed after the rest of the script, on its first
+    // call. The variables it uses are either its own or globals, so it's resolved on its own.
+    void resolveBody(const FnStmt& function);
+
+    // Resolves the flat AST the same way as the tree it was built from, storing the results in its
+    // side tables.
+    void resolve(const FlatAst& ast);
 
     enum class FuncType
     {
@@ -20,22 +31,38 @@ public:
         FUNCTION
     };
 
-    std::any visit(const BinaryExpr& expr) override;
-    std::any visit(const UnaryExpr& expr) override;
-    std::any visit(const GroupingExpr& expr) override;
-    std::any visit(const LiteralExpr& expr) override;
-    std::any visit(const AssignExpr& expr) override;
-    std::any visit(const CallExpr& expr) override;
-    std::any visit(const SetExpr& expr) override;
-    std::any visit(const GetExpr& expr) override;
-    std::any visit(const SuperExpr& expr) override;
-    std::any visit(const LogicalExpr& expr) override;
-    std::any visit(const ThisExpr& expr) override;
-    std::any visit(const VarExpr& expr) override;
-    std::any visit(const ListExpr& expr) override;
-    std::any visit(const SubscriptExpr& expr) override;
-    std::any visit(const IncrementExpr& expr) override;
-    std::any visit(const DecrementExpr& expr) override;
+    // How much of the resolved code can keep its variables in call frames.
+    struct Statistics
+    {
+        size_t locals = 0u;
+        // Locals used by a function nested in the one declaring them.
+        size_t captured_locals = 0u;
+        size_t scopes = 0u;
+        // Scopes with captured locals, whose upvalues are closed when the scope ends.
+        size_t captured_scopes = 0u;
+        size_t functions = 0u;
+        // Functions that declare no nested functions, so calling them creates no closures.
+        size_t closure_free_functions = 0u;
+    };
+
+    const Statistics& getStatistics() const;
+
+    Value visit(const BinaryExpr& expr) override;
+    Value visit(const UnaryExpr& expr) override;
+    Value visit(const GroupingExpr& expr) override;
+    Value visit(const LiteralExpr& expr) override;
+    Value visit(const AssignExpr& expr) override;
+    Value visit(const CallExpr& expr) override;
+    Value visit(const SetExpr& expr) override;
+    Value visit(const GetExpr& expr) override;
+    Value visit(const SuperExpr& expr) override;
+    Value visit(const LogicalExpr& expr) override;
+    Value visit(const ThisExpr& expr) override;
+    Value visit(const VarExpr& expr) override;
+    Value visit(const ListExpr& expr) override;
+    Value visit(const SubscriptExpr& expr) override;
+    Value visit(const IncrementExpr& expr) override;
+    Value visit(const DecrementExpr& expr) override;
 
     void visit(const BlockStmt& stmt) override;
     void visit(const ClassStmt& stmt) override;
@@ -51,27 +78,88 @@ public:
     void visit(const ForStmt& stmt) override;
 
 private:
-    Interpreter& interpreter;
-    using Scope = std::unordered_map<std::string, bool>;
+    struct Variable
+    {
+        // Whether we have completed resolving the initializer of the variable.
+        bool is_defined;
+        // Whether a function nested in the one declaring the variable uses it.
+        bool is_captured;
+        // Index of the variable in its function's call frame.
+        size_t frame_slot;
+    };
+
+    struct Scope
+    {
+        // The names are views of the tokens of the tree or of the source of the flat AST.
+        std::unordered_map<std::string_view, Variable> variables;
+        // Number of functions around the scope, 0 for scopes of the top-level code.
+        size_t function_depth;
+        // First frame slot of the scope's variables.
+        size_t first_slot;
+        bool is_captured = false;
+    };
+
+    // Slot usage of the call frame of the function being resolved.
+    struct FrameLayout
+    {
+        size_t next_slot = 0u;
+        size_t size = 0u;
+    };
+
+    // Where the captures of a function being resolved are stored, and the state of the enclosing
+    // function, restored when the function ends.
+    struct Function
+    {
+        ast_vector<UpvalueSlot>* upvalues;
+        bool* creates_closures;
+        size_t enclosing_loop_nesting_level;
+        FrameLayout enclosing_frame;
+    };
+
     std::vector<Scope> scopes;
     std::stack<FuncType> func_stack;
+    // The functions around the code being resolved, innermost last.
+    std::vector<Function> functions;
+    FrameLayout frame;
+    Statistics statistics;
     size_t loop_nesting_level = 0u;
 
     void resolve(const Stmt& stmt);
 
     void resolve(const Expr& expr);
 
-    void resolveLocal(const Expr* expr, const Token& name);
+    void resolve(const FlatAst& ast, FlatAst::Index node);
+
+    void resolve(const FlatAst& ast, std::span<const FlatAst::Index> nodes);
+
+    VariableSlot resolveLocal(std::string_view name);
+
+    size_t resolveUpvalue(size_t function_depth, size_t declaring_depth, size_t frame_slot);
 
     void resolveFunction(const FnStmt& stmt, FuncType type);
 
+    void resolveFunction(const FlatAst& ast, FlatAst::Index node, FuncType type);
+
+    // Starts the scope of a function's parameters and locals.
+    void beginFunction(FuncType type, ast_vector<UpvalueSlot>& upvalues, bool& creates_closures);
+
+    ScopeLayout endFunction();
+
     void beginScope();
 
-    void endScope();
+    ScopeLayout endScope();
+
+    // Returns false if the scope already has a variable with the name.
+    bool declare(std::string_view name, VariableSlot& slot);
+
+    void declare(const Token& identifier, VariableSlot& slot);
+
+    void declare(const FlatAst& ast, uint32_t offset, VariableSlot& slot);
 
-    void declare(const Token& identifier);
+    void define(std::string_view name);
 
-    void define(const Token& identifer);
+    // Whether the variable is read in its own initializer.
+    bool isBeingInitialized(std::string_view name) const;
 };
 
 #endif // RESOLVER_HPP
\ No newline at end of file
@@ -1,17 +1,44 @@
 #ifndef STMT_HPP
 #define STMT_HPP
 
+#include "Arena.hpp"
 #include "ExprNode.hpp"
 #include "Token.hpp"
 #include "Typedef.hpp"
 #include "Visitor.hpp"
+#include <memory>
+#include <optional>
+#include <string_view>
 #include <vector>
 
+// Storage of the variables declared in a scope, filled in by the Resolver.
+struct ScopeLayout
+{
+    // Whether a closure captures any of the scope's variables. Their upvalues have to be closed
+    // when the scope ends, so the next values of the frame slots starting at `first_slot` aren't
+    // shared with the closures.
+    bool is_captured = false;
+    size_t first_slot = 0u;
+    // Number of call frame slots the code up to the end of the scope needs.
+    size_t frame_size = 0u;
+};
+
+// Where a function finds a variable it captures when it is declared: in a slot of the enclosing
+// function's call frame (`is_local`), or among the upvalues of the enclosing function.
+struct UpvalueSlot
+{
+    bool is_local;
+    size_t index;
+
+    bool operator==(const UpvalueSlot&) const = default;
+};
+
 struct BlockStmt : Stmt
 {
-    std::vector<unique_stmt_ptr> statements;
+    ast_vector<unique_stmt_ptr> statements;
+    mutable ScopeLayout layout; // Set by the Resolver.
 
-    explicit BlockStmt(std::vector<unique_stmt_ptr> statements);
+    explicit BlockStmt(ast_vector<unique_stmt_ptr> statements);
 
     void accept(StmtVisitor& visitor) const override;
 };
@@ -19,11 +46,11 @@ struct BlockStmt : Stmt
 struct ClassStmt : Stmt
 {
     Token identifier;
-    std::unique_ptr<VarExpr> superclass; // OPTIONAL
-    std::vector<std::unique_ptr<FnStmt>> methods;
+    ast_ptr<VarExpr> superclass; // OPTIONAL
+    ast_vector<ast_ptr<FnStmt>> methods;
 
-    ClassStmt(Token identifier, std::vector<std::unique_ptr<FnStmt>> methods,
-              std::unique_ptr<VarExpr> superclass);
+    ClassStmt(Token identifier, ast_vector<ast_ptr<FnStmt>> methods,
+              ast_ptr<VarExpr> superclass);
 
     void accept(StmtVisitor& visitor) const override;
 };
@@ -37,13 +64,35 @@ struct ExprStmt : Stmt
     void accept(StmtVisitor& visitor) const override;
 };
 
+// Where the body of a function skipped by a lazy Parser is: between `begin` and `end` in `source`,
+// starting on `line`. The body is parsed into an arena of its own, which `arena`, the one of the
+// function's declaration, adopts.
+struct LazyBody
+{
+    std::string_view source;
+    unsigned int begin;
+    unsigned int end;
+    unsigned int line;
+    Arena* arena;
+};
+
 struct FnStmt : Stmt
 {
     Token identifier;
-    std::vector<Token> params;
-    std::vector<unique_stmt_ptr> body;
+    ast_vector<Token> params;
+    // Set instead of the body when the Parser skipped it. The body is parsed and resolved on the
+    // first call of the function, see FunctionType::call.
+    mutable std::optional<LazyBody> lazy_body;
+    mutable ast_vector<unique_stmt_ptr> body;
+    mutable VariableSlot slot;  // Set by the Resolver.
+    mutable ScopeLayout layout; // Set by the Resolver, parameters take the first frame slots.
+    mutable ast_vector<UpvalueSlot> upvalues; // Set by the Resolver.
+    // Set by the Resolver, whether the body declares nested functions.
+    mutable bool creates_closures = false;
+
+    FnStmt(Token identifier, ast_vector<Token> params, ast_vector<unique_stmt_ptr> body);
 
-    FnStmt(Token identifier, std::vector<Token> params, std::vector<unique_stmt_ptr> body);
+    FnStmt(Token identifier, ast_vector<Token> params, LazyBody lazy_body);
 
     void accept(StmtVisitor& visitor) const override;
 };
@@ -59,10 +108,10 @@ struct IfBranch
 struct IfStmt : Stmt
 {
     IfBranch main_branch;
-    std::vector<IfBranch> elif_branches;
+    ast_vector<IfBranch> elif_branches;
     unique_stmt_ptr else_branch; // OPTIONAL
 
-    IfStmt(IfBranch main_branch, std::vector<IfBranch> elif_branches, unique_stmt_ptr else_branch);
+    IfStmt(IfBranch main_branch, ast_vector<IfBranch> elif_branches, unique_stmt_ptr else_branch);
 
     void accept(StmtVisitor& visitor) const override;
 };
@@ -108,6 +157,7 @@ struct VarStmt : Stmt
 {
     Token identifier;
     unique_expr_ptr initializer; // OPTIONAL
+    mutable VariableSlot slot;   // Set by the Resolver.
 
     VarStmt(Token identifier, unique_expr_ptr initializer);
 
@@ -130,6 +180,7 @@ struct ForStmt : Stmt
     unique_expr_ptr condition;
     unique_expr_ptr increment;
     unique_stmt_ptr body;
+    mutable ScopeLayout layout; // Set by the Resolver.
 
     ForStmt(unique_stmt_ptr initializer, unique_expr_ptr condition, unique_expr_ptr increment,
             unique_stmt_ptr body);
@@ -0,0 +1,24 @@
+#ifndef STRING_TABLE_HPP
+#define STRING_TABLE_HPP
+
+#include "StringType.hpp"
+#include <string_view>
+
+// Process-wide table of interned strings. String literals and the names of global variables are
+// interned when a script is parsed and resolved, so every occurrence of the same literal or name
+// is the same String, and two interned strings are equal only if they are the same object. The
+// interned strings are never freed, which bounds them by the distinct literals and names of the
+// scripts run. Strings created at runtime, by concatenations or from numbers, must not be
+// interned: they are allocated in the engine's Heap, which collects them once unreachable.
+class StringTable
+{
+public:
+    // Returns the interned string with the given contents, interning it first if needed. Safe to
+    // call from several threads.
+    static String* intern(std::string_view string);
+
+    // The number of interned strings.
+    static size_t size();
+};
+
+#endif // STRING_TABLE_HPP
@@ -0,0 +1,75 @@
+#ifndef STRING_TYPE_HPP
+#define STRING_TYPE_HPP
+
+#include "Object.hpp"
+#include <string>
+
+// Immutable string. Concatenating long strings creates a rope node that refers to its operands
+// instead of copying them, so building a string by appending to it in a loop takes linear time. A
+// rope is flattened into a single string the first time its characters are needed, i.e. when it is
+// compared, hashed or printed.
+class String : public Object
+{
+public:
+    // Shorter concatenations are copied right away, a rope node would take more memory than them.
+    static constexpr size_t MIN_ROPE_LENGTH = 64u;
+
+    explicit String(std::string value);
+
+    // Concatenations. The operands have to stay reachable by the garbage collector until the new
+    // string is created.
+    String(String* left, String* right);
+
+    String(String* left, std::string right);
+
+    String(std::string left, String* right);
+
+    // Flattens the string if it is a rope.
+    const std::string& getValue() const;
+
+    size_t length() const noexcept { return size; }
+
+    size_t getHash() const;
+
+    // Whether the string is in the StringTable, in which case it is the only string with its
+    // contents.
+    bool isInterned() const noexcept { return is_interned; }
+
+    bool equals(const String& other) const
+    {
+        if (this == &other)
+        {
+            return true;
+        }
+        if ((is_interned && other.is_interned) || size != other.size)
+        {
+            return false;
+        }
+        return getHash() == other.getHash() && getValue() == other.getValue();
+    }
+
+    void trace(Heap& heap) const override;
+
+    size_t ownedBytes() const noexcept override;
+
+private:
+    friend class StringTable;
+
+    // The characters of a flat string. A rope holds the text between its operands.
+    mutable std::string value;
+    // Operands of a rope, both nullptr once it is flattened.
+    mutable String* left = nullptr;
+    mutable String* right = nullptr;
+    const size_t size;
+    mutable size_t hash = 0u;
+    mutable bool is_hashed = false;
+    bool is_interned = false;
+
+    String(String* left, std::string text, String* right);
+
+    bool isRope() const noexcept { return left || right; }
+
+    void flatten() const;
+};
+
+#endif // STRING_TYPE_HPP
@@ -1,6 +1,7 @@
 #ifndef TOKEN_HPP
 #define TOKEN_HPP
 #include <string>
+#include <string_view>
 
 enum class TokenType
 {
@@ -22,15 +23,17 @@ enum class TokenType
     _EOF
 };
 
+// Tokens refer to the characters of the source they were scanned from, which has to outlive them
+// and the AST parsed from them.
 struct Token
 {
-    Token(TokenType type, std::string lexeme, unsigned int line);
-    Token(Token&& token) noexcept;
-    Token(const Token& token);
+    Token(TokenType type, std::string_view lexeme, unsigned int line, unsigned int offset = 0u);
 
     const TokenType type;
-    std::string lexeme;
+    std::string_view lexeme;
     const unsigned int line;
+    // Position of the token in the source, at the opening quote of a string.
+    const unsigned int offset;
 };
 
 std::ostream& operator<<(std::ostream& os, const Token& token);
@@ -1,14 +1,31 @@
 #ifndef TYPEDEF_HPP
 #define TYPEDEF_HPP
 
-#include <any>
 #include <memory>
+#include <memory_resource>
+#include <vector>
 
 struct Expr;
 struct Stmt;
 
-using unique_expr_ptr = std::unique_ptr<Expr>;
-using unique_stmt_ptr = std::unique_ptr<Stmt>;
-using shared_ptr_any = std::shared_ptr<std::any>;
+// AST nodes live in the Arena of their tree, along with everything they own, and are released
+// with it without running their destructors. Deleting one does nothing.
+struct ArenaDeleter
+{
+    template <typename T>
+    void operator()(T*) const noexcept
+    {
+    }
+};
 
-#endif // TYPEDEF_HPP
\ No newline at end of file
+template <typename T>
+using ast_ptr = std::unique_ptr<T, ArenaDeleter>;
+
+// The lists of the nodes of an AST, allocated in its Arena like the nodes.
+template <typename T>
+using ast_vector = std::pmr::vector<T>;
+
+using unique_expr_ptr = ast_ptr<Expr>;
+using unique_stmt_ptr = ast_ptr<Stmt>;
+
+#endif // TYPEDEF_HPP
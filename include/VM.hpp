@@ -0,0 +1,73 @@
+#ifndef VM_HPP
+#define VM_HPP
+
+#include "ClosureType.hpp"
+#include "Compiler.hpp"
+#include "Heap.hpp"
+#include "RuntimeError.hpp"
+#include <string>
+#include <vector>
+
+// Stack-based virtual machine executing the bytecode produced by the Compiler.
+class VM
+{
+public:
+    VM();
+
+    // Runs the program, runtime errors are reported to the Error logger.
+    void interpret(const CompiledProgram& program);
+
+    const Heap::Statistics& getHeapStatistics() const;
+
+private:
+    struct CallFrame
+    {
+        Closure* closure;
+        const uint8_t* ip;
+        // First stack slot of the frame, holding the called closure.
+        Value* slots;
+    };
+
+    struct Global
+    {
+        Value value;
+        bool is_defined = false;
+    };
+
+    // Only bounds runaway recursion. The stack and the frames grow as calls get deeper.
+    static constexpr size_t FRAMES_MAX = size_t{1u} << 20u;
+
+    // Values are addressed by pointer, so growing the stack moves the frames and the open upvalues
+    // pointing into it along.
+    std::vector<Value> stack;
+    Value* stack_top;
+    std::vector<CallFrame> frames;
+    size_t frame_count = 0u;
+    std::vector<Global> globals;
+    const std::vector<std::string>* global_names = nullptr;
+    OpenUpvalues open_upvalues;
+    // Owner of the objects created by the program. Operands stay on the stack until the result
+    // replacing them is created, so the garbage collector sees them.
+    Heap heap;
+
+    void run();
+
+    void push(Value value) noexcept;
+
+    Value pop() noexcept;
+
+    void resetStack() noexcept;
+
+    // Makes the stack at least `size` values large.
+    void reserveStack(size_t size);
+
+    void markRoots(Heap& heap) const;
+
+    void defineNative(const std::string& name, Value native);
+
+    void callValue(size_t arg_count);
+
+    RuntimeError error(const std::string& message) const;
+};
+
+#endif // VM_HPP
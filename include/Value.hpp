@@ -0,0 +1,156 @@
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+#include "Object.hpp"
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+
+// A Lox value: nil, a boolean, a number or a reference to a heap object. Primitive values are
+// stored inline, and references don't own the object, so copying a value never touches the heap.
+// Objects are kept alive by the garbage collector of the Heap owning them, see Heap.
+//
+// By default a value is a 16 byte tagged union. When built with JLOX_NAN_BOXING the value is
+// packed into a single 64-bit word instead: numbers are stored as plain doubles, and every other
+// value is encoded in the unused bits of a quiet NaN.
+class Value
+{
+public:
+    enum class Type : uint8_t
+    {
+        NIL,
+        BOOL,
+        NUMBER,
+        OBJECT
+    };
+
+#ifdef JLOX_NAN_BOXING
+    Value() noexcept : bits{NIL_VALUE} {}
+
+    Value(bool boolean) noexcept : bits{boolean ? TRUE_VALUE : FALSE_VALUE} {}
+
+    Value(double number) noexcept : bits{std::bit_cast<uint64_t>(number)} {}
+
+    Value(Object* object) noexcept : bits{OBJECT_TAG | reinterpret_cast<uintptr_t>(object)} {}
+#else
+    Value() noexcept : type{Type::NIL}, payload{.number = 0} {}
+
+    Value(bool boolean) noexcept : type{Type::BOOL}, payload{.boolean = boolean} {}
+
+    Value(double number) noexcept : type{Type::NUMBER}, payload{.number = number} {}
+
+    Value(Object* object) noexcept : type{Type::OBJECT}, payload{.object = object} {}
+#endif
+
+    // Prevent string literals from silently converting to bool.
+    Value(const char*) = delete;
+
+    Type getType() const noexcept
+    {
+#ifdef JLOX_NAN_BOXING
+        if (isNumber())
+            return Type::NUMBER;
+        if (isObject())
+            return Type::OBJECT;
+        return isNil() ? Type::NIL : Type::BOOL;
+#else
+        return type;
+#endif
+    }
+
+#ifdef JLOX_NAN_BOXING
+    bool isNil() const noexcept { return bits == NIL_VALUE; }
+
+    bool isBool() const noexcept { return (bits | 1u) == TRUE_VALUE; }
+
+    bool isNumber() const noexcept { return (bits & QNAN) != QNAN; }
+
+    bool isObject() const noexcept { return (bits & OBJECT_TAG) == OBJECT_TAG; }
+
+    bool asBool() const noexcept { return bits == TRUE_VALUE; }
+
+    double asNumber() const noexcept { return std::bit_cast<double>(bits); }
+
+    Object* asObject() const noexcept { return reinterpret_cast<Object*>(bits & ~OBJECT_TAG); }
+#else
+    bool isNil() const noexcept { return type == Type::NIL; }
+
+    bool isBool() const noexcept { return type == Type::BOOL; }
+
+    bool isNumber() const noexcept { return type == Type::NUMBER; }
+
+    bool isObject() const noexcept { return type == Type::OBJECT; }
+
+    bool asBool() const noexcept { return payload.boolean; }
+
+    double asNumber() const noexcept { return payload.number; }
+
+    Object* asObject() const noexcept { return payload.object; }
+#endif
+
+    bool isObjectOf(ObjectType object_type) const noexcept
+    {
+        return isObject() && asObject()->getType() == object_type;
+    }
+
+    bool isString() const noexcept { return isObjectOf(ObjectType::STRING); }
+
+    bool isList() const noexcept { return isObjectOf(ObjectType::LIST); }
+
+    bool isCallable() const noexcept { return isObjectOf(ObjectType::CALLABLE); }
+
+    // Downcasts the referenced object, e.g. `value.as<List>()`. The caller is responsible for
+    // checking the object type first.
+    template <typename T>
+    T* as() const noexcept
+    {
+        return static_cast<T*>(asObject());
+    }
+
+private:
+#ifdef JLOX_NAN_BOXING
+    static constexpr uint64_t SIGN_BIT = 0x8000000000000000u;
+    static constexpr uint64_t QNAN = 0x7ffc000000000000u;
+    static constexpr uint64_t OBJECT_TAG = SIGN_BIT | QNAN;
+    static constexpr uint64_t NIL_VALUE = QNAN | 1u;
+    static constexpr uint64_t FALSE_VALUE = QNAN | 2u;
+    static constexpr uint64_t TRUE_VALUE = QNAN | 3u;
+
+    uint64_t bits;
+#else
+    Type type;
+    union
+    {
+        bool boolean;
+        double number;
+        Object* object;
+    } payload;
+#endif
+};
+
+// Lox truthiness: nil and false are falsy, everything else is truthy.
+inline bool isTruthy(const Value& value) noexcept
+{
+    if (value.isNil())
+    {
+        return false;
+    }
+    if (value.isBool())
+    {
+        return value.asBool();
+    }
+    return true;
+}
+
+// Lox equality: values of different types are never equal, strings compare by content and other
+// objects never compare equal.
+bool isEqual(const Value& lhs, const Value& rhs) noexcept;
+
+#ifdef JLOX_NAN_BOXING
+static_assert(sizeof(Value) == 8u, "A NaN-boxed Value should fit in a single 64-bit word.");
+#else
+static_assert(sizeof(Value) == 16u, "Value should be a 16 byte tagged union.");
+#endif
+static_assert(std::is_trivially_copyable_v<Value>, "Copying a Value should be a plain copy.");
+
+#endif // VALUE_HPP
@@ -1,7 +1,7 @@
 #ifndef VISITOR_HPP
 #define VISITOR_HPP
 
-#include <any>
+#include "Value.hpp"
 
 struct AssignExpr;
 struct BinaryExpr;
@@ -45,7 +45,7 @@ struct ExprVisitor
 struct Expr
 {
     virtual ~Expr() = default;
-    virtual std::any accept(ExprVisitor<std::any>& visitor) const = 0;
+    virtual Value accept(ExprVisitor<Value>& visitor) const = 0;
 };
 
 struct BlockStmt;
@@ -1,11 +1,35 @@
 #!/usr/bin/env bash
 
+# Runs every benchmark with the tree-walking interpreter, the closure-compiling engine and the
+# bytecode VM, once with the VM dispatching through a switch and once with computed goto (direct
+# threading). Both variants are built in release mode. The VM compiles the script on every run
+# instead of loading it from the bytecode cache. Extra CMake arguments can be passed through the
+# CMAKE_ARGS environment variable.
+
 ROOT_DIR=$(dirname "$0")
+BUILD_ROOT=${ROOT_DIR}/build-benchmarks
+
+build() {
+    cmake -S "${ROOT_DIR}" -B "${BUILD_ROOT}/$1" -DCMAKE_BUILD_TYPE=Release \
+        -DJLOX_COMPUTED_GOTO="$2" ${CMAKE_ARGS} > /dev/null || exit 1
+    cmake --build "${BUILD_ROOT}/$1" --target main -j > /dev/null || exit 1
+}
+
+measure() {
+    local TIMEFORMAT=%R
+    { time "$@" > /dev/null; } 2>&1
+}
 
-JLOX=${ROOT_DIR}/src/main
+build switch OFF
+build computed-goto ON
 
+printf "%-16s %12s %12s %14s %20s\n" "Benchmark" "tree (s)" "closure (s)" "vm switch (s)" \
+    "vm computed goto (s)"
 for SCRIPT_PATH in "${ROOT_DIR}"/tests/benchmarks/*.jlox; do
     SCRIPT=$(basename "${SCRIPT_PATH}" | cut -f 1 -d '.')
-    TIME=$(/usr/bin/time -f %e "${JLOX}" "${SCRIPT_PATH}")
-    echo "Execution Time for ${SCRIPT} is : ${TIME} seconds"
+    TREE=$(measure "${BUILD_ROOT}/switch/src/main" --engine=tree "${SCRIPT_PATH}")
+    CLOSURE=$(measure "${BUILD_ROOT}/switch/src/main" --engine=closure "${SCRIPT_PATH}")
+    SWITCH=$(measure "${BUILD_ROOT}/switch/src/main" --engine=vm --no-cache "${SCRIPT_PATH}")
+    GOTO=$(measure "${BUILD_ROOT}/computed-goto/src/main" --engine=vm --no-cache "${SCRIPT_PATH}")
+    printf "%-16s %12s %12s %14s %20s\n" "${SCRIPT}" "${TREE}" "${CLOSURE}" "${SWITCH}" "${GOTO}"
 done
@@ -0,0 +1,21 @@
+#!/usr/bin/env bash
+
+# Runs the allocation-heavy benchmarks with every engine and prints the garbage collector's
+# statistics: allocation throughput, promotion rate and pause percentiles. Built in release mode.
+# Extra CMake arguments can be passed through the CMAKE_ARGS environment variable.
+
+ROOT_DIR=$(dirname "$0")
+BUILD_DIR=${ROOT_DIR}/build-benchmarks/gc
+BENCHMARKS=(listAllocation)
+ENGINES=(tree closure vm)
+
+cmake -S "${ROOT_DIR}" -B "${BUILD_DIR}" -DCMAKE_BUILD_TYPE=Release ${CMAKE_ARGS} > /dev/null || exit 1
+cmake --build "${BUILD_DIR}" --target main -j > /dev/null || exit 1
+
+for SCRIPT in "${BENCHMARKS[@]}"; do
+    for ENGINE in "${ENGINES[@]}"; do
+        echo "${SCRIPT} (${ENGINE})"
+        "${BUILD_DIR}/src/main" --engine="${ENGINE}" --gc-stats \
+            "${ROOT_DIR}/tests/benchmarks/${SCRIPT}.jlox" 2>&1 > /dev/null | tail -n +2
+    done
+done
@@ -0,0 +1,24 @@
+#!/usr/bin/env bash
+
+# Measures the throughput of the lexer on a generated script, scanning one character at a time
+# (-DJLOX_SIMD_LEXER=OFF), with SSE2 vectors (the default on x86-64) and with AVX2 vectors. The size
+# of the script in MB can be passed as the first argument. Extra CMake arguments can be passed
+# through the CMAKE_ARGS environment variable.
+
+ROOT_DIR=$(dirname "$0")
+BUILD_ROOT=${ROOT_DIR}/build-benchmarks
+
+build() {
+    cmake -S "${ROOT_DIR}" -B "${BUILD_ROOT}/$1" -DCMAKE_BUILD_TYPE=Release "${@:2}" \
+        ${CMAKE_ARGS} > /dev/null || exit 1
+    cmake --build "${BUILD_ROOT}/$1" --target lexer_benchmark -j > /dev/null || exit 1
+}
+
+build lexer-scalar -DJLOX_SIMD_LEXER=OFF
+build lexer-sse2 -DJLOX_SIMD_LEXER=ON
+build lexer-avx2 -DJLOX_SIMD_LEXER=ON -DCMAKE_CXX_FLAGS=-mavx2
+
+for VARIANT in scalar sse2 avx2; do
+    printf "%-8s " "${VARIANT}"
+    "${BUILD_ROOT}/lexer-${VARIANT}/tests/lexer_benchmark" "$@"
+done
@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+
+# Compares the tagged union value representation against the NaN-boxed one. Both variants are
+# built in release mode and every benchmark is run with each of them. Extra CMake arguments can be
+# passed through the CMAKE_ARGS environment variable.
+
+ROOT_DIR=$(dirname "$0")
+BUILD_ROOT=${ROOT_DIR}/build-value-benchmarks
+BENCHMARKS=(fib equality)
+
+build() {
+    cmake -S "${ROOT_DIR}" -B "${BUILD_ROOT}/$1" -DCMAKE_BUILD_TYPE=Release \
+        -DJLOX_NAN_BOXING="$2" ${CMAKE_ARGS} > /dev/null || exit 1
+    cmake --build "${BUILD_ROOT}/$1" --target main -j > /dev/null || exit 1
+}
+
+measure() {
+    local TIMEFORMAT=%R
+    { time "$1" "$2" > /dev/null; } 2>&1
+}
+
+build tagged OFF
+build nan-boxed ON
+
+printf "%-12s %14s %14s\n" "Benchmark" "tagged (s)" "nan-boxed (s)"
+for SCRIPT in "${BENCHMARKS[@]}"; do
+    SCRIPT_PATH=${ROOT_DIR}/tests/benchmarks/${SCRIPT}.jlox
+    TAGGED=$(measure "${BUILD_ROOT}/tagged/src/main" "${SCRIPT_PATH}")
+    NAN_BOXED=$(measure "${BUILD_ROOT}/nan-boxed/src/main" "${SCRIPT_PATH}")
+    printf "%-12s %14s %14s\n" "${SCRIPT}" "${TAGGED}" "${NAN_BOXED}"
+done
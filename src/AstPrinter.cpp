@@ -1,145 +1,177 @@
 #include "../include/AstPrinter.hpp"
+#include <utility>
 
-std::string AstPrinter::print(const std::vector<unique_expr_ptr>& expressions)
+std::string AstPrinter::print(const FlatAst& ast)
 {
-    for (const auto& expr : expressions)
+    for (const FlatAst::Index stmt : ast.statements())
     {
-        expr.get()->accept(*this);
+        print(ast, stmt);
+        stream << '\n';
     }
 
     return stream.str();
 }
 
-std::any AstPrinter::visit(const BinaryExpr& expr)
+void AstPrinter::print(const FlatAst& ast, FlatAst::Index node)
 {
-    parenthesize(expr.op.lexeme, {std::move(expr.left.get()), std::move(expr.right.get())});
-    return {};
-}
-
-std::any AstPrinter::visit(const UnaryExpr& expr)
-{
-    parenthesize(expr.op.lexeme, {std::move(expr.right.get())});
-    return {};
-}
+    using enum FlatAst::Kind;
 
-std::any AstPrinter::visit(const GroupingExpr& expr)
-{
-    parenthesize("group", {std::move(expr.expression.get())});
-    return {};
-}
-
-std::any AstPrinter::visit(const LiteralExpr& expr)
-{
-    if (expr.literal.type() == typeid(double))
-    {
-        stream << std::any_cast<double>(expr.literal);
-    }
-    else if (expr.literal.type() == typeid(std::string))
-    {
-        stream << std::any_cast<std::string>(expr.literal);
-    }
-    else
+    const FlatAst::Index lhs = ast.lhs(node);
+    const FlatAst::Index rhs = ast.rhs(node);
+    switch (ast.kind(node))
     {
-        stream << "nil";
+    case ASSIGN:
+        parenthesize(ast, "= " + std::string{ast.lexeme(node)}, {lhs});
+        break;
+    case BINARY:
+    case LOGICAL:
+        parenthesize(ast, ast.lexeme(node), {lhs, rhs});
+        break;
+    case UNARY:
+        parenthesize(ast, ast.lexeme(node), {lhs});
+        break;
+    case GROUPING:
+        parenthesize(ast, "group", {lhs});
+        break;
+    case CALL:
+        stream << "(call ";
+        print(ast, lhs);
+        for (const FlatAst::Index arg : ast.list(rhs))
+        {
+            printOperand(ast, arg);
+        }
+        stream << ')';
+        break;
+    case STRING:
+        stream << '"' << ast.lexeme(node) << '"';
+        break;
+    case NUMBER:
+    case TRUE:
+    case FALSE:
+    case NIL:
+    case VARIABLE:
+        stream << ast.lexeme(node);
+        break;
+    case LIST:
+        parenthesize(ast, "list", ast.list(rhs));
+        break;
+    case SUBSCRIPT:
+        stream << "(subscript " << ast.lexeme(node);
+        printOperand(ast, lhs);
+        if (rhs != FlatAst::NONE)
+        {
+            printOperand(ast, rhs);
+        }
+        stream << ')';
+        break;
+    case PREFIX_INCREMENT:
+        stream << "(++ " << ast.lexeme(node) << ')';
+        break;
+    case POSTFIX_INCREMENT:
+        stream << "(" << ast.lexeme(node) << " ++)";
+        break;
+    case PREFIX_DECREMENT:
+        stream << "(-- " << ast.lexeme(node) << ')';
+        break;
+    case POSTFIX_DECREMENT:
+        stream << "(" << ast.lexeme(node) << " --)";
+        break;
+    case BLOCK:
+        parenthesize(ast, "block", ast.list(lhs));
+        break;
+    case EXPRESSION:
+    case PRINT:
+        print(ast, lhs);
+        break;
+    case FUNCTION:
+        stream << "(fn " << ast.lexeme(node) << " (";
+        for (bool first = true; const uint32_t param : ast.list(lhs))
+        {
+            stream << (std::exchange(first, false) ? "" : " ") << ast.lexemeAt(param);
+        }
+        stream << ')';
+        for (const FlatAst::Index stmt : ast.list(rhs))
+        {
+            printOperand(ast, stmt);
+        }
+        stream << ')';
+        break;
+    case IF:
+        // The else branch is left out if there is none.
+        stream << "(if";
+        for (const FlatAst::Index operand : ast.list(lhs))
+        {
+            printOperand(ast, operand);
+        }
+        if (rhs != FlatAst::NONE)
+        {
+            printOperand(ast, rhs);
+        }
+        stream << ')';
+        break;
+    case RETURN:
+        stream << "(return";
+        if (lhs != FlatAst::NONE)
+        {
+            printOperand(ast, lhs);
+        }
+        stream << ')';
+        break;
+    case BREAK:
+        stream << "(break)";
+        break;
+    case CONTINUE:
+        stream << "(continue)";
+        break;
+    case VAR:
+        stream << "(var " << ast.lexeme(node);
+        if (lhs != FlatAst::NONE)
+        {
+            printOperand(ast, lhs);
+        }
+        stream << ')';
+        break;
+    case WHILE:
+        parenthesize(ast, "while", {lhs, rhs});
+        break;
+    case FOR:
+        stream << "(for";
+        for (const FlatAst::Index clause : ast.items(lhs, 3u))
+        {
+            printOperand(ast, clause);
+        }
+        printOperand(ast, rhs);
+        stream << ')';
+        break;
     }
-
-    return {};
-}
-
-std::any AstPrinter::visit(const AssignExpr& expr)
-{
-    parenthesize("=" + expr.identifier.lexeme, {std::move(expr.value.get())});
-    return {};
 }
 
-std::any AstPrinter::visit(const CallExpr& expr)
+void AstPrinter::printOperand(const FlatAst& ast, FlatAst::Index operand)
 {
-    stream << "(call ";
-    expr.callee.get()->accept(*this);
-    for (auto& arg : expr.args)
+    stream << ' ';
+    if (operand == FlatAst::NONE)
     {
-        stream << " ";
-        arg.get()->accept(*this);
+        stream << "()";
     }
-    stream << ")";
-    return {};
-}
-
-std::any AstPrinter::visit(const GetExpr& expr)
-{
-    stream << "(. ";
-    expr.object.get()->accept(*this);
-    stream << expr.identifier.lexeme + ")";
-    return {};
-}
-
-std::any AstPrinter::visit(const SetExpr& expr)
-{
-    stream << "(= ";
-    expr.object.get()->accept(*this);
-    stream << " " + expr.identifier.lexeme + " ";
-    expr.value.get()->accept(*this);
-    stream << ")";
-    return {};
-}
-
-std::any AstPrinter::visit(const SuperExpr& expr)
-{
-    stream << "(super " + expr.method.lexeme + ")";
-    return {};
-}
-
-std::any AstPrinter::visit(const LogicalExpr& expr)
-{
-    parenthesize(expr.op.lexeme, {std::move(expr.left.get()), std::move(expr.right.get())});
-    return {};
-}
-
-std::any AstPrinter::visit(const ThisExpr& expr)
-{
-    stream << "this";
-    return {};
-}
-
-std::any AstPrinter::visit(const VarExpr& expr)
-{
-    stream << expr.identifier.lexeme;
-    return {};
-}
-
-std::any AstPrinter::visit(const ListExpr& expr)
-{
-    stream << "(list [ ";
-    for (auto& item : expr.items)
+    else
     {
-        stream << " ";
-        item.get()->accept(*this);
+        print(ast, operand);
     }
-    stream << " ])";
-    return {};
 }
 
-std::any AstPrinter::visit(const IncrementExpr& expr)
+void AstPrinter::parenthesize(const FlatAst& ast, std::string_view name,
+                              std::initializer_list<FlatAst::Index> operands)
 {
-    // parenthesize("++", {std::move(expr.identifier.get())});
-    return {};
+    parenthesize(ast, name, std::span{operands.begin(), operands.size()});
 }
 
-std::any AstPrinter::visit(const DecrementExpr& expr)
+void AstPrinter::parenthesize(const FlatAst& ast, std::string_view name,
+                              std::span<const FlatAst::Index> operands)
 {
-    // parenthesize("--", {std::move(expr.identifier)});
-    return {};
-}
-
-void AstPrinter::parenthesize(const std::string_view name, std::initializer_list<const Expr*> exprs)
-{
-
-    stream << "(" << name;
-    for (const auto& expr : exprs)
+    stream << '(' << name;
+    for (const FlatAst::Index operand : operands)
     {
-        stream << " ";
-        expr->accept(*this);
+        printOperand(ast, operand);
     }
-
-    stream << ")";
+    stream << ')';
 }
@@ -1,4 +1,13 @@
 #include "../include/BuiltIn.hpp"
+#include "../include/ClosureType.hpp"
+#include "../include/ExecNode.hpp"
+#include "../include/ListType.hpp"
+#include "../include/StringType.hpp"
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 
 // Native clock
 size_t ClockCallable::getArity() const
@@ -6,14 +15,9 @@ size_t ClockCallable::getArity() const
     return 0u;
 }
 
-std::any ClockCallable::call(Interpreter& interpreter, const std::vector<std::any>& args) const
+Value ClockCallable::call(Interpreter& interpreter, std::span<const Value> args) const
 {
-    static_assert(std::is_integral_v<std::chrono::system_clock::rep>,
-                  "Representation of ticks isn't an integral value.");
-
-    // Returns Unix time in seconds.
-    auto now = std::chrono::system_clock::now().time_since_epoch();
-    return static_cast<double>(std::chrono::duration_cast<std::chrono::seconds>(now).count());
+    return clockNative(args);
 }
 
 std::string ClockCallable::toString() const
@@ -24,18 +28,17 @@ std::string ClockCallable::toString() const
 // Native print
 size_t PrintCallable::getArity() const
 {
-    return arity;
+    return 0u;
 }
 
-std::any PrintCallable::call(Interpreter& interpreter, const std::vector<std::any>& args) const
+bool PrintCallable::isVariadic() const
 {
-    std::stringstream stream;
-    for (const auto& arg : args)
-    {
-        stream << stringify(arg, stream) << ' ';
-    }
-    std::cout << stream.str() << '\n';
-    return {};
+    return true;
+}
+
+Value PrintCallable::call(Interpreter& interpreter, std::span<const Value> args) const
+{
+    return printNative(args);
 }
 
 std::string PrintCallable::toString() const
@@ -43,60 +46,102 @@ std::string PrintCallable::toString() const
     return "native print";
 }
 
-std::string stringify(const std::any& item, std::stringstream& stream)
+Value clockNative(std::span<const Value> args)
 {
-    if (item.type() == typeid(shared_ptr_any)) {
-        return stringify(*(std::any_cast<shared_ptr_any>(item)), stream);
-    }
-
-    if (item.type() == typeid(bool))
-        return std::any_cast<bool>(item) ? "true" : "false";
+    static_assert(std::is_integral_v<std::chrono::system_clock::rep>,
+                  "Representation of ticks isn't an integral value.");
 
-    if (item.type() == typeid(char))
-        return std::to_string(std::any_cast<char>(item));
+    // Returns Unix time in seconds.
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::seconds>(now).count());
+}
 
-    if (item.type() == typeid(FunctionType))
-        return std::any_cast<FunctionType>(item).toString();
+Value printNative(std::span<const Value> args)
+{
+    std::stringstream stream;
+    for (const auto& arg : args)
+    {
+        stringify(arg, stream);
+        stream << ' ';
+    }
+    std::cout << stream.str() << '\n';
+    return {};
+}
 
-    if (item.type() == typeid(std::string))
+void stringify(const Value& item, std::stringstream& stream)
+{
+    // Strings are written straight from the objects, without copying them.
+    if (item.isBool())
+        stream << (item.asBool() ? "true" : "false");
+    else if (item.isCallable())
+        stream << item.as<Callable>()->toString();
+    else if (item.isObjectOf(ObjectType::CLOSURE))
+        stream << item.as<Closure>()->getFunction()->toString();
+    else if (item.isObjectOf(ObjectType::FUNCTION))
+        stream << item.as<CompiledFunction>()->toString();
+    else if (item.isObjectOf(ObjectType::NATIVE))
+        stream << item.as<NativeFunction>()->name;
+    else if (item.isObjectOf(ObjectType::NODE_FUNCTION))
+        stream << item.as<NodeFunction>()->toString();
+    else if (item.isString())
     {
-        auto str = std::any_cast<std::string>(item);
+        const auto& str = item.as<String>()->getValue();
         if (str == "\\n")
-            return "\n";
+            stream << '\n';
         else if (str == "\\t")
-            return "\t";
+            stream << '\t';
         else
-            return str;
-    }
-
-    if (item.type() == typeid(double))
-    {
-        auto num_as_string = std::to_string(std::any_cast<double>(item));
-        num_as_string.erase(num_as_string.find_last_not_of('0') + 1, std::string::npos);
-        num_as_string.erase(num_as_string.find_last_not_of('.') + 1, std::string::npos);
-        return num_as_string;
+            stream << str;
     }
-
-    if (item.type() == typeid(int))
+    else if (item.isNumber())
+        stream << numberToString(item.asNumber());
+    else if (item.isList())
     {
-        return std::to_string(std::any_cast<int>(item));
-    }
-
-    if (item.type() == typeid(std::shared_ptr<List>))
-    {
-        auto items = std::any_cast<std::shared_ptr<List>>(item);
+        auto items = item.as<List>();
         stream << "[";
         auto len = items->length();
         for (size_t i = 0u; i < len; ++i)
         {
             stream << ' ';
-            stream << stringify(items->at(static_cast<int>(i)), stream);
+            stringify(items->at(static_cast<int>(i)), stream);
             stream << ",";
         }
         stream.seekp(-1, std::ios_base::end);
         stream << " ]";
-        return {};
+    }
+    else
+        stream << "nil";
+}
+
+std::string numberToString(double number)
+{
+    // Integers are formatted without going through floating point. Doubles hold every integer up
+    // to 2^53 exactly; negative zero is left to the general case so it keeps its sign.
+    constexpr double MAX_EXACT_INTEGER = 9007199254740992.0;
+    if (number >= -MAX_EXACT_INTEGER && number <= MAX_EXACT_INTEGER)
+    {
+        const auto integer = static_cast<int64_t>(number);
+        if (static_cast<double>(integer) == number && (integer != 0 || !std::signbit(number)))
+        {
+            std::array<char, std::numeric_limits<int64_t>::digits10 + 2> buffer;
+            const auto result =
+                std::to_chars(buffer.data(), buffer.data() + buffer.size(), integer);
+            return {buffer.data(), result.ptr};
+        }
+    }
+
+    // Beyond 2^53 the shortest form that reads back as the same number, which switches to
+    // scientific notation when it is shorter, so 1e23 doesn't print 24 digits.
+    std::array<char, 400> buffer;
+    if (std::abs(number) > MAX_EXACT_INTEGER)
+    {
+        const auto result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), number);
+        return {buffer.data(), result.ptr};
     }
 
-    return "nil";
+    // Fixed notation with the fewest decimals that read back as the same number. The longest
+    // results are the smallest subnormals, written out with more than 300 leading zeros.
+    const auto result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), number,
+                                      std::chars_format::fixed);
+    return {buffer.data(), result.ptr};
 }
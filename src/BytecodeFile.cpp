@@ -0,0 +1,436 @@
+#include "../include/BytecodeFile.hpp"
+#include "../include/BytecodeVerifier.hpp"
+#include "../include/StringTable.hpp"
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    // The carriage return and line feed catch files mangled by a text mode transfer.
+    constexpr std::array<char, 8> MAGIC = {'\x7f', 'J', 'L', 'O', 'X', 'C', '\r', '\n'};
+    // Read back in another order on a machine of different endianness.
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304u;
+
+    // The file is the header followed by the function, constant, string and global tables, the
+    // line and code tables of all functions back to back and the characters of all strings. The
+    // script is the first function.
+    struct Header
+    {
+        std::array<char, 8> magic;
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t source_hash;
+        uint32_t function_count;
+        uint32_t constant_count;
+        uint32_t string_count;
+        uint32_t global_count;
+        // Bytes of code of all functions, and entries of their line tables.
+        uint64_t code_size;
+        uint64_t characters_size;
+    };
+
+    struct FunctionRecord
+    {
+        // Index of the name in the string table.
+        uint32_t name;
+        uint32_t arity;
+        uint32_t upvalue_count;
+        // Range of the function's constants in the constant table.
+        uint32_t first_constant;
+        uint32_t constant_count;
+        uint32_t padding = 0u;
+        // Range of the function's code and lines in the code and line tables.
+        uint64_t code_offset;
+        uint64_t code_size;
+    };
+
+    enum class ConstantTag : uint32_t
+    {
+        NIL,
+        BOOL,
+        NUMBER,
+        STRING,  // `index` is in the string table
+        FUNCTION // `index` is in the function table
+    };
+
+    struct ConstantRecord
+    {
+        ConstantTag tag;
+        uint32_t index = 0u;
+        // The number, or whether the boolean is true.
+        uint64_t bits = 0u;
+    };
+
+    struct StringRecord
+    {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    static_assert(sizeof(unsigned int) == sizeof(uint32_t), "Lines are stored as 32-bit numbers");
+
+    template <typename T>
+    void append(std::string& out, const T& value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void appendAll(std::string& out, const std::vector<T>& values)
+    {
+        out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    // Numbers the functions and strings of a program in the order they are first reached from the
+    // script.
+    class Writer
+    {
+    public:
+        std::string write(const CompiledProgram& program, uint64_t source_hash)
+        {
+            addFunction(program.script.as<CompiledFunction>());
+            // Functions are added while walking the constants of the ones before them.
+            for (size_t i = 0u; i < functions.size(); ++i)
+            {
+                writeFunction(*functions[i]);
+            }
+            for (const auto& global : program.globals)
+            {
+                globals.push_back(addString(global));
+            }
+
+            const Header header{MAGIC,
+                                BytecodeFile::VERSION,
+                                BYTE_ORDER_MARK,
+                                source_hash,
+                                static_cast<uint32_t>(function_records.size()),
+                                static_cast<uint32_t>(constants.size()),
+                                static_cast<uint32_t>(strings.size()),
+                                static_cast<uint32_t>(globals.size()),
+                                code.size(),
+                                characters.size()};
+
+            std::string out;
+            append(out, header);
+            appendAll(out, function_records);
+            appendAll(out, constants);
+            appendAll(out, strings);
+            appendAll(out, globals);
+            appendAll(out, lines);
+            appendAll(out, code);
+            out += characters;
+            return out;
+        }
+
+    private:
+        std::vector<const CompiledFunction*> functions;
+        std::unordered_map<const CompiledFunction*, uint32_t> function_indices;
+        std::unordered_map<std::string_view, uint32_t> string_indices;
+
+        std::vector<FunctionRecord> function_records;
+        std::vector<ConstantRecord> constants;
+        std::vector<StringRecord> strings;
+        std::vector<uint32_t> globals;
+        std::vector<unsigned int> lines;
+        std::vector<uint8_t> code;
+        std::string characters;
+
+        uint32_t addFunction(const CompiledFunction* function)
+        {
+            auto [entry, inserted] = function_indices.try_emplace(
+                function, static_cast<uint32_t>(functions.size()));
+            if (inserted)
+            {
+                functions.push_back(function);
+            }
+            return entry->second;
+        }
+
+        uint32_t addString(std::string_view string)
+        {
+            auto [entry, inserted] =
+                string_indices.try_emplace(string, static_cast<uint32_t>(strings.size()));
+            if (inserted)
+            {
+                strings.push_back(StringRecord{characters.size(), string.size()});
+                characters += string;
+            }
+            return entry->second;
+        }
+
+        void writeFunction(const CompiledFunction& function)
+        {
+            const Chunk& chunk = function.chunk;
+            function_records.push_back(FunctionRecord{addString(function.name),
+                                                      static_cast<uint32_t>(function.arity),
+                                                      static_cast<uint32_t>(function.upvalue_count),
+                                                      static_cast<uint32_t>(constants.size()),
+                                                      static_cast<uint32_t>(chunk.constants.size()),
+                                                      0u,
+                                                      code.size(),
+                                                      chunk.code.size()});
+
+            for (const auto& constant : chunk.constants)
+            {
+                constants.push_back(writeConstant(constant));
+            }
+            code.insert(code.end(), chunk.code.begin(), chunk.code.end());
+            lines.insert(lines.end(), chunk.lines.begin(), chunk.lines.end());
+        }
+
+        ConstantRecord writeConstant(const Value& constant)
+        {
+            switch (constant.getType())
+            {
+            case Value::Type::NIL:
+                return ConstantRecord{ConstantTag::NIL};
+            case Value::Type::BOOL:
+                return ConstantRecord{ConstantTag::BOOL, 0u, constant.asBool()};
+            case Value::Type::NUMBER:
+                return ConstantRecord{ConstantTag::NUMBER, 0u,
+                                      std::bit_cast<uint64_t>(constant.asNumber())};
+            case Value::Type::OBJECT:
+                break;
+            }
+
+            // The Compiler only creates constants of strings and functions.
+            if (constant.isString())
+            {
+                return ConstantRecord{ConstantTag::STRING,
+                                      addString(constant.as<String>()->getValue())};
+            }
+            assert(constant.isObjectOf(ObjectType::FUNCTION));
+            return ConstantRecord{ConstantTag::FUNCTION,
+                                  addFunction(constant.as<CompiledFunction>())};
+        }
+    };
+
+    class Reader
+    {
+    public:
+        explicit Reader(std::string_view contents) : contents{contents}
+        {
+            if (!BytecodeFile::isBytecode(contents) || contents.size() < sizeof(Header))
+            {
+                throw BytecodeFile::FormatError{"Not a bytecode file."};
+            }
+            std::memcpy(&header, contents.data(), sizeof(Header));
+            if (header.byte_order != BYTE_ORDER_MARK)
+            {
+                throw BytecodeFile::FormatError{"Bytecode file of a different byte order."};
+            }
+            if (header.version != BytecodeFile::VERSION)
+            {
+                throw BytecodeFile::FormatError{"Bytecode file of version " +
+                                                std::to_string(header.version) + ", expected " +
+                                                std::to_string(BytecodeFile::VERSION) + "."};
+            }
+
+            // The sizes are at most 32 bits, so the offsets can't overflow.
+            function_offset = sizeof(Header);
+            constant_offset = function_offset + header.function_count * sizeof(FunctionRecord);
+            string_offset = constant_offset + header.constant_count * sizeof(ConstantRecord);
+            global_offset = string_offset + header.string_count * sizeof(StringRecord);
+            line_offset = global_offset + header.global_count * sizeof(uint32_t);
+            if (header.code_size > contents.size() || header.characters_size > contents.size() ||
+                header.function_count == 0u)
+            {
+                corrupt();
+            }
+            code_offset = line_offset + header.code_size * sizeof(unsigned int);
+            character_offset = code_offset + header.code_size;
+            if (character_offset + header.characters_size != contents.size())
+            {
+                corrupt();
+            }
+        }
+
+        uint64_t sourceHash() const noexcept { return header.source_hash; }
+
+        CompiledProgram read()
+        {
+            CompiledProgram program;
+
+            // Functions refer to each other, so they are all created before reading any constants.
+            std::vector<CompiledFunction*> functions;
+            std::vector<FunctionRecord> records;
+            for (uint32_t i = 0u; i < header.function_count; ++i)
+            {
+                const auto record = load<FunctionRecord>(function_offset, i);
+                records.push_back(record);
+                functions.push_back(create<CompiledFunction>(
+                    program, std::string{string(record.name)}, record.arity));
+            }
+
+            for (size_t i = 0u; i < functions.size(); ++i)
+            {
+                const FunctionRecord& record = records[i];
+                Chunk& chunk = functions[i]->chunk;
+                functions[i]->upvalue_count = record.upvalue_count;
+
+                if (record.code_offset > header.code_size ||
+                    record.code_size > header.code_size - record.code_offset ||
+                    record.first_constant > header.constant_count ||
+                    record.constant_count > header.constant_count - record.first_constant)
+                {
+                    corrupt();
+                }
+
+                const char* code = contents.data() + code_offset + record.code_offset;
+                chunk.code.assign(code, code + record.code_size);
+                chunk.lines.resize(record.code_size);
+                std::memcpy(chunk.lines.data(),
+                            contents.data() + line_offset +
+                                record.code_offset * sizeof(unsigned int),
+                            record.code_size * sizeof(unsigned int));
+
+                chunk.constants.reserve(record.constant_count);
+                for (uint32_t constant = 0u; constant < record.constant_count; ++constant)
+                {
+                    chunk.constants.push_back(readConstant(
+                        functions,
+                        load<ConstantRecord>(constant_offset, record.first_constant + constant)));
+                }
+            }
+
+            // The VM runs the code without checking it, so it has to be verified once all constants
+            // it refers to exist. The script is called without arguments and captures nothing.
+            if (functions.front()->arity != 0u || functions.front()->upvalue_count != 0u)
+            {
+                corrupt();
+            }
+            for (CompiledFunction* function : functions)
+            {
+                try
+                {
+                    function->max_stack_height =
+                        BytecodeVerifier::verify(*function, header.global_count);
+                }
+                catch (const BytecodeVerifier::VerifyError& error)
+                {
+                    throw BytecodeFile::FormatError{error.what()};
+                }
+            }
+
+            program.script = functions.front();
+            program.globals.reserve(header.global_count);
+            for (uint32_t i = 0u; i < header.global_count; ++i)
+            {
+                program.globals.emplace_back(string(load<uint32_t>(global_offset, i)));
+            }
+            return program;
+        }
+
+    private:
+        std::string_view contents;
+        Header header;
+        size_t function_offset;
+        size_t constant_offset;
+        size_t string_offset;
+        size_t global_offset;
+        size_t line_offset;
+        size_t code_offset;
+        size_t character_offset;
+
+        [[noreturn]] static void corrupt()
+        {
+            throw BytecodeFile::FormatError{"Corrupt bytecode file."};
+        }
+
+        // The index-th entry of the table starting at `offset`. The tables are not necessarily
+        // aligned, so their entries are copied out.
+        template <typename T>
+        T load(size_t offset, size_t index) const
+        {
+            T value;
+            std::memcpy(&value, contents.data() + offset + index * sizeof(T), sizeof(T));
+            return value;
+        }
+
+        template <typename T, typename... Args>
+        static T* create(CompiledProgram& program, Args&&... args)
+        {
+            auto object = std::make_unique<T>(std::forward<Args>(args)...);
+            T* created = object.get();
+            program.objects.push_back(std::move(object));
+            return created;
+        }
+
+        std::string_view string(uint32_t index) const
+        {
+            if (index >= header.string_count)
+            {
+                corrupt();
+            }
+            const auto record = load<StringRecord>(string_offset, index);
+            if (record.offset > header.characters_size ||
+                record.size > header.characters_size - record.offset)
+            {
+                corrupt();
+            }
+            return contents.substr(character_offset + record.offset, record.size);
+        }
+
+        Value readConstant(const std::vector<CompiledFunction*>& functions,
+                           const ConstantRecord& constant) const
+        {
+            switch (constant.tag)
+            {
+            case ConstantTag::NIL:
+                return Value{};
+            case ConstantTag::BOOL:
+                return Value{constant.bits != 0u};
+            case ConstantTag::NUMBER:
+                return Value{std::bit_cast<double>(constant.bits)};
+            case ConstantTag::STRING:
+                return StringTable::intern(string(constant.index));
+            case ConstantTag::FUNCTION:
+                return functions.at(constant.index);
+            }
+            corrupt();
+        }
+    };
+}
+
+namespace BytecodeFile
+{
+    bool isBytecode(std::string_view contents) noexcept
+    {
+        return contents.starts_with(std::string_view{MAGIC.data(), MAGIC.size()});
+    }
+
+    std::string write(const CompiledProgram& program, uint64_t source_hash)
+    {
+        return Writer{}.write(program, source_hash);
+    }
+
+    CompiledProgram read(std::string_view contents)
+    {
+        try
+        {
+            return Reader{contents}.read();
+        }
+        catch (const std::out_of_range&)
+        {
+            throw FormatError{"Corrupt bytecode file."};
+        }
+    }
+
+    uint64_t sourceHash(std::string_view contents)
+    {
+        return Reader{contents}.sourceHash();
+    }
+
+    uint64_t hashSource(std::string_view source) noexcept
+    {
+        uint64_t hash = 0xcbf29ce484222325u;
+        for (const char c : source)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3u;
+        }
+        return hash;
+    }
+}
@@ -0,0 +1,341 @@
+#include "../include/BytecodeVerifier.hpp"
+#include "../include/StringType.hpp"
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+    class FunctionVerifier
+    {
+    public:
+        FunctionVerifier(const CompiledFunction& function, size_t global_count)
+            : function{function}, code{function.chunk.code}, global_count{global_count}
+        {
+        }
+
+        size_t verify()
+        {
+            // Jumps may only land on the start of an instruction, so all of them are found first.
+            is_start.assign(code.size(), false);
+            for (size_t offset = 0u; offset < code.size(); offset += decode(offset))
+            {
+                is_start[offset] = true;
+            }
+
+            // The frame starts with the called closure and its arguments.
+            heights.assign(code.size(), UNREACHED);
+            enter(0u, 0u, 1u + function.arity);
+            while (!pending.empty())
+            {
+                const size_t offset = pending.back();
+                pending.pop_back();
+                trace(offset);
+            }
+            return max_height;
+        }
+
+    private:
+        static constexpr size_t UNREACHED = std::numeric_limits<size_t>::max();
+
+        const CompiledFunction& function;
+        const std::vector<uint8_t>& code;
+        const size_t global_count;
+        std::vector<bool> is_start;
+        // Height of the frame before every instruction, once a path reaching it has been found.
+        std::vector<size_t> heights;
+        // Reached instructions that haven't been traced yet.
+        std::vector<size_t> pending;
+        size_t max_height = 0u;
+
+        [[noreturn]] void fail(size_t offset, const std::string& message) const
+        {
+            throw BytecodeVerifier::VerifyError{"Invalid bytecode in '" + function.name +
+                                                "' at offset " + std::to_string(offset) + ": " +
+                                                message};
+        }
+
+        uint8_t byte(size_t instruction, size_t offset) const
+        {
+            if (offset >= code.size())
+            {
+                fail(instruction, "truncated instruction.");
+            }
+            return code[offset];
+        }
+
+        uint16_t readShort(size_t instruction) const
+        {
+            return static_cast<uint16_t>((byte(instruction, instruction + 1u) << 8u) |
+                                         byte(instruction, instruction + 2u));
+        }
+
+        const Value& constant(size_t instruction) const
+        {
+            return constantAt(instruction, readShort(instruction));
+        }
+
+        const Value& constantAt(size_t instruction, size_t index) const
+        {
+            if (index >= function.chunk.constants.size())
+            {
+                fail(instruction, "constant " + std::to_string(index) + " out of range.");
+            }
+            return function.chunk.constants[index];
+        }
+
+        // Length of the instruction at `offset`. Checks its operands that don't depend on the
+        // height of the frame.
+        size_t decode(size_t offset) const
+        {
+            using enum OpCode;
+            switch (static_cast<OpCode>(code[offset]))
+            {
+            case NIL:
+            case _TRUE:
+            case _FALSE:
+            case POP:
+            case EQUAL:
+            case GREATER:
+            case GREATER_EQUAL:
+            case LESS:
+            case LESS_EQUAL:
+            case ADD:
+            case SUBTRACT:
+            case MULTIPLY:
+            case DIVIDE:
+            case NOT:
+            case NEGATE:
+            case CLOSE_UPVALUE:
+            case RETURN:
+                return 1u;
+
+            case CONSTANT:
+                constant(offset);
+                return 3u;
+
+            case CONSTANT_LONG:
+                constantAt(offset, (size_t{byte(offset, offset + 1u)} << 16u) |
+                                       byte(offset, offset + 2u) << 8u | byte(offset, offset + 3u));
+                return 4u;
+
+            case GET_LOCAL:
+            case SET_LOCAL:
+            case LIST:
+            case CALL:
+                byte(offset, offset + 1u);
+                return 2u;
+
+            case GET_GLOBAL:
+            case DEFINE_GLOBAL:
+            case SET_GLOBAL:
+                if (readShort(offset) >= global_count)
+                {
+                    fail(offset, "global out of range.");
+                }
+                return 3u;
+
+            case GET_UPVALUE:
+            case SET_UPVALUE:
+                if (byte(offset, offset + 1u) >= function.upvalue_count)
+                {
+                    fail(offset, "upvalue out of range.");
+                }
+                return 2u;
+
+            case GET_SUBSCRIPT:
+            case SET_SUBSCRIPT:
+            case INCREMENT:
+            case DECREMENT:
+                if (!constant(offset).isString())
+                {
+                    fail(offset, "name constant isn't a string.");
+                }
+                return 3u;
+
+            case JUMP:
+            case JUMP_IF_FALSE:
+            case LOOP:
+                readShort(offset);
+                return 3u;
+
+            case CLOSURE:
+            {
+                const Value& captured = constant(offset);
+                if (!captured.isObjectOf(ObjectType::FUNCTION))
+                {
+                    fail(offset, "closure constant isn't a function.");
+                }
+                const size_t upvalue_count = captured.as<CompiledFunction>()->upvalue_count;
+                for (size_t i = 0u; i < upvalue_count; ++i)
+                {
+                    const uint8_t is_local = byte(offset, offset + 3u + 2u * i);
+                    const uint8_t index = byte(offset, offset + 4u + 2u * i);
+                    if (is_local > 1u || (!is_local && index >= function.upvalue_count))
+                    {
+                        fail(offset, "captured upvalue out of range.");
+                    }
+                }
+                return 3u + 2u * upvalue_count;
+            }
+            }
+            fail(offset, "unknown opcode " + std::to_string(code[offset]) + ".");
+        }
+
+        // Records that the instruction at `target` is reached from `from` with the given height.
+        void enter(size_t from, size_t target, size_t height)
+        {
+            if (target >= code.size() || !is_start[target])
+            {
+                fail(from, target >= code.size() ? "runs past the end of the code."
+                                                 : "jumps into the middle of an instruction.");
+            }
+            if (heights[target] == UNREACHED)
+            {
+                heights[target] = height;
+                pending.push_back(target);
+                max_height = std::max(max_height, height);
+            }
+            else if (heights[target] != height)
+            {
+                fail(target, "reached with different stack heights.");
+            }
+        }
+
+        // Checks a local slot of the frame. Slot 0 holds the called closure, which mustn't be
+        // overwritten or captured while the frame runs.
+        void checkSlot(size_t offset, size_t slot, size_t height, bool is_written) const
+        {
+            if (slot >= height || (is_written && slot == 0u))
+            {
+                fail(offset, "local slot " + std::to_string(slot) + " out of range.");
+            }
+        }
+
+        void trace(size_t offset)
+        {
+            const size_t height = heights[offset];
+            const size_t next = offset + decode(offset);
+
+            // Values popped and pushed by the instruction.
+            size_t pops = 0u;
+            size_t pushes = 0u;
+            using enum OpCode;
+            const auto op = static_cast<OpCode>(code[offset]);
+            switch (op)
+            {
+            case CONSTANT:
+            case CONSTANT_LONG:
+            case NIL:
+            case _TRUE:
+            case _FALSE:
+            case GET_GLOBAL:
+            case GET_UPVALUE:
+                pushes = 1u;
+                break;
+            case POP:
+            case DEFINE_GLOBAL:
+            case CLOSE_UPVALUE:
+            case RETURN:
+                pops = 1u;
+                break;
+            case GET_LOCAL:
+                checkSlot(offset, code[offset + 1u], height, false);
+                pushes = 1u;
+                break;
+            case SET_LOCAL:
+                checkSlot(offset, code[offset + 1u], height, true);
+                pops = pushes = 1u;
+                break;
+            case SET_GLOBAL:
+            case SET_UPVALUE:
+            case NOT:
+            case NEGATE:
+            case INCREMENT:
+            case DECREMENT:
+            case JUMP_IF_FALSE:
+                pops = pushes = 1u;
+                break;
+            case GET_SUBSCRIPT:
+            case EQUAL:
+            case GREATER:
+            case GREATER_EQUAL:
+            case LESS:
+            case LESS_EQUAL:
+            case ADD:
+            case SUBTRACT:
+            case MULTIPLY:
+            case DIVIDE:
+                pops = 2u;
+                pushes = 1u;
+                break;
+            case SET_SUBSCRIPT:
+                pops = 3u;
+                pushes = 1u;
+                break;
+            case LIST:
+                pops = code[offset + 1u];
+                pushes = 1u;
+                break;
+            case CALL:
+                pops = code[offset + 1u] + 1u;
+                pushes = 1u;
+                break;
+            case CLOSURE:
+                // The closure is pushed before capturing, so a local function can capture itself.
+                for (size_t operand = offset + 3u; operand < next; operand += 2u)
+                {
+                    if (code[operand] == 1u)
+                    {
+                        checkSlot(offset, code[operand + 1u], height + 1u, true);
+                    }
+                }
+                pushes = 1u;
+                break;
+            case JUMP:
+            case LOOP:
+                break;
+            }
+
+            // Only the values above the called closure may be popped.
+            if (height < 1u + pops)
+            {
+                fail(offset, "pops more values than the frame holds.");
+            }
+            const size_t next_height = height - pops + pushes;
+            max_height = std::max(max_height, next_height);
+
+            switch (op)
+            {
+            case RETURN:
+                break;
+            case JUMP:
+                enter(offset, next + readShort(offset), next_height);
+                break;
+            case LOOP:
+                if (readShort(offset) > next)
+                {
+                    fail(offset, "loops back before the start of the code.");
+                }
+                enter(offset, next - readShort(offset), next_height);
+                break;
+            case JUMP_IF_FALSE:
+                enter(offset, next + readShort(offset), next_height);
+                enter(offset, next, next_height);
+                break;
+            default:
+                enter(offset, next, next_height);
+                break;
+            }
+        }
+    };
+}
+
+namespace BytecodeVerifier
+{
+    size_t verify(const CompiledFunction& function, size_t global_count)
+    {
+        return FunctionVerifier{function, global_count}.verify();
+    }
+}
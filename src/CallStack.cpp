@@ -0,0 +1,40 @@
+#include "../include/CallStack.hpp"
+#include <algorithm>
+
+void CallStack::popTo(size_t top)
+{
+    assert(top <= frame_top);
+    closeUpvaluesFrom(top);
+    // Clear the released slots, so the garbage collector doesn't see stale values when they are
+    // taken into use again.
+    std::fill(values.begin() + top, values.begin() + frame_top, Value{});
+    frame_top = top;
+}
+
+void CallStack::extendFrame(size_t size)
+{
+    if (frame_base + size > frame_top)
+    {
+        grow(frame_base + size);
+        frame_top = frame_base + size;
+    }
+}
+
+size_t CallStack::enterFrame(size_t arg_count, size_t size)
+{
+    assert(arg_count <= size && arg_count <= frame_top);
+    const size_t caller_base = frame_base;
+    frame_base = frame_top - arg_count;
+    frame_top = frame_base + size;
+    grow(frame_top);
+    return caller_base;
+}
+
+void CallStack::mark(Heap& heap) const
+{
+    for (size_t i = 0u; i < frame_top; ++i)
+    {
+        heap.mark(values[i]);
+    }
+    open_upvalues.mark(heap);
+}
@@ -0,0 +1,1252 @@
+#include "../include/ClosureCompiler.hpp"
+#include "../include/BuiltIn.hpp"
+#include "../include/ClosureType.hpp"
+#include "../include/ListType.hpp"
+#include "../include/RuntimeError.hpp"
+#include "../include/StringType.hpp"
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace
+{
+    // Operand shapes. Binary operators are specialized for each combination, so reading a literal
+    // or a local variable in the call frame costs no virtual call.
+
+    // A literal.
+    struct ConstantOperand
+    {
+        Value value;
+
+        const Value& get(ExecContext&) const noexcept { return value; }
+    };
+
+    // A local variable in the call frame.
+    struct FrameOperand
+    {
+        size_t index;
+
+        Value& get(ExecContext& context) const { return context.call_stack.local(index); }
+
+        void set(ExecContext& context, const Value& value) const { get(context) = value; }
+    };
+
+    // A variable of an enclosing function, resolved to the index of the running function's
+    // upvalue.
+    struct UpvalueOperand
+    {
+        size_t index;
+
+        Value& get(ExecContext& context) const
+        {
+            return *(*context.upvalues)[index].as<Upvalue>()->location;
+        }
+
+        void set(ExecContext& context, const Value& value) const
+        {
+            // A closed upvalue holds the variable itself.
+            auto upvalue = (*context.upvalues)[index].as<Upvalue>();
+            *upvalue->location = value;
+            context.heap.writeBarrier(upvalue, value);
+        }
+    };
+
+    // A global variable, resolved to its index.
+    struct GlobalOperand
+    {
+        Token identifier;
+        size_t index;
+
+        Value& get(ExecContext& context) const
+        {
+            auto& global = context.globals[index];
+            if (!global.is_defined)
+            {
+                throw RuntimeError(identifier,
+                                   "Undefined variable '" + std::string{identifier.lexeme} + "'.");
+            }
+            return global.value;
+        }
+
+        void set(ExecContext& context, const Value& value) const { get(context) = value; }
+    };
+
+    // Any other expression.
+    struct NodeOperand
+    {
+        compiled_expr_ptr node;
+
+        Value get(ExecContext& context) const { return node->eval(context); }
+    };
+
+    using Operand = std::variant<ConstantOperand, FrameOperand, NodeOperand>;
+
+    ExecStatus execAll(const std::vector<compiled_stmt_ptr>& statements, ExecContext& context)
+    {
+        for (const auto& stmt : statements)
+        {
+            if (const auto status = stmt->exec(context); status != ExecStatus::NORMAL)
+            {
+                return status;
+            }
+        }
+        return ExecStatus::NORMAL;
+    }
+
+    // Runs a function whose arguments are the topmost values of the call stack. Runtime errors
+    // abort the whole program, so the caller's frame and upvalues are only restored on a normal
+    // return.
+    Value callFunction(ExecContext& context, const NodeFunction& function)
+    {
+        const auto& declaration = *function.declaration;
+        const size_t caller_base =
+            context.call_stack.enterFrame(declaration.arity, declaration.layout.frame_size);
+
+        const auto caller_upvalues = std::exchange(context.upvalues, &function.upvalues);
+
+        Value result;
+        if (execAll(declaration.body, context) == ExecStatus::RETURN)
+        {
+            result = std::move(context.return_value);
+        }
+
+        context.upvalues = caller_upvalues;
+        context.call_stack.leaveFrame(caller_base);
+        return result;
+    }
+
+    void checkNumberOperands(const Token& op, const Value& lhs, const Value& rhs)
+    {
+        if (!lhs.isNumber() || !rhs.isNumber())
+        {
+            throw RuntimeError(op, "Operands must be numbers.");
+        }
+    }
+
+    // Binary operators.
+
+    struct AddOp
+    {
+        static Value apply(ExecContext& context, const Token& op, const Value& lhs,
+                           const Value& rhs)
+        {
+            if (lhs.isNumber() && rhs.isNumber())
+            {
+                return lhs.asNumber() + rhs.asNumber();
+            }
+            if (!(lhs.isString() && (rhs.isString() || rhs.isNumber())) &&
+                !(lhs.isNumber() && rhs.isString()))
+            {
+                throw RuntimeError(op, "Operands must be of type string or number.");
+            }
+
+            // The new string may be a rope referring to the operands, so they are kept on the call
+            // stack while it is allocated. They may be locals on that stack, which pushing can
+            // move, so they are copied first.
+            const Value left = lhs;
+            const Value right = rhs;
+            auto& call_stack = context.call_stack;
+            const size_t top = call_stack.top();
+            call_stack.push(left);
+            call_stack.push(right);
+            String* result = nullptr;
+            if (left.isNumber())
+            {
+                result = context.heap.allocate<String>(numberToString(left.asNumber()),
+                                                       right.as<String>());
+            }
+            else if (right.isNumber())
+            {
+                result = context.heap.allocate<String>(left.as<String>(),
+                                                       numberToString(right.asNumber()));
+            }
+            else
+            {
+                result = context.heap.allocate<String>(left.as<String>(), right.as<String>());
+            }
+            call_stack.popTo(top);
+            return result;
+        }
+    };
+
+    struct SubtractOp
+    {
+        static Value apply(ExecContext& context, const Token& op, const Value& lhs,
+                           const Value& rhs)
+        {
+            checkNumberOperands(op, lhs, rhs);
+            return lhs.asNumber() - rhs.asNumber();
+        }
+    };
+
+    struct MultiplyOp
+    {
+        static Value apply(ExecContext& context, const Token& op, const Value& lhs,
+                           const Value& rhs)
+        {
+            checkNumberOperands(op, lhs, rhs);
+            return lhs.asNumber() * rhs.asNumber();
+        }
+    };
+
+    struct DivideOp
+    {
+        static Value apply(ExecContext& context, const Token& op, const Value& lhs,
+                           const Value& rhs)
+        {
+            checkNumberOperands(op, lhs, rhs);
+            if (rhs.asNumber() == 0)
+            {
+                throw RuntimeError(op, "Division by 0.");
+            }
+            return lhs.asNumber() / rhs.asNumber();
+        }
+    };
+
+    struct GreaterOp
+    {
+        static Value apply(ExecContext& context, const Token& op, const Value& lhs,
+                           const Value& rhs)
+        {
+            checkNumberOperands(op, lhs, rhs);
+            return lhs.asNumber() > rhs.asNumber();
+        }
+    };
+
+    struct GreaterEqualOp
+    {
+        static Value apply(ExecContext& context, const Token& op, const Value& lhs,
+                           const Value& rhs)
+        {
+            checkNumberOperands(op, lhs, rhs);
+            return lhs.asNumber() >= rhs.asNumber();
+        }
+    };
+
+    struct LessOp
+    {
+        static Value apply(ExecContext& context, const Token& op, const Value& lhs,
+                           const Value& rhs)
+        {
+            checkNumberOperands(op, lhs, rhs);
+            return lhs.asNumber() < rhs.asNumber();
+        }
+    };
+
+    struct LessEqualOp
+    {
+        static Value apply(ExecContext& context, const Token& op, const Value& lhs,
+                           const Value& rhs)
+        {
+            checkNumberOperands(op, lhs, rhs);
+            return lhs.asNumber() <= rhs.asNumber();
+        }
+    };
+
+    struct EqualOp
+    {
+        static Value apply(ExecContext&, const Token&, const Value& lhs, const Value& rhs)
+        {
+            return isEqual(lhs, rhs);
+        }
+    };
+
+    struct NotEqualOp
+    {
+        static Value apply(ExecContext&, const Token&, const Value& lhs, const Value& rhs)
+        {
+            return !isEqual(lhs, rhs);
+        }
+    };
+
+    // Expression nodes.
+
+    // Reads a literal or a variable.
+    template <typename Operand>
+    class OperandNode : public CompiledExpr
+    {
+    public:
+        explicit OperandNode(Operand operand) : operand{std::move(operand)} {}
+
+        Value eval(ExecContext& context) const override { return operand.get(context); }
+
+    private:
+        Operand operand;
+    };
+
+    template <typename Op, typename Lhs, typename Rhs>
+    class BinaryNode : public CompiledExpr
+    {
+    public:
+        BinaryNode(Token op, Lhs lhs, Rhs rhs)
+            : op{std::move(op)}, lhs{std::move(lhs)}, rhs{std::move(rhs)}
+        {
+        }
+
+        Value eval(ExecContext& context) const override
+        {
+            // The operands are evaluated left to right into locals, whatever their shapes: a
+            // nested right operand may reassign the variable read on the left, and a call on the
+            // left may grow the call stack, moving the slot of a frame operand on the right. A
+            // nested right operand may also collect garbage, so an object on the left is kept on
+            // the call stack meanwhile.
+            if constexpr (std::is_same_v<Rhs, NodeOperand>)
+            {
+                const Value left = lhs.get(context);
+                if (!left.isObject())
+                {
+                    return Op::apply(context, op, left, rhs.get(context));
+                }
+
+                auto& call_stack = context.call_stack;
+                const size_t top = call_stack.top();
+                call_stack.push(left);
+                const Value right = rhs.get(context);
+                call_stack.popTo(top);
+                return Op::apply(context, op, left, right);
+            }
+            else
+            {
+                const Value left = lhs.get(context);
+                const Value right = rhs.get(context);
+                return Op::apply(context, op, left, right);
+            }
+        }
+
+    private:
+        const Token op;
+        const Lhs lhs;
+        const Rhs rhs;
+    };
+
+    template <typename Op>
+    compiled_expr_ptr makeBinary(const Token& op, Operand lhs, Operand rhs)
+    {
+        return std::visit(
+            [&op](auto&& lhs, auto&& rhs) -> compiled_expr_ptr
+            {
+                using Lhs = std::decay_t<decltype(lhs)>;
+                using Rhs = std::decay_t<decltype(rhs)>;
+                return std::make_unique<BinaryNode<Op, Lhs, Rhs>>(op, std::move(lhs),
+                                                                  std::move(rhs));
+            },
+            std::move(lhs), std::move(rhs));
+    }
+
+    class NegateNode : public CompiledExpr
+    {
+    public:
+        NegateNode(Token op, compiled_expr_ptr right) : op{std::move(op)}, right{std::move(right)}
+        {
+        }
+
+        Value eval(ExecContext& context) const override
+        {
+            const auto value = right->eval(context);
+            if (!value.isNumber())
+            {
+                throw RuntimeError(op, "Operand must be a number.");
+            }
+            return -value.asNumber();
+        }
+
+    private:
+        const Token op;
+        const compiled_expr_ptr right;
+    };
+
+    class NotNode : public CompiledExpr
+    {
+    public:
+        explicit NotNode(compiled_expr_ptr right) : right{std::move(right)} {}
+
+        Value eval(ExecContext& context) const override { return !isTruthy(right->eval(context)); }
+
+    private:
+        const compiled_expr_ptr right;
+    };
+
+    template <bool IsOr>
+    class LogicalNode : public CompiledExpr
+    {
+    public:
+        LogicalNode(compiled_expr_ptr left, compiled_expr_ptr right)
+            : left{std::move(left)}, right{std::move(right)}
+        {
+        }
+
+        Value eval(ExecContext& context) const override
+        {
+            // Short-circuit with the left operand if it decides the result.
+            auto value = left->eval(context);
+            if (isTruthy(value) == IsOr)
+            {
+                return value;
+            }
+            return right->eval(context);
+        }
+
+    private:
+        const compiled_expr_ptr left;
+        const compiled_expr_ptr right;
+    };
+
+    template <typename Target>
+    class AssignNode : public CompiledExpr
+    {
+    public:
+        AssignNode(Target target, compiled_expr_ptr value)
+            : target{std::move(target)}, value{std::move(value)}
+        {
+        }
+
+        Value eval(ExecContext& context) const override
+        {
+            auto result = value->eval(context);
+            target.set(context, result);
+            return result;
+        }
+
+    private:
+        const Target target;
+        const compiled_expr_ptr value;
+    };
+
+    // Prefix and postfix increment (Delta = 1) and decrement (Delta = -1).
+    template <typename Target, int Delta>
+    class IncrementNode : public CompiledExpr
+    {
+    public:
+        IncrementNode(Target target, Token identifier, bool is_postfix)
+            : target{std::move(target)}, identifier{std::move(identifier)}, is_postfix{is_postfix}
+        {
+        }
+
+        Value eval(ExecContext& context) const override
+        {
+            auto& value = target.get(context);
+            if (!value.isNumber())
+            {
+                throw RuntimeError(identifier, std::string{Delta > 0 ? "Cannot increment"
+                                                                     : "Cannot decrement"} +
+                                                   " a non integer type '" +
+                                                   std::string{identifier.lexeme} + "'.");
+            }
+
+            const double new_value = value.asNumber() + Delta;
+            value = new_value;
+            return is_postfix ? new_value - Delta : new_value;
+        }
+
+    private:
+        const Target target;
+        const Token identifier;
+        const bool is_postfix;
+    };
+
+    class CallNode : public CompiledExpr
+    {
+    public:
+        CallNode(compiled_expr_ptr callee, Token paren, std::vector<compiled_expr_ptr> args)
+            : callee{std::move(callee)}, paren{std::move(paren)}, args{std::move(args)}
+        {
+        }
+
+        Value eval(ExecContext& context) const override
+        {
+            // The callee stays on the call stack during the call, so the garbage collector sees it.
+            // The arguments are pushed above it, a function takes them as the parameter slots of
+            // its frame.
+            auto& call_stack = context.call_stack;
+            const size_t callee_start = call_stack.top();
+            const auto callee_value = callee->eval(context);
+            call_stack.push(callee_value);
+            for (const auto& arg : args)
+            {
+                call_stack.push(arg->eval(context));
+            }
+
+            Value result;
+            if (callee_value.isObjectOf(ObjectType::NODE_FUNCTION))
+            {
+                const auto function = callee_value.as<NodeFunction>();
+                if (function->declaration->arity != args.size())
+                {
+                    throw arityError(function->declaration->arity, args.size());
+                }
+                result = callFunction(context, *function);
+            }
+            else if (callee_value.isObjectOf(ObjectType::NATIVE))
+            {
+                const auto native = callee_value.as<NativeFunction>();
+                if (!native->is_variadic && args.size() != native->arity)
+                {
+                    throw arityError(native->arity, args.size());
+                }
+                result = native->function(call_stack.topValues(args.size()));
+            }
+            else
+            {
+                throw RuntimeError(paren, std::string{paren.lexeme} +
+                                              " is not callable. Callable object must be a "
+                                              "function or a class.");
+            }
+
+            // Release the callee, the arguments and the frame of the callee.
+            call_stack.popTo(callee_start);
+            return result;
+        }
+
+    private:
+        const compiled_expr_ptr callee;
+        const Token paren;
+        const std::vector<compiled_expr_ptr> args;
+
+        RuntimeError arityError(size_t arity, size_t arg_count) const
+        {
+            return RuntimeError(paren, "Expected " + std::to_string(arity) + " arguments but got " +
+                                           std::to_string(arg_count) + " .");
+        }
+    };
+
+    class ListNode : public CompiledExpr
+    {
+    public:
+        explicit ListNode(std::vector<compiled_expr_ptr> items) : items{std::move(items)} {}
+
+        Value eval(ExecContext& context) const override
+        {
+            // The items are kept on the call stack until the list holding them is created.
+            auto& call_stack = context.call_stack;
+            const size_t items_start = call_stack.top();
+            for (const auto& item : items)
+            {
+                call_stack.push(item->eval(context));
+            }
+
+            const auto values = call_stack.topValues(items.size());
+            Value list{
+                context.heap.allocate<List>(std::vector<Value>(values.begin(), values.end()))};
+            call_stack.popTo(items_start);
+            return list;
+        }
+
+    private:
+        const std::vector<compiled_expr_ptr> items;
+    };
+
+    template <typename Target>
+    class SubscriptNode : public CompiledExpr
+    {
+    public:
+        SubscriptNode(Target target, Token identifier, compiled_expr_ptr index,
+                      compiled_expr_ptr value)
+            : target{std::move(target)}, identifier{std::move(identifier)}, index{std::move(index)},
+              value{std::move(value)}
+        {
+        }
+
+        Value eval(ExecContext& context) const override
+        {
+            // Keep the list alive on the call stack even if the index expression reassigns the
+            // variable.
+            const Value items = target.get(context);
+            if (!items.isList())
+            {
+                throw RuntimeError(identifier, "Object '" + std::string{identifier.lexeme} +
+                                                   "' is not subscriptable.");
+            }
+            auto& call_stack = context.call_stack;
+            const size_t top = call_stack.top();
+            call_stack.push(items);
+
+            const auto index_value = index->eval(context);
+            if (!index_value.isNumber() ||
+                static_cast<int>(index_value.asNumber()) != index_value.asNumber())
+            {
+                throw RuntimeError(identifier, "Indices must be integers.");
+            }
+
+            auto list = items.as<List>();
+            double index_cast = index_value.asNumber();
+
+            // Allows negative indexes for reverse order.
+            if (index_cast < 0)
+            {
+                index_cast = static_cast<int>(list->length()) + index_cast;
+            }
+
+            try
+            {
+                if (value)
+                {
+                    const Value new_value = value->eval(context);
+                    list->at(index_cast) = new_value;
+                    context.heap.writeBarrier(list, new_value);
+                }
+                const Value item = list->at(index_cast);
+                call_stack.popTo(top);
+                return item;
+            }
+            catch (const std::out_of_range&)
+            {
+                throw RuntimeError(identifier, "Index out of range. Index is " +
+                                                   std::to_string(static_cast<int>(index_cast)) +
+                                                   " but object size is " +
+                                                   std::to_string(list->length()));
+            }
+        }
+
+    private:
+        const Target target;
+        const Token identifier;
+        const compiled_expr_ptr index;
+        const compiled_expr_ptr value; // OPTIONAL
+    };
+
+    // Statement nodes.
+
+    class ExprStmtNode : public CompiledStmt
+    {
+    public:
+        explicit ExprStmtNode(compiled_expr_ptr expression) : expression{std::move(expression)} {}
+
+        ExecStatus exec(ExecContext& context) const override
+        {
+            expression->eval(context);
+            return ExecStatus::NORMAL;
+        }
+
+    private:
+        const compiled_expr_ptr expression;
+    };
+
+    // Enters the scope of a block or a loop. Only a scope captured by a closure has upvalues to
+    // close when it is left, the closures then keep the values of its variables.
+    template <bool IsCaptured>
+    class ScopeGuard
+    {
+    public:
+        ScopeGuard(ExecContext& context, const ScopeLayout& layout)
+            : context{context}, layout{layout}
+        {
+            context.call_stack.extendFrame(layout.frame_size);
+        }
+
+        ~ScopeGuard()
+        {
+            if constexpr (IsCaptured)
+            {
+                context.call_stack.closeUpvalues(layout.first_slot);
+            }
+        }
+
+    private:
+        ExecContext& context;
+        const ScopeLayout& layout;
+    };
+
+    template <bool IsCaptured>
+    class BlockNode : public CompiledStmt
+    {
+    public:
+        BlockNode(ScopeLayout layout, std::vector<compiled_stmt_ptr> statements)
+            : layout{layout}, statements{std::move(statements)}
+        {
+        }
+
+        ExecStatus exec(ExecContext& context) const override
+        {
+            ScopeGuard<IsCaptured> scope{context, layout};
+            return execAll(statements, context);
+        }
+
+    private:
+        const ScopeLayout layout;
+        const std::vector<compiled_stmt_ptr> statements;
+    };
+
+    class IfNode : public CompiledStmt
+    {
+    public:
+        struct Branch
+        {
+            compiled_expr_ptr condition;
+            compiled_stmt_ptr statement;
+        };
+
+        IfNode(std::vector<Branch> branches, compiled_stmt_ptr else_branch)
+            : branches{std::move(branches)}, else_branch{std::move(else_branch)}
+        {
+        }
+
+        ExecStatus exec(ExecContext& context) const override
+        {
+            // The main branch comes first, followed by the elif branches.
+            for (const auto& branch : branches)
+            {
+                if (isTruthy(branch.condition->eval(context)))
+                {
+                    return branch.statement->exec(context);
+                }
+            }
+            return else_branch ? else_branch->exec(context) : ExecStatus::NORMAL;
+        }
+
+    private:
+        const std::vector<Branch> branches;
+        const compiled_stmt_ptr else_branch; // OPTIONAL
+    };
+
+    class WhileNode : public CompiledStmt
+    {
+    public:
+        WhileNode(compiled_expr_ptr condition, compiled_stmt_ptr body)
+            : condition{std::move(condition)}, body{std::move(body)}
+        {
+        }
+
+        ExecStatus exec(ExecContext& context) const override
+        {
+            while (isTruthy(condition->eval(context)))
+            {
+                const auto status = body->exec(context);
+                if (status == ExecStatus::BREAK)
+                {
+                    break;
+                }
+                if (status == ExecStatus::RETURN)
+                {
+                    return status;
+                }
+            }
+            return ExecStatus::NORMAL;
+        }
+
+    private:
+        const compiled_expr_ptr condition;
+        const compiled_stmt_ptr body;
+    };
+
+    template <bool IsCaptured>
+    class ForNode : public CompiledStmt
+    {
+    public:
+        ForNode(ScopeLayout layout, compiled_stmt_ptr initializer, compiled_expr_ptr condition,
+                compiled_expr_ptr increment, compiled_stmt_ptr body)
+            : layout{layout}, initializer{std::move(initializer)},
+              condition{std::move(condition)}, increment{std::move(increment)},
+              body{std::move(body)}
+        {
+        }
+
+        ExecStatus exec(ExecContext& context) const override
+        {
+            // The loop variable lives in a scope surrounding the loop.
+            ScopeGuard<IsCaptured> scope{context, layout};
+
+            if (initializer)
+            {
+                initializer->exec(context);
+            }
+
+            auto status = ExecStatus::NORMAL;
+            while (!condition || isTruthy(condition->eval(context)))
+            {
+                status = body->exec(context);
+                if (status == ExecStatus::BREAK || status == ExecStatus::RETURN)
+                {
+                    break;
+                }
+                if (increment)
+                {
+                    increment->eval(context);
+                }
+            }
+
+            return status == ExecStatus::RETURN ? status : ExecStatus::NORMAL;
+        }
+
+    private:
+        const ScopeLayout layout;
+        const compiled_stmt_ptr initializer; // OPTIONAL
+        const compiled_expr_ptr condition;   // OPTIONAL
+        const compiled_expr_ptr increment;   // OPTIONAL
+        const compiled_stmt_ptr body;
+    };
+
+    class ReturnNode : public CompiledStmt
+    {
+    public:
+        explicit ReturnNode(compiled_expr_ptr value) : value{std::move(value)} {}
+
+        ExecStatus exec(ExecContext& context) const override
+        {
+            context.return_value = value ? value->eval(context) : Value{};
+            return ExecStatus::RETURN;
+        }
+
+    private:
+        const compiled_expr_ptr value; // OPTIONAL
+    };
+
+    // Finishes with a fixed status: break, continue, or a no-op.
+    template <ExecStatus Status>
+    class StatusNode : public CompiledStmt
+    {
+    public:
+        ExecStatus exec(ExecContext&) const override { return Status; }
+    };
+
+    using enum VariableSlot::Storage;
+
+    // Defines a variable or a function in its slot of the call frame or, at the top level, as a
+    // global. Like the interpreter, redeclaring a global keeps its first value.
+    template <VariableSlot::Storage Storage>
+    void define(ExecContext& context, size_t slot, Value value)
+    {
+        if constexpr (Storage == GLOBAL)
+        {
+            auto& global = context.globals[slot];
+            if (!global.is_defined)
+            {
+                global.value = std::move(value);
+                global.is_defined = true;
+            }
+        }
+        else
+        {
+            context.call_stack.local(slot) = std::move(value);
+        }
+    }
+
+    template <VariableSlot::Storage Storage>
+    class VarNode : public CompiledStmt
+    {
+    public:
+        VarNode(size_t slot, compiled_expr_ptr initializer)
+            : slot{slot}, initializer{std::move(initializer)}
+        {
+        }
+
+        ExecStatus exec(ExecContext& context) const override
+        {
+            define<Storage>(context, slot, initializer ? initializer->eval(context) : Value{});
+            return ExecStatus::NORMAL;
+        }
+
+    private:
+        const size_t slot;
+        const compiled_expr_ptr initializer; // OPTIONAL
+    };
+
+    template <VariableSlot::Storage Storage>
+    class FnNode : public CompiledStmt
+    {
+    public:
+        FnNode(size_t slot, FunctionNode function) : slot{slot}, function{std::move(function)} {}
+
+        ExecStatus exec(ExecContext& context) const override
+        {
+            // Variables of the enclosing function are captured from its frame, the others are
+            // already upvalues of it.
+            std::vector<Value> upvalues;
+            upvalues.reserve(function.upvalues.size());
+            for (const auto& upvalue : function.upvalues)
+            {
+                upvalues.push_back(upvalue.is_local
+                                       ? context.call_stack.captureUpvalue(upvalue.index)
+                                       : (*context.upvalues)[upvalue.index]);
+            }
+
+            define<Storage>(context, slot,
+                            context.heap.allocate<NodeFunction>(&function, std::move(upvalues)));
+            return ExecStatus::NORMAL;
+        }
+
+    private:
+        const size_t slot;
+        const FunctionNode function;
+    };
+
+    // Instantiates Node<GlobalOperand>, Node<FrameOperand> or Node<UpvalueOperand> for the
+    // variable in the given slot.
+    template <template <typename> class Node, typename... Args>
+    compiled_expr_ptr makeVariableNode(const Token& identifier, const VariableSlot& slot,
+                                       size_t global_index, Args&&... args)
+    {
+        switch (slot.storage)
+        {
+        case FRAME:
+            return std::make_unique<Node<FrameOperand>>(FrameOperand{slot.index},
+                                                        std::forward<Args>(args)...);
+        case UPVALUE:
+            return std::make_unique<Node<UpvalueOperand>>(UpvalueOperand{slot.index},
+                                                          std::forward<Args>(args)...);
+        default:
+            return std::make_unique<Node<GlobalOperand>>(GlobalOperand{identifier, global_index},
+                                                         std::forward<Args>(args)...);
+        }
+    }
+
+    // Instantiates Node<true> for a captured scope and Node<false> otherwise.
+    template <template <bool> class Node, typename... Args>
+    compiled_stmt_ptr makeScopeNode(const ScopeLayout& layout, Args&&... args)
+    {
+        if (layout.is_captured)
+        {
+            return std::make_unique<Node<true>>(layout, std::forward<Args>(args)...);
+        }
+        return std::make_unique<Node<false>>(layout, std::forward<Args>(args)...);
+    }
+
+    // Instantiates Node<Storage> for the declaration in the given slot, globals use their index.
+    // Declarations are always in the frame of the declaring function or global.
+    template <template <VariableSlot::Storage> class Node, typename... Args>
+    compiled_stmt_ptr makeDeclarationNode(const VariableSlot& slot, size_t global_index,
+                                          Args&&... args)
+    {
+        if (slot.storage == FRAME)
+        {
+            return std::make_unique<Node<FRAME>>(slot.index, std::forward<Args>(args)...);
+        }
+        return std::make_unique<Node<GLOBAL>>(global_index, std::forward<Args>(args)...);
+    }
+
+    template <int Delta>
+    struct IncrementNodeOf
+    {
+        template <typename Target>
+        using type = IncrementNode<Target, Delta>;
+    };
+}
+
+NodeProgram ClosureCompiler::compile(const ast_vector<unique_stmt_ptr>& statements)
+{
+    auto compiled = compileAll(statements);
+    return NodeProgram{std::move(compiled), std::move(globals)};
+}
+
+compiled_expr_ptr ClosureCompiler::compile(const Expr& expr)
+{
+    expr.accept(*this);
+    return std::move(expr_node);
+}
+
+compiled_stmt_ptr ClosureCompiler::compile(const Stmt& stmt)
+{
+    stmt.accept(*this);
+    return std::move(stmt_node);
+}
+
+std::vector<compiled_stmt_ptr> ClosureCompiler::compileAll(
+    const ast_vector<unique_stmt_ptr>& statements)
+{
+    std::vector<compiled_stmt_ptr> compiled;
+    compiled.reserve(statements.size());
+    for (const auto& stmt : statements)
+    {
+        assert(stmt);
+        compiled.push_back(compile(*stmt));
+    }
+    return compiled;
+}
+
+size_t ClosureCompiler::globalIndex(const Token& identifier)
+{
+    // Every distinct global name is given the next free index.
+    auto [global, inserted] = global_indices.try_emplace(identifier.lexeme, globals.size());
+    if (inserted)
+    {
+        globals.emplace_back(identifier.lexeme);
+    }
+    return global->second;
+}
+
+Value ClosureCompiler::visit(const BinaryExpr& expr)
+{
+    using enum TokenType;
+
+    // Literals and local variables in the call frame are read by the binary node itself.
+    auto operand = [this](const Expr& operand_expr) -> Operand
+    {
+        if (const auto literal = dynamic_cast<const LiteralExpr*>(&operand_expr))
+        {
+            return ConstantOperand{literal->literal};
+        }
+        if (const auto variable = dynamic_cast<const VarExpr*>(&operand_expr);
+            variable && variable->slot.storage == FRAME)
+        {
+            return FrameOperand{variable->slot.index};
+        }
+        return NodeOperand{compile(operand_expr)};
+    };
+
+    auto lhs = operand(*expr.left);
+    auto rhs = operand(*expr.right);
+
+    switch (expr.op.type)
+    {
+    case PLUS:
+        expr_node = makeBinary<AddOp>(expr.op, std::move(lhs), std::move(rhs));
+        break;
+    case MINUS:
+        expr_node = makeBinary<SubtractOp>(expr.op, std::move(lhs), std::move(rhs));
+        break;
+    case STAR:
+        expr_node = makeBinary<MultiplyOp>(expr.op, std::move(lhs), std::move(rhs));
+        break;
+    case SLASH:
+        expr_node = makeBinary<DivideOp>(expr.op, std::move(lhs), std::move(rhs));
+        break;
+    case GREATER:
+        expr_node = makeBinary<GreaterOp>(expr.op, std::move(lhs), std::move(rhs));
+        break;
+    case GREATER_EQUAL:
+        expr_node = makeBinary<GreaterEqualOp>(expr.op, std::move(lhs), std::move(rhs));
+        break;
+    case LESS:
+        expr_node = makeBinary<LessOp>(expr.op, std::move(lhs), std::move(rhs));
+        break;
+    case LESS_EQUAL:
+        expr_node = makeBinary<LessEqualOp>(expr.op, std::move(lhs), std::move(rhs));
+        break;
+    case EQUAL_EQUAL:
+        expr_node = makeBinary<EqualOp>(expr.op, std::move(lhs), std::move(rhs));
+        break;
+    case EXCLAMATION_EQUAL:
+        expr_node = makeBinary<NotEqualOp>(expr.op, std::move(lhs), std::move(rhs));
+        break;
+    default:
+        expr_node = std::make_unique<OperandNode<ConstantOperand>>(ConstantOperand{});
+        break;
+    }
+    return {};
+}
+
+Value ClosureCompiler::visit(const UnaryExpr& expr)
+{
+    auto right = compile(*expr.right);
+    switch (expr.op.type)
+    {
+    case TokenType::MINUS:
+        expr_node = std::make_unique<NegateNode>(expr.op, std::move(right));
+        break;
+    case TokenType::EXCLAMATION:
+        expr_node = std::make_unique<NotNode>(std::move(right));
+        break;
+    default:
+        expr_node = std::make_unique<OperandNode<ConstantOperand>>(ConstantOperand{});
+        break;
+    }
+    return {};
+}
+
+Value ClosureCompiler::visit(const GroupingExpr& expr)
+{
+    expr_node = compile(*expr.expression);
+    return {};
+}
+
+Value ClosureCompiler::visit(const LiteralExpr& expr)
+{
+    expr_node = std::make_unique<OperandNode<ConstantOperand>>(ConstantOperand{expr.literal});
+    return {};
+}
+
+Value ClosureCompiler::visit(const AssignExpr& expr)
+{
+    auto value = compile(*expr.value);
+    const size_t global_index = expr.slot.storage == GLOBAL ? globalIndex(expr.identifier) : 0u;
+    expr_node = makeVariableNode<AssignNode>(expr.identifier, expr.slot, global_index,
+                                             std::move(value));
+    return {};
+}
+
+Value ClosureCompiler::visit(const CallExpr& expr)
+{
+    auto callee = compile(*expr.callee);
+    std::vector<compiled_expr_ptr> args;
+    args.reserve(expr.args.size());
+    for (const auto& arg : expr.args)
+    {
+        args.push_back(compile(*arg));
+    }
+    expr_node = std::make_unique<CallNode>(std::move(callee), expr.paren, std::move(args));
+    return {};
+}
+
+Value ClosureCompiler::visit(const SetExpr& expr)
+{
+    expr_node = std::make_unique<OperandNode<ConstantOperand>>(ConstantOperand{});
+    return {};
+}
+
+Value ClosureCompiler::visit(const GetExpr& expr)
+{
+    expr_node = std::make_unique<OperandNode<ConstantOperand>>(ConstantOperand{});
+    return {};
+}
+
+Value ClosureCompiler::visit(const SuperExpr& expr)
+{
+    expr_node = std::make_unique<OperandNode<ConstantOperand>>(ConstantOperand{});
+    return {};
+}
+
+Value ClosureCompiler::visit(const LogicalExpr& expr)
+{
+    auto left = compile(*expr.left);
+    auto right = compile(*expr.right);
+    if (expr.op.type == TokenType::OR)
+    {
+        expr_node = std::make_unique<LogicalNode<true>>(std::move(left), std::move(right));
+    }
+    else
+    {
+        expr_node = std::make_unique<LogicalNode<false>>(std::move(left), std::move(right));
+    }
+    return {};
+}
+
+Value ClosureCompiler::visit(const ThisExpr& expr)
+{
+    expr_node = std::make_unique<OperandNode<ConstantOperand>>(ConstantOperand{});
+    return {};
+}
+
+Value ClosureCompiler::visit(const VarExpr& expr)
+{
+    const size_t global_index = expr.slot.storage == GLOBAL ? globalIndex(expr.identifier) : 0u;
+    expr_node = makeVariableNode<OperandNode>(expr.identifier, expr.slot, global_index);
+    return {};
+}
+
+Value ClosureCompiler::visit(const ListExpr& expr)
+{
+    std::vector<compiled_expr_ptr> items;
+    items.reserve(expr.items.size());
+    for (const auto& item : expr.items)
+    {
+        assert(item);
+        items.push_back(compile(*item));
+    }
+    expr_node = std::make_unique<ListNode>(std::move(items));
+    return {};
+}
+
+Value ClosureCompiler::visit(const SubscriptExpr& expr)
+{
+    auto index = compile(*expr.index);
+    auto value = expr.value ? compile(*expr.value) : nullptr;
+    const size_t global_index = expr.slot.storage == GLOBAL ? globalIndex(expr.identifier) : 0u;
+    expr_node = makeVariableNode<SubscriptNode>(expr.identifier, expr.slot, global_index,
+                                                expr.identifier, std::move(index),
+                                                std::move(value));
+    return {};
+}
+
+Value ClosureCompiler::visit(const IncrementExpr& expr)
+{
+    const size_t global_index = expr.slot.storage == GLOBAL ? globalIndex(expr.identifier) : 0u;
+    expr_node = makeVariableNode<IncrementNodeOf<1>::type>(
+        expr.identifier, expr.slot, global_index, expr.identifier,
+        expr.type == IncrementExpr::Type::POSTFIX);
+    return {};
+}
+
+Value ClosureCompiler::visit(const DecrementExpr& expr)
+{
+    const size_t global_index = expr.slot.storage == GLOBAL ? globalIndex(expr.identifier) : 0u;
+    expr_node = makeVariableNode<IncrementNodeOf<-1>::type>(
+        expr.identifier, expr.slot, global_index, expr.identifier,
+        expr.type == DecrementExpr::Type::POSTFIX);
+    return {};
+}
+
+void ClosureCompiler::visit(const BlockStmt& stmt)
+{
+    stmt_node = makeScopeNode<BlockNode>(stmt.layout, compileAll(stmt.statements));
+}
+
+void ClosureCompiler::visit(const ClassStmt& stmt)
+{
+    stmt_node = std::make_unique<StatusNode<ExecStatus::NORMAL>>();
+}
+
+void ClosureCompiler::visit(const ExprStmt& stmt)
+{
+    stmt_node = std::make_unique<ExprStmtNode>(compile(*stmt.expression));
+}
+
+void ClosureCompiler::visit(const FnStmt& stmt)
+{
+    FunctionNode function{std::string{stmt.identifier.lexeme},
+                          stmt.params.size(),
+                          stmt.layout,
+                          {stmt.upvalues.begin(), stmt.upvalues.end()},
+                          compileAll(stmt.body)};
+
+    const size_t global_index = stmt.slot.storage == GLOBAL ? globalIndex(stmt.identifier) : 0u;
+    stmt_node = makeDeclarationNode<FnNode>(stmt.slot, global_index, std::move(function));
+}
+
+void ClosureCompiler::visit(const IfStmt& stmt)
+{
+    std::vector<IfNode::Branch> branches;
+    branches.reserve(stmt.elif_branches.size() + 1u);
+    branches.push_back(
+        {compile(*stmt.main_branch.condition), compile(*stmt.main_branch.statement)});
+    for (const auto& elif : stmt.elif_branches)
+    {
+        branches.push_back({compile(*elif.condition), compile(*elif.statement)});
+    }
+
+    auto else_branch = stmt.else_branch ? compile(*stmt.else_branch) : nullptr;
+    stmt_node = std::make_unique<IfNode>(std::move(branches), std::move(else_branch));
+}
+
+void ClosureCompiler::visit(const PrintStmt& stmt)
+{
+    stmt_node = std::make_unique<ExprStmtNode>(compile(*stmt.expression));
+}
+
+void ClosureCompiler::visit(const ReturnStmt& stmt)
+{
+    stmt_node = std::make_unique<ReturnNode>(stmt.expression ? compile(*stmt.expression) : nullptr);
+}
+
+void ClosureCompiler::visit(const BreakStmt& stmt)
+{
+    stmt_node = std::make_unique<StatusNode<ExecStatus::BREAK>>();
+}
+
+void ClosureCompiler::visit(const ContinueStmt& stmt)
+{
+    stmt_node = std::make_unique<StatusNode<ExecStatus::CONTINUE>>();
+}
+
+void ClosureCompiler::visit(const VarStmt& stmt)
+{
+    auto initializer = stmt.initializer ? compile(*stmt.initializer) : nullptr;
+    const size_t global_index = stmt.slot.storage == GLOBAL ? globalIndex(stmt.identifier) : 0u;
+    stmt_node = makeDeclarationNode<VarNode>(stmt.slot, global_index, std::move(initializer));
+}
+
+void ClosureCompiler::visit(const WhileStmt& stmt)
+{
+    auto condition = compile(*stmt.condition);
+    stmt_node = std::make_unique<WhileNode>(std::move(condition), compile(*stmt.body));
+}
+
+void ClosureCompiler::visit(const ForStmt& stmt)
+{
+    auto initializer = stmt.initializer ? compile(*stmt.initializer) : nullptr;
+    auto condition = stmt.condition ? compile(*stmt.condition) : nullptr;
+    auto increment = stmt.increment ? compile(*stmt.increment) : nullptr;
+    auto body = compile(*stmt.body);
+
+    stmt_node = makeScopeNode<ForNode>(stmt.layout, std::move(initializer), std::move(condition),
+                                       std::move(increment), std::move(body));
+}
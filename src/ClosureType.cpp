@@ -0,0 +1,101 @@
+#include "../include/ClosureType.hpp"
+#include "../include/Heap.hpp"
+#include <algorithm>
+#include <utility>
+
+CompiledFunction::CompiledFunction(std::string name, size_t arity)
+    : Object{ObjectType::FUNCTION}, name{std::move(name)}, arity{arity}
+{
+}
+
+std::string CompiledFunction::toString() const
+{
+    return name.empty() ? "<script>" : "<fn " + name + ">";
+}
+
+Upvalue::Upvalue(Value* location) : Object{ObjectType::UPVALUE}, location{location}
+{
+}
+
+void Upvalue::trace(Heap& heap) const
+{
+    // The variable of an open upvalue is still on a stack, which is a root.
+    heap.mark(closed);
+    heap.mark(next);
+}
+
+Value OpenUpvalues::capture(Heap& heap, Value* local)
+{
+    Value* previous = &head;
+    while (!previous->isNil() && previous->as<Upvalue>()->location > local)
+    {
+        previous = &previous->as<Upvalue>()->next;
+    }
+
+    if (!previous->isNil() && previous->as<Upvalue>()->location == local)
+    {
+        return *previous;
+    }
+
+    Value upvalue{heap.allocate<Upvalue>(local)};
+    upvalue.as<Upvalue>()->next = std::move(*previous);
+    *previous = upvalue;
+    return upvalue;
+}
+
+void OpenUpvalues::close(Heap& heap, const Value* last)
+{
+    while (!head.isNil() && head.as<Upvalue>()->location >= last)
+    {
+        auto upvalue = head.as<Upvalue>();
+        upvalue->closed = std::move(*upvalue->location);
+        upvalue->location = &upvalue->closed;
+        heap.writeBarrier(upvalue, upvalue->closed);
+
+        head = std::exchange(upvalue->next, Value{});
+    }
+}
+
+void OpenUpvalues::mark(Heap& heap) const
+{
+    for (const Value* upvalue = &head; !upvalue->isNil(); upvalue = &upvalue->as<Upvalue>()->next)
+    {
+        heap.mark(*upvalue);
+    }
+}
+
+const Value* OpenUpvalues::reserve(std::vector<Value>& stack, size_t size)
+{
+    const Value* previous_data = stack.data();
+    if (size > stack.size())
+    {
+        // Grow geometrically, so deepening recursion allocates rarely.
+        stack.resize(std::max(size, stack.size() * 2u));
+        for (Value* upvalue = &head; !upvalue->isNil(); upvalue = &upvalue->as<Upvalue>()->next)
+        {
+            auto& location = upvalue->as<Upvalue>()->location;
+            location = stack.data() + (location - previous_data);
+        }
+    }
+    return previous_data;
+}
+
+Closure::Closure(CompiledFunction* function)
+    : Object{ObjectType::CLOSURE}, function{function}, upvalues(function->upvalue_count)
+{
+}
+
+void Closure::trace(Heap& heap) const
+{
+    // The compiled function belongs to the compiled program.
+    for (const auto& upvalue : upvalues)
+    {
+        heap.mark(upvalue);
+    }
+}
+
+NativeFunction::NativeFunction(std::string name, size_t arity, bool is_variadic, NativeFn function)
+    : Object{ObjectType::NATIVE}, name{std::move(name)}, arity{arity}, is_variadic{is_variadic},
+      function{function}
+{
+}
@@ -0,0 +1,861 @@
+#include "../include/Compiler.hpp"
+#include "../include/BytecodeVerifier.hpp"
+#include "../include/Logger.hpp"
+#include "../include/StringTable.hpp"
+#include <bit>
+#include <limits>
+
+namespace
+{
+    // Locals and upvalues are addressed by a single byte operand.
+    constexpr size_t MAX_SLOTS = std::numeric_limits<uint8_t>::max() + 1u;
+    // Constants, globals and jump offsets are addressed by a two byte operand.
+    constexpr size_t MAX_SHORT = std::numeric_limits<uint16_t>::max();
+    // Literals beyond the reach of a two byte operand are loaded by CONSTANT_LONG.
+    constexpr size_t MAX_LONG = (size_t{1u} << 24u) - 1u;
+}
+
+std::optional<CompiledProgram> Compiler::compile(const ast_vector<unique_stmt_ptr>& statements)
+{
+    // The top-level code is compiled as the body of a function without a name.
+    FunctionState script{nullptr, create<CompiledFunction>("", 0u)};
+    current = &script;
+
+    // Slot zero of every call frame holds the function being called.
+    script.locals.push_back(Local{"", 0u});
+
+    for (const auto& stmt : statements)
+    {
+        assert(stmt);
+        compile(*stmt);
+    }
+    emitOp(OpCode::NIL);
+    emitOp(OpCode::RETURN);
+    sizeFrame(*script.function.as<CompiledFunction>());
+
+    current = nullptr;
+
+    if (had_error)
+    {
+        return std::nullopt;
+    }
+    return CompiledProgram{std::move(script.function), std::move(globals), std::move(objects)};
+}
+
+void Compiler::compile(const Stmt& stmt)
+{
+    stmt.accept(*this);
+}
+
+void Compiler::compile(const Expr& expr)
+{
+    expr.accept(*this);
+}
+
+void Compiler::compileFunction(const FnStmt& stmt)
+{
+    FunctionState state{current, create<CompiledFunction>(std::string{stmt.identifier.lexeme},
+                                                          stmt.params.size())};
+    current = &state;
+    state.locals.push_back(Local{"", 0u});
+
+    // Parameters are the first locals of the function, right after the callee. The call frame is
+    // discarded as a whole on return, so the function scope is never ended.
+    beginScope();
+    for (const auto& param : stmt.params)
+    {
+        addLocal(param);
+    }
+    for (const auto& body_stmt : stmt.body)
+    {
+        assert(body_stmt);
+        compile(*body_stmt);
+    }
+
+    // Functions without a return statement return nil.
+    emitOp(OpCode::NIL);
+    emitOp(OpCode::RETURN);
+
+    current = state.enclosing;
+
+    auto function = state.function.as<CompiledFunction>();
+    function->upvalue_count = state.upvalues.size();
+    sizeFrame(*function);
+
+    // Wrap the function in a closure at runtime, capturing the variables it refers to.
+    emitOp(OpCode::CLOSURE);
+    emitShort(makeConstant(std::move(state.function)));
+    for (const auto& upvalue : state.upvalues)
+    {
+        emitByte(upvalue.is_local ? 1u : 0u);
+        emitByte(upvalue.index);
+    }
+}
+
+void Compiler::sizeFrame(CompiledFunction& function) const
+{
+    // The code of a program with errors is left unfinished and never run.
+    if (!had_error)
+    {
+        function.max_stack_height = BytecodeVerifier::verify(function, globals.size());
+    }
+}
+
+Chunk& Compiler::currentChunk() const noexcept
+{
+    return current->function.as<CompiledFunction>()->chunk;
+}
+
+void Compiler::emitByte(uint8_t byte)
+{
+    currentChunk().write(byte, line);
+}
+
+void Compiler::emitOp(OpCode op)
+{
+    emitByte(static_cast<uint8_t>(op));
+}
+
+void Compiler::emitShort(uint16_t value)
+{
+    emitByte(static_cast<uint8_t>(value >> 8u));
+    emitByte(static_cast<uint8_t>(value & 0xffu));
+}
+
+void Compiler::emitConstant(Value value)
+{
+    const size_t constant = addConstant(std::move(value));
+    if (constant <= MAX_SHORT)
+    {
+        emitOp(OpCode::CONSTANT);
+        emitShort(static_cast<uint16_t>(constant));
+    }
+    else if (constant <= MAX_LONG)
+    {
+        emitOp(OpCode::CONSTANT_LONG);
+        emitByte(static_cast<uint8_t>(constant >> 16u));
+        emitShort(static_cast<uint16_t>(constant & 0xffffu));
+    }
+    else
+    {
+        tooManyConstants();
+    }
+}
+
+size_t Compiler::emitJump(OpCode op)
+{
+    // Emit a placeholder offset which is patched once the jump target is known.
+    emitOp(op);
+    emitShort(0xffffu);
+    return currentChunk().code.size() - 2u;
+}
+
+void Compiler::patchJump(size_t offset)
+{
+    // Jump over the operand and everything emitted after it.
+    auto& code = currentChunk().code;
+    const size_t jump = code.size() - offset - 2u;
+    if (jump > MAX_SHORT)
+    {
+        error("Too much code to jump over.");
+    }
+
+    code[offset] = static_cast<uint8_t>((jump >> 8u) & 0xffu);
+    code[offset + 1u] = static_cast<uint8_t>(jump & 0xffu);
+}
+
+void Compiler::emitLoop(size_t loop_start)
+{
+    emitOp(OpCode::LOOP);
+
+    // Jump back over the operand and the loop body.
+    const size_t offset = currentChunk().code.size() - loop_start + 2u;
+    if (offset > MAX_SHORT)
+    {
+        error("Loop body too large.");
+    }
+    emitShort(static_cast<uint16_t>(offset));
+}
+
+size_t Compiler::addConstant(Value value)
+{
+    std::unordered_map<uint64_t, size_t>* numbers = nullptr;
+    std::unordered_map<const Object*, size_t>* strings = nullptr;
+    uint64_t number_bits = 0u;
+    if (value.isNumber())
+    {
+        numbers = &current->number_constants;
+        number_bits = std::bit_cast<uint64_t>(value.asNumber());
+        if (const auto constant = numbers->find(number_bits); constant != numbers->end())
+        {
+            return constant->second;
+        }
+    }
+    else if (value.isString())
+    {
+        strings = &current->string_constants;
+        if (const auto constant = strings->find(value.asObject()); constant != strings->end())
+        {
+            return constant->second;
+        }
+    }
+
+    const Object* object = value.isObject() ? value.asObject() : nullptr;
+    const size_t constant = currentChunk().addConstant(std::move(value));
+    if (numbers)
+    {
+        numbers->emplace(number_bits, constant);
+    }
+    else if (strings)
+    {
+        strings->emplace(object, constant);
+    }
+    return constant;
+}
+
+uint16_t Compiler::makeConstant(Value value)
+{
+    const size_t constant = addConstant(std::move(value));
+    if (constant > MAX_SHORT)
+    {
+        tooManyConstants();
+        return 0u;
+    }
+    return static_cast<uint16_t>(constant);
+}
+
+void Compiler::tooManyConstants()
+{
+    // Every later constant of the chunk would fail the same way.
+    if (!current->has_too_many_constants)
+    {
+        current->has_too_many_constants = true;
+        error("Too many constants in one chunk.");
+    }
+}
+
+uint16_t Compiler::nameConstant(const Token& identifier)
+{
+    // Names are only needed by the VM for error messages.
+    return makeConstant(StringTable::intern(identifier.lexeme));
+}
+
+uint16_t Compiler::globalIndex(const Token& identifier)
+{
+    // Every distinct global name is given the next free index.
+    auto [global, inserted] =
+        global_indices.try_emplace(identifier.lexeme, static_cast<uint16_t>(globals.size()));
+    if (inserted)
+    {
+        if (globals.size() > MAX_SHORT)
+        {
+            error("Too many global variables.");
+        }
+        globals.emplace_back(identifier.lexeme);
+    }
+    return global->second;
+}
+
+void Compiler::beginScope()
+{
+    ++current->scope_depth;
+}
+
+void Compiler::endScope()
+{
+    --current->scope_depth;
+    discardLocals(current->scope_depth);
+
+    // Forget the locals of the scope.
+    auto& locals = current->locals;
+    while (!locals.empty() && locals.back().depth > current->scope_depth)
+    {
+        locals.pop_back();
+    }
+}
+
+void Compiler::discardLocals(size_t depth)
+{
+    // Pop every local deeper than the given scope depth off the stack, moving the captured ones to
+    // the heap. The compile-time locals are left untouched, so this is also used for jumping out of
+    // a loop body.
+    const auto& locals = current->locals;
+    for (auto local = locals.rbegin(); local != locals.rend() && local->depth > depth; ++local)
+    {
+        emitOp(local->is_captured ? OpCode::CLOSE_UPVALUE : OpCode::POP);
+    }
+}
+
+void Compiler::addLocal(const Token& identifier)
+{
+    if (current->locals.size() == MAX_SLOTS)
+    {
+        error("Too many local variables in function.");
+        return;
+    }
+    current->locals.push_back(Local{identifier.lexeme, current->scope_depth});
+}
+
+std::optional<uint8_t> Compiler::resolveLocal(const FunctionState& state,
+                                              std::string_view name) const
+{
+    // Look for the variable starting from the innermost scope. The Resolver has already rejected
+    // programs reading a local in its own initializer, so every local found here is defined.
+    for (size_t slot = state.locals.size(); slot-- > 0u;)
+    {
+        if (state.locals[slot].name == name)
+        {
+            return static_cast<uint8_t>(slot);
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<uint8_t> Compiler::resolveUpvalue(FunctionState& state, std::string_view name)
+{
+    // Top-level code has no enclosing function to capture variables from.
+    if (!state.enclosing)
+    {
+        return std::nullopt;
+    }
+
+    // Capture a local of the directly enclosing function...
+    if (auto local = resolveLocal(*state.enclosing, name))
+    {
+        state.enclosing->locals[*local].is_captured = true;
+        return addUpvalue(state, *local, true);
+    }
+
+    // ... or an upvalue the enclosing function has itself captured.
+    if (auto upvalue = resolveUpvalue(*state.enclosing, name))
+    {
+        return addUpvalue(state, *upvalue, false);
+    }
+
+    return std::nullopt;
+}
+
+uint8_t Compiler::addUpvalue(FunctionState& state, uint8_t index, bool is_local)
+{
+    // Reuse the upvalue if the function already captures the variable.
+    auto& upvalues = state.upvalues;
+    for (size_t i = 0u; i < upvalues.size(); ++i)
+    {
+        if (upvalues[i].index == index && upvalues[i].is_local == is_local)
+        {
+            return static_cast<uint8_t>(i);
+        }
+    }
+
+    if (upvalues.size() == MAX_SLOTS)
+    {
+        error("Too many closure variables in function.");
+        return 0u;
+    }
+
+    upvalues.push_back(UpvalueRef{index, is_local});
+    return static_cast<uint8_t>(upvalues.size() - 1u);
+}
+
+void Compiler::emitGetVariable(const Token& identifier)
+{
+    line = identifier.line;
+    if (auto local = resolveLocal(*current, identifier.lexeme))
+    {
+        emitOp(OpCode::GET_LOCAL);
+        emitByte(*local);
+    }
+    else if (auto upvalue = resolveUpvalue(*current, identifier.lexeme))
+    {
+        emitOp(OpCode::GET_UPVALUE);
+        emitByte(*upvalue);
+    }
+    else
+    {
+        emitOp(OpCode::GET_GLOBAL);
+        emitShort(globalIndex(identifier));
+    }
+}
+
+void Compiler::emitSetVariable(const Token& identifier)
+{
+    line = identifier.line;
+    if (auto local = resolveLocal(*current, identifier.lexeme))
+    {
+        emitOp(OpCode::SET_LOCAL);
+        emitByte(*local);
+    }
+    else if (auto upvalue = resolveUpvalue(*current, identifier.lexeme))
+    {
+        emitOp(OpCode::SET_UPVALUE);
+        emitByte(*upvalue);
+    }
+    else
+    {
+        emitOp(OpCode::SET_GLOBAL);
+        emitShort(globalIndex(identifier));
+    }
+}
+
+void Compiler::error(const std::string& message)
+{
+    Error::addError(line, "", message);
+    had_error = true;
+}
+
+Value Compiler::visit(const BinaryExpr& expr)
+{
+    using enum TokenType;
+
+    compile(*expr.left);
+    compile(*expr.right);
+
+    line = expr.op.line;
+    switch (expr.op.type)
+    {
+    case EQUAL_EQUAL:
+        emitOp(OpCode::EQUAL);
+        break;
+    case EXCLAMATION_EQUAL:
+        emitOp(OpCode::EQUAL);
+        emitOp(OpCode::NOT);
+        break;
+    case PLUS:
+        emitOp(OpCode::ADD);
+        break;
+    case MINUS:
+        emitOp(OpCode::SUBTRACT);
+        break;
+    case SLASH:
+        emitOp(OpCode::DIVIDE);
+        break;
+    case STAR:
+        emitOp(OpCode::MULTIPLY);
+        break;
+    case GREATER:
+        emitOp(OpCode::GREATER);
+        break;
+    case GREATER_EQUAL:
+        emitOp(OpCode::GREATER_EQUAL);
+        break;
+    case LESS:
+        emitOp(OpCode::LESS);
+        break;
+    case LESS_EQUAL:
+        emitOp(OpCode::LESS_EQUAL);
+        break;
+    default:
+        // The interpreter evaluates unknown binary operators to nil.
+        emitOp(OpCode::POP);
+        emitOp(OpCode::POP);
+        emitOp(OpCode::NIL);
+        break;
+    }
+    return {};
+}
+
+Value Compiler::visit(const UnaryExpr& expr)
+{
+    compile(*expr.right);
+
+    line = expr.op.line;
+    switch (expr.op.type)
+    {
+    case TokenType::MINUS:
+        emitOp(OpCode::NEGATE);
+        break;
+    case TokenType::EXCLAMATION:
+        emitOp(OpCode::NOT);
+        break;
+    default:
+        emitOp(OpCode::POP);
+        emitOp(OpCode::NIL);
+        break;
+    }
+    return {};
+}
+
+Value Compiler::visit(const GroupingExpr& expr)
+{
+    compile(*expr.expression);
+    return {};
+}
+
+Value Compiler::visit(const LiteralExpr& expr)
+{
+    const auto& literal = expr.literal;
+    if (literal.isNil())
+    {
+        emitOp(OpCode::NIL);
+    }
+    else if (literal.isBool())
+    {
+        emitOp(literal.asBool() ? OpCode::_TRUE : OpCode::_FALSE);
+    }
+    else
+    {
+        emitConstant(literal);
+    }
+    return {};
+}
+
+Value Compiler::visit(const AssignExpr& expr)
+{
+    // The assigned value is left on the stack as the result of the expression.
+    compile(*expr.value);
+    emitSetVariable(expr.identifier);
+    return {};
+}
+
+Value Compiler::visit(const CallExpr& expr)
+{
+    compile(*expr.callee);
+    for (const auto& arg : expr.args)
+    {
+        compile(*arg);
+    }
+
+    line = expr.paren.line;
+    // The Parser already limits calls to 254 arguments, so this only guards the operand.
+    if (expr.args.size() >= MAX_SLOTS)
+    {
+        error("Too many arguments in a call.");
+    }
+    emitOp(OpCode::CALL);
+    emitByte(static_cast<uint8_t>(expr.args.size()));
+    return {};
+}
+
+Value Compiler::visit(const SetExpr& expr)
+{
+    emitOp(OpCode::NIL);
+    return {};
+}
+
+Value Compiler::visit(const GetExpr& expr)
+{
+    emitOp(OpCode::NIL);
+    return {};
+}
+
+Value Compiler::visit(const SuperExpr& expr)
+{
+    emitOp(OpCode::NIL);
+    return {};
+}
+
+Value Compiler::visit(const LogicalExpr& expr)
+{
+    compile(*expr.left);
+
+    if (expr.op.type == TokenType::OR)
+    {
+        // Short-circuit with the left operand if it is truthy.
+        const size_t else_jump = emitJump(OpCode::JUMP_IF_FALSE);
+        const size_t end_jump = emitJump(OpCode::JUMP);
+        patchJump(else_jump);
+        emitOp(OpCode::POP);
+        compile(*expr.right);
+        patchJump(end_jump);
+    }
+    else
+    {
+        // Short-circuit with the left operand if it is falsy.
+        const size_t end_jump = emitJump(OpCode::JUMP_IF_FALSE);
+        emitOp(OpCode::POP);
+        compile(*expr.right);
+        patchJump(end_jump);
+    }
+    return {};
+}
+
+Value Compiler::visit(const ThisExpr& expr)
+{
+    emitOp(OpCode::NIL);
+    return {};
+}
+
+Value Compiler::visit(const VarExpr& expr)
+{
+    emitGetVariable(expr.identifier);
+    return {};
+}
+
+Value Compiler::visit(const ListExpr& expr)
+{
+    for (const auto& item : expr.items)
+    {
+        assert(item);
+        compile(*item);
+    }
+
+    line = expr.opening_bracket.line;
+    if (expr.items.size() >= MAX_SLOTS)
+    {
+        error("Too many items in a list literal.");
+    }
+    emitOp(OpCode::LIST);
+    emitByte(static_cast<uint8_t>(expr.items.size()));
+    return {};
+}
+
+Value Compiler::visit(const SubscriptExpr& expr)
+{
+    emitGetVariable(expr.identifier);
+    compile(*expr.index);
+    if (expr.value)
+    {
+        compile(*expr.value);
+    }
+
+    line = expr.identifier.line;
+    emitOp(expr.value ? OpCode::SET_SUBSCRIPT : OpCode::GET_SUBSCRIPT);
+    emitShort(nameConstant(expr.identifier));
+    return {};
+}
+
+Value Compiler::visit(const IncrementExpr& expr)
+{
+    const uint16_t name = nameConstant(expr.identifier);
+
+    // Store the incremented value, which is also the result of a prefix increment.
+    emitGetVariable(expr.identifier);
+    emitOp(OpCode::INCREMENT);
+    emitShort(name);
+    emitSetVariable(expr.identifier);
+
+    // A postfix increment evaluates to the old value.
+    if (expr.type == IncrementExpr::Type::POSTFIX)
+    {
+        emitOp(OpCode::DECREMENT);
+        emitShort(name);
+    }
+    return {};
+}
+
+Value Compiler::visit(const DecrementExpr& expr)
+{
+    const uint16_t name = nameConstant(expr.identifier);
+
+    emitGetVariable(expr.identifier);
+    emitOp(OpCode::DECREMENT);
+    emitShort(name);
+    emitSetVariable(expr.identifier);
+
+    if (expr.type == DecrementExpr::Type::POSTFIX)
+    {
+        emitOp(OpCode::INCREMENT);
+        emitShort(name);
+    }
+    return {};
+}
+
+void Compiler::visit(const BlockStmt& stmt)
+{
+    beginScope();
+    for (const auto& block_stmt : stmt.statements)
+    {
+        assert(block_stmt);
+        compile(*block_stmt);
+    }
+    endScope();
+}
+
+void Compiler::visit(const ClassStmt& stmt)
+{
+}
+
+void Compiler::visit(const ExprStmt& stmt)
+{
+    compile(*stmt.expression);
+    emitOp(OpCode::POP);
+}
+
+void Compiler::visit(const FnStmt& stmt)
+{
+    line = stmt.identifier.line;
+
+    // Declare local functions before compiling the body, so they can call themselves.
+    if (current->scope_depth > 0u)
+    {
+        addLocal(stmt.identifier);
+        compileFunction(stmt);
+        return;
+    }
+
+    compileFunction(stmt);
+    emitOp(OpCode::DEFINE_GLOBAL);
+    emitShort(globalIndex(stmt.identifier));
+}
+
+void Compiler::visit(const IfStmt& stmt)
+{
+    std::vector<size_t> end_jumps;
+
+    // Each branch pops the condition on both paths and jumps to the end once it has executed.
+    auto compileBranch = [this, &end_jumps](const IfBranch& branch)
+    {
+        compile(*branch.condition);
+        const size_t next_jump = emitJump(OpCode::JUMP_IF_FALSE);
+        emitOp(OpCode::POP);
+        compile(*branch.statement);
+        end_jumps.push_back(emitJump(OpCode::JUMP));
+        patchJump(next_jump);
+        emitOp(OpCode::POP);
+    };
+
+    compileBranch(stmt.main_branch);
+    for (const auto& elif : stmt.elif_branches)
+    {
+        compileBranch(elif);
+    }
+    if (stmt.else_branch)
+    {
+        compile(*stmt.else_branch);
+    }
+
+    for (const size_t jump : end_jumps)
+    {
+        patchJump(jump);
+    }
+}
+
+void Compiler::visit(const PrintStmt& stmt)
+{
+    // A print statement is a call to the native print function.
+    compile(*stmt.expression);
+    emitOp(OpCode::POP);
+}
+
+void Compiler::visit(const ReturnStmt& stmt)
+{
+    if (stmt.expression)
+    {
+        compile(*stmt.expression);
+    }
+    else
+    {
+        emitOp(OpCode::NIL);
+    }
+
+    line = stmt.keyword.line;
+    emitOp(OpCode::RETURN);
+}
+
+void Compiler::visit(const BreakStmt& stmt)
+{
+    // The Resolver guarantees that break only appears inside a loop.
+    line = stmt.keyword.line;
+    auto& loop = current->loops.back();
+    discardLocals(loop.scope_depth);
+    loop.break_jumps.push_back(emitJump(OpCode::JUMP));
+}
+
+void Compiler::visit(const ContinueStmt& stmt)
+{
+    line = stmt.keyword.line;
+    auto& loop = current->loops.back();
+    discardLocals(loop.scope_depth);
+    loop.continue_jumps.push_back(emitJump(OpCode::JUMP));
+}
+
+void Compiler::visit(const VarStmt& stmt)
+{
+    if (stmt.initializer)
+    {
+        compile(*stmt.initializer);
+    }
+    else
+    {
+        emitOp(OpCode::NIL);
+    }
+
+    line = stmt.identifier.line;
+
+    // A local is simply the value left on the stack by the initializer.
+    if (current->scope_depth > 0u)
+    {
+        addLocal(stmt.identifier);
+        return;
+    }
+
+    emitOp(OpCode::DEFINE_GLOBAL);
+    emitShort(globalIndex(stmt.identifier));
+}
+
+void Compiler::visit(const WhileStmt& stmt)
+{
+    const size_t loop_start = currentChunk().code.size();
+    compile(*stmt.condition);
+    const size_t exit_jump = emitJump(OpCode::JUMP_IF_FALSE);
+    emitOp(OpCode::POP);
+
+    current->loops.push_back(Loop{current->scope_depth});
+    compile(*stmt.body);
+
+    // Continue jumps straight back to the condition.
+    auto loop = std::move(current->loops.back());
+    current->loops.pop_back();
+    for (const size_t jump : loop.continue_jumps)
+    {
+        patchJump(jump);
+    }
+    emitLoop(loop_start);
+
+    patchJump(exit_jump);
+    emitOp(OpCode::POP);
+
+    // The condition has already been popped when breaking out of the body.
+    for (const size_t jump : loop.break_jumps)
+    {
+        patchJump(jump);
+    }
+}
+
+void Compiler::visit(const ForStmt& stmt)
+{
+    // The loop variable is declared in a scope of its own, surrounding the loop.
+    beginScope();
+    if (stmt.initializer)
+    {
+        compile(*stmt.initializer);
+    }
+
+    const size_t loop_start = currentChunk().code.size();
+    std::optional<size_t> exit_jump;
+    if (stmt.condition)
+    {
+        compile(*stmt.condition);
+        exit_jump = emitJump(OpCode::JUMP_IF_FALSE);
+        emitOp(OpCode::POP);
+    }
+
+    current->loops.push_back(Loop{current->scope_depth});
+    compile(*stmt.body);
+
+    // Continue jumps to the increment.
+    auto loop = std::move(current->loops.back());
+    current->loops.pop_back();
+    for (const size_t jump : loop.continue_jumps)
+    {
+        patchJump(jump);
+    }
+    if (stmt.increment)
+    {
+        compile(*stmt.increment);
+        emitOp(OpCode::POP);
+    }
+    emitLoop(loop_start);
+
+    if (exit_jump)
+    {
+        patchJump(*exit_jump);
+        emitOp(OpCode::POP);
+    }
+
+    for (const size_t jump : loop.break_jumps)
+    {
+        patchJump(jump);
+    }
+    endScope();
+}
@@ -0,0 +1,80 @@
+#include "../include/ExecNode.hpp"
+#include "../include/BuiltIn.hpp"
+#include "../include/ClosureType.hpp"
+#include "../include/Logger.hpp"
+#include "../include/RuntimeError.hpp"
+
+ExecContext::ExecContext()
+    : heap{[this](Heap& heap) { markRoots(heap); }}, call_stack{heap}
+{
+}
+
+void ExecContext::markRoots(Heap& heap) const
+{
+    for (const auto& global : globals)
+    {
+        heap.mark(global.value);
+    }
+    // The running functions are on the call stack below their arguments, which keeps their
+    // upvalues alive.
+    call_stack.mark(heap);
+    heap.mark(return_value);
+}
+
+NodeFunction::NodeFunction(const FunctionNode* declaration, std::vector<Value> upvalues)
+    : Object{ObjectType::NODE_FUNCTION}, declaration{declaration}, upvalues{std::move(upvalues)}
+{
+}
+
+std::string NodeFunction::toString() const
+{
+    return "<fn " + declaration->name + ">";
+}
+
+void NodeFunction::trace(Heap& heap) const
+{
+    for (const auto& upvalue : upvalues)
+    {
+        heap.mark(upvalue);
+    }
+}
+
+Heap::Statistics NodeProgram::run() const
+{
+    ExecContext context;
+    context.globals.resize(globals.size());
+
+    // The natives are defined in the slots of their names, if the program refers to them.
+    for (size_t i = 0u; i < globals.size(); ++i)
+    {
+        if (globals[i] == "clock")
+        {
+            context.globals[i] = {
+                context.heap.allocate<NativeFunction>("<native fn>", 0u, false, clockNative), true};
+        }
+        else if (globals[i] == "print")
+        {
+            context.globals[i] = {
+                context.heap.allocate<NativeFunction>("native print", 0u, true, printNative), true};
+        }
+    }
+
+    try
+    {
+        for (const auto& stmt : statements)
+        {
+            // The Resolver rejects return statements in top-level code, but stop like the
+            // interpreter if one gets through.
+            if (stmt->exec(context) == ExecStatus::RETURN)
+            {
+                break;
+            }
+        }
+    }
+    catch (const RuntimeError& error)
+    {
+        Error::addRuntimeError(error);
+    }
+
+    return context.heap.getStatistics();
+}
@@ -8,7 +8,7 @@ AssignExpr::AssignExpr(Token identifier, unique_expr_ptr value)
     assert(this->value != nullptr);
 }
 
-std::any AssignExpr::accept(ExprVisitor<std::any>& visitor) const
+Value AssignExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
@@ -20,7 +20,7 @@ BinaryExpr::BinaryExpr(unique_expr_ptr left, Token op, unique_expr_ptr right)
     assert(this->right != nullptr);
 }
 
-std::any BinaryExpr::accept(ExprVisitor<std::any>& visitor) const
+Value BinaryExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
@@ -30,7 +30,7 @@ UnaryExpr::UnaryExpr(Token op, unique_expr_ptr right) : op{std::move(op)}, right
     assert(this->right != nullptr);
 }
 
-std::any UnaryExpr::accept(ExprVisitor<std::any>& visitor) const
+Value UnaryExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
@@ -41,7 +41,7 @@ IncrementExpr::IncrementExpr(Token variable, Type type)
     assert(this->identifier.type == TokenType::IDENTIFIER);
 }
 
-std::any IncrementExpr::accept(ExprVisitor<std::any>& visitor) const
+Value IncrementExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
@@ -52,18 +52,18 @@ DecrementExpr::DecrementExpr(Token variable, Type type)
     assert(this->identifier.type == TokenType::IDENTIFIER);
 }
 
-std::any DecrementExpr::accept(ExprVisitor<std::any>& visitor) const
+Value DecrementExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
 
-CallExpr::CallExpr(unique_expr_ptr callee, Token paren, std::vector<unique_expr_ptr> args)
+CallExpr::CallExpr(unique_expr_ptr callee, Token paren, ast_vector<unique_expr_ptr> args)
     : callee{std::move(callee)}, paren{std::move(paren)}, args{std::move(args)}
 {
     assert(this->paren.type == TokenType::RIGHT_PAREN);
 }
 
-std::any CallExpr::accept(ExprVisitor<std::any>& visitor) const
+Value CallExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
@@ -73,7 +73,7 @@ GetExpr::GetExpr(unique_expr_ptr object, Token identifier)
 {
 }
 
-std::any GetExpr::accept(ExprVisitor<std::any>& visitor) const
+Value GetExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
@@ -83,7 +83,7 @@ SetExpr::SetExpr(unique_expr_ptr object, Token identifier, unique_expr_ptr value
 {
 }
 
-std::any SetExpr::accept(ExprVisitor<std::any>& visitor) const
+Value SetExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
@@ -93,16 +93,17 @@ GroupingExpr::GroupingExpr(unique_expr_ptr expr) : expression{std::move(expr)}
     assert(this->expression != nullptr);
 }
 
-std::any GroupingExpr::accept(ExprVisitor<std::any>& visitor) const
+Value GroupingExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
 
-LiteralExpr::LiteralExpr(std::any literal) : literal{std::move(literal)}
+LiteralExpr::LiteralExpr(Value literal, unsigned int offset)
+    : literal{std::move(literal)}, offset{offset}
 {
 }
 
-std::any LiteralExpr::accept(ExprVisitor<std::any>& visitor) const
+Value LiteralExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
@@ -115,7 +116,7 @@ LogicalExpr::LogicalExpr(unique_expr_ptr left, Token op, unique_expr_ptr right)
     assert(this->op.type == TokenType::AND || this->op.type == TokenType::OR);
 }
 
-std::any LogicalExpr::accept(ExprVisitor<std::any>& visitor) const
+Value LogicalExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
@@ -125,7 +126,7 @@ SuperExpr::SuperExpr(Token keyword, Token method)
 {
 }
 
-std::any SuperExpr::accept(ExprVisitor<std::any>& visitor) const
+Value SuperExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
@@ -135,7 +136,7 @@ ThisExpr::ThisExpr(Token keyword) : keyword{std::move(keyword)}
     assert(this->keyword.type == TokenType::THIS);
 }
 
-std::any ThisExpr::accept(ExprVisitor<std::any>& visitor) const
+Value ThisExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
@@ -144,17 +145,17 @@ VarExpr::VarExpr(Token identifier) : identifier{std::move(identifier)}
 {
 }
 
-std::any VarExpr::accept(ExprVisitor<std::any>& visitor) const
+Value VarExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
 
-ListExpr::ListExpr(Token opening_bracket, std::vector<unique_expr_ptr> items)
+ListExpr::ListExpr(Token opening_bracket, ast_vector<unique_expr_ptr> items)
     : opening_bracket{std::move(opening_bracket)}, items{std::move(items)}
 {
 }
 
-std::any ListExpr::accept(ExprVisitor<std::any>& visitor) const
+Value ListExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
@@ -165,7 +166,7 @@ SubscriptExpr::SubscriptExpr(Token identifier, unique_expr_ptr index, unique_exp
     assert(this->identifier.type == TokenType::IDENTIFIER);
 }
 
-std::any SubscriptExpr::accept(ExprVisitor<std::any>& visitor) const
+Value SubscriptExpr::accept(ExprVisitor<Value>& visitor) const
 {
     return visitor.visit(*this);
 }
@@ -0,0 +1,441 @@
+#include "../include/FlatAst.hpp"
+#include "../include/Lexer.hpp"
+#include <algorithm>
+#include <cassert>
+
+// Appends the nodes of the tree to the tables of a flat AST in pre-order.
+class FlatAst::Builder : public ExprVisitor<Value>, public StmtVisitor
+{
+public:
+    explicit Builder(FlatAst& ast) : ast{ast} {}
+
+    Index build(const Expr* expr)
+    {
+        if (!expr)
+        {
+            return NONE;
+        }
+        expr->accept(*this);
+        return result;
+    }
+
+    Index build(const Stmt* stmt)
+    {
+        // Statements that failed to parse are left out.
+        if (!stmt)
+        {
+            return NONE;
+        }
+        stmt->accept(*this);
+        return result;
+    }
+
+    // Builds the statements and lists them in the extra table.
+    Index buildList(const ast_vector<unique_stmt_ptr>& statements)
+    {
+        std::vector<Index> nodes;
+        nodes.reserve(statements.size());
+        for (const auto& stmt : statements)
+        {
+            if (const Index node = build(stmt.get()); node != NONE)
+            {
+                nodes.push_back(node);
+            }
+        }
+        return addList(nodes);
+    }
+
+    Index buildList(const ast_vector<unique_expr_ptr>& expressions)
+    {
+        std::vector<Index> nodes;
+        nodes.reserve(expressions.size());
+        for (const auto& expr : expressions)
+        {
+            nodes.push_back(build(expr.get()));
+        }
+        return addList(nodes);
+    }
+
+    // Lists the nodes in the extra table.
+    Index addList(const std::vector<Index>& items)
+    {
+        const auto start = static_cast<Index>(ast.extra.size());
+        ast.extra.push_back(static_cast<Index>(items.size()));
+        ast.extra.insert(ast.extra.end(), items.begin(), items.end());
+        return start;
+    }
+
+    Value visit(const AssignExpr& expr) override
+    {
+        const Index node = add(Kind::ASSIGN, expr.identifier.offset);
+        setOperands(node, build(expr.value.get()));
+        return {};
+    }
+
+    Value visit(const BinaryExpr& expr) override
+    {
+        const Index node = add(Kind::BINARY, expr.op.offset);
+        const Index left = build(expr.left.get());
+        setOperands(node, left, build(expr.right.get()));
+        return {};
+    }
+
+    Value visit(const CallExpr& expr) override
+    {
+        const Index node = add(Kind::CALL, expr.paren.offset);
+        const Index callee = build(expr.callee.get());
+        setOperands(node, callee, buildList(expr.args));
+        return {};
+    }
+
+    Value visit(const GetExpr& expr) override { return unsupportedExpr(); }
+
+    Value visit(const GroupingExpr& expr) override
+    {
+        const Index node = add(Kind::GROUPING, 0u);
+        setOperands(node, build(expr.expression.get()));
+        return {};
+    }
+
+    Value visit(const LiteralExpr& expr) override
+    {
+        const Value& literal = expr.literal;
+        if (literal.isNumber())
+        {
+            add(Kind::NUMBER, expr.offset);
+        }
+        else if (literal.isString())
+        {
+            add(Kind::STRING, expr.offset);
+        }
+        else if (literal.isBool())
+        {
+            add(literal.asBool() ? Kind::TRUE : Kind::FALSE, expr.offset);
+        }
+        else
+        {
+            add(Kind::NIL, expr.offset);
+        }
+        return {};
+    }
+
+    Value visit(const LogicalExpr& expr) override
+    {
+        const Index node = add(Kind::LOGICAL, expr.op.offset);
+        const Index left = build(expr.left.get());
+        setOperands(node, left, build(expr.right.get()));
+        return {};
+    }
+
+    Value visit(const SetExpr& expr) override { return unsupportedExpr(); }
+
+    Value visit(const SuperExpr& expr) override { return unsupportedExpr(); }
+
+    Value visit(const ThisExpr& expr) override { return unsupportedExpr(); }
+
+    Value visit(const UnaryExpr& expr) override
+    {
+        const Index node = add(Kind::UNARY, expr.op.offset);
+        setOperands(node, build(expr.right.get()));
+        return {};
+    }
+
+    Value visit(const VarExpr& expr) override
+    {
+        add(Kind::VARIABLE, expr.identifier.offset);
+        return {};
+    }
+
+    Value visit(const ListExpr& expr) override
+    {
+        const Index node = add(Kind::LIST, expr.opening_bracket.offset);
+        setOperands(node, NONE, buildList(expr.items));
+        return {};
+    }
+
+    Value visit(const SubscriptExpr& expr) override
+    {
+        const Index node = add(Kind::SUBSCRIPT, expr.identifier.offset);
+        const Index index = build(expr.index.get());
+        setOperands(node, index, build(expr.value.get()));
+        return {};
+    }
+
+    Value visit(const IncrementExpr& expr) override
+    {
+        add(expr.type == IncrementExpr::Type::PREFIX ? Kind::PREFIX_INCREMENT
+                                                     : Kind::POSTFIX_INCREMENT,
+            expr.identifier.offset);
+        return {};
+    }
+
+    Value visit(const DecrementExpr& expr) override
+    {
+        add(expr.type == DecrementExpr::Type::PREFIX ? Kind::PREFIX_DECREMENT
+                                                     : Kind::POSTFIX_DECREMENT,
+            expr.identifier.offset);
+        return {};
+    }
+
+    void visit(const BlockStmt& stmt) override
+    {
+        const Index node = add(Kind::BLOCK, 0u);
+        setOperands(node, buildList(stmt.statements));
+    }
+
+    void visit(const ClassStmt& stmt) override
+    {
+        // Classes aren't parsed yet.
+        result = NONE;
+    }
+
+    void visit(const ExprStmt& stmt) override
+    {
+        const Index node = add(Kind::EXPRESSION, 0u);
+        setOperands(node, build(stmt.expression.get()));
+    }
+
+    void visit(const FnStmt& stmt) override
+    {
+        const Index node = add(Kind::FUNCTION, stmt.identifier.offset);
+        std::vector<Index> params;
+        params.reserve(stmt.params.size());
+        for (const auto& param : stmt.params)
+        {
+            params.push_back(param.offset);
+        }
+        const Index params_list = addList(params);
+        setOperands(node, params_list, buildList(stmt.body));
+    }
+
+    void visit(const IfStmt& stmt) override
+    {
+        const Index node = add(Kind::IF, 0u);
+        std::vector<Index> branches{build(stmt.main_branch.condition.get()),
+                                    build(stmt.main_branch.statement.get())};
+        for (const auto& elif : stmt.elif_branches)
+        {
+            branches.push_back(build(elif.condition.get()));
+            branches.push_back(build(elif.statement.get()));
+        }
+        const Index else_branch = build(stmt.else_branch.get());
+        setOperands(node, addList(branches), else_branch);
+    }
+
+    void visit(const PrintStmt& stmt) override
+    {
+        const Index node = add(Kind::PRINT, 0u);
+        setOperands(node, build(stmt.expression.get()));
+    }
+
+    void visit(const ReturnStmt& stmt) override
+    {
+        const Index node = add(Kind::RETURN, stmt.keyword.offset);
+        setOperands(node, build(stmt.expression.get()));
+    }
+
+    void visit(const BreakStmt& stmt) override { add(Kind::BREAK, stmt.keyword.offset); }
+
+    void visit(const ContinueStmt& stmt) override { add(Kind::CONTINUE, stmt.keyword.offset); }
+
+    void visit(const VarStmt& stmt) override
+    {
+        const Index node = add(Kind::VAR, stmt.identifier.offset);
+        setOperands(node, build(stmt.initializer.get()));
+    }
+
+    void visit(const WhileStmt& stmt) override
+    {
+        const Index node = add(Kind::WHILE, 0u);
+        const Index condition = build(stmt.condition.get());
+        setOperands(node, condition, build(stmt.body.get()));
+    }
+
+    void visit(const ForStmt& stmt) override
+    {
+        const Index node = add(Kind::FOR, 0u);
+        const Index initializer = build(stmt.initializer.get());
+        const Index condition = build(stmt.condition.get());
+        const Index increment = build(stmt.increment.get());
+        const Index body = build(stmt.body.get());
+
+        const auto clauses = static_cast<Index>(ast.extra.size());
+        ast.extra.insert(ast.extra.end(), {initializer, condition, increment});
+        setOperands(node, clauses, body);
+    }
+
+private:
+    FlatAst& ast;
+    // The node built by the last visit.
+    Index result = NONE;
+
+    Index add(Kind kind, uint32_t offset)
+    {
+        result = static_cast<Index>(ast.kinds.size());
+        ast.kinds.push_back(kind);
+        ast.offsets.push_back(offset);
+        ast.lhs_operands.push_back(NONE);
+        ast.rhs_operands.push_back(NONE);
+        return result;
+    }
+
+    // The operands are set once the children have been added after the node.
+    void setOperands(Index node, Index lhs, Index rhs = NONE)
+    {
+        ast.lhs_operands[node] = lhs;
+        ast.rhs_operands[node] = rhs;
+        result = node;
+    }
+
+    Value unsupportedExpr()
+    {
+        // Classes aren't parsed yet, so their expressions never appear in a tree.
+        add(Kind::NIL, 0u);
+        return {};
+    }
+};
+
+namespace
+{
+    // Entry of `node` in a side table sorted by node.
+    template <typename T>
+    const T& findEntry(const std::deque<std::pair<FlatAst::Index, T>>& table, FlatAst::Index node)
+    {
+        const auto entry = std::lower_bound(table.begin(), table.end(), node,
+                                            [](const auto& entry, FlatAst::Index node)
+                                            { return entry.first < node; });
+        assert(entry != table.end() && entry->first == node);
+        return entry->second;
+    }
+}
+
+FlatAst::FlatAst(std::string_view source) : source{source}
+{
+    line_starts.push_back(0u);
+    for (size_t i = 0u; i < source.size(); ++i)
+    {
+        if (source[i] == '\n')
+        {
+            line_starts.push_back(static_cast<uint32_t>(i + 1u));
+        }
+    }
+}
+
+FlatAst::FlatAst(std::string_view source, const ast_vector<unique_stmt_ptr>& statements)
+    : FlatAst{source}
+{
+    append(statements);
+    finish();
+}
+
+void FlatAst::append(const ast_vector<unique_stmt_ptr>& statements)
+{
+    Builder builder{*this};
+    for (const auto& stmt : statements)
+    {
+        if (const Index node = builder.build(stmt.get()); node != NONE)
+        {
+            top_level.push_back(node);
+        }
+    }
+}
+
+void FlatAst::finish()
+{
+    root = Builder{*this}.addList(std::exchange(top_level, {}));
+
+    for (auto* table : {&lhs_operands, &rhs_operands, &extra})
+    {
+        table->shrink_to_fit();
+    }
+    kinds.shrink_to_fit();
+    offsets.shrink_to_fit();
+    line_starts.shrink_to_fit();
+}
+
+std::string_view FlatAst::lexemeAt(uint32_t offset) const
+{
+    // Tokens are scanned again the way the Lexer did, from their first character.
+    auto isAlpha = [](char c)
+    { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; };
+    auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+    auto scanWhile = [this](size_t end, auto predicate)
+    {
+        while (end < source.size() && predicate(source[end]))
+        {
+            ++end;
+        }
+        return end;
+    };
+
+    if (offset >= source.size())
+    {
+        return {};
+    }
+
+    const char c = source[offset];
+    size_t end = offset + 1u;
+    if (c == '"')
+    {
+        end = std::min(source.find('"', offset + 1u), source.size());
+        return source.substr(offset + 1u, end - offset - 1u);
+    }
+    if (isDigit(c))
+    {
+        end = scanWhile(end, isDigit);
+        if (end + 1u < source.size() && source[end] == '.' && isDigit(source[end + 1u]))
+        {
+            end = scanWhile(end + 1u, isDigit);
+        }
+    }
+    else if (isAlpha(c))
+    {
+        end = scanWhile(end, [&](char next) { return isAlpha(next) || isDigit(next); });
+    }
+    else if (end < source.size())
+    {
+        const char next = source[end];
+        if ((next == '=' && (c == '!' || c == '=' || c == '<' || c == '>')) ||
+            (next == c && (c == '+' || c == '-')))
+        {
+            ++end;
+        }
+    }
+    return source.substr(offset, end - offset);
+}
+
+const ScopeLayout& FlatAst::layout(Index node) const
+{
+    return findEntry(layouts, node);
+}
+
+const FlatAst::FunctionInfo& FlatAst::function(Index node) const
+{
+    return findEntry(functions, node);
+}
+
+Token FlatAst::token(Index node) const
+{
+    return tokenAt(offsets[node]);
+}
+
+Token FlatAst::tokenAt(uint32_t offset) const
+{
+    // Only keywords and identifiers are reported by the Resolver, the exact type of other tokens
+    // doesn't matter to error messages.
+    const std::string_view lexeme = lexemeAt(offset);
+    return {Lexer::identifierType(lexeme), lexeme, lineAt(offset), offset};
+}
+
+unsigned int FlatAst::lineAt(uint32_t offset) const
+{
+    const auto next_line = std::upper_bound(line_starts.begin(), line_starts.end(), offset);
+    return static_cast<unsigned int>(std::distance(line_starts.begin(), next_line));
+}
+
+size_t FlatAst::memoryUsage() const
+{
+    return kinds.capacity() * sizeof(Kind) + offsets.capacity() * sizeof(uint32_t) +
+           (lhs_operands.capacity() + rhs_operands.capacity() + extra.capacity()) * sizeof(Index) +
+           line_starts.capacity() * sizeof(uint32_t);
+}
@@ -1,8 +1,36 @@
 #include "../include/FunctionType.hpp"
-#include "../include/RuntimeException.hpp"
+#include "../include/Heap.hpp"
+#include "../include/Lexer.hpp"
+#include "../include/Logger.hpp"
+#include "../include/Parser.hpp"
+#include "../include/Resolver.hpp"
 
-FunctionType::FunctionType(const FnStmt* declaration, std::shared_ptr<Environment> closure)
-    : declaration{declaration}, closure{std::move(closure)}
+namespace
+{
+    // Parses and resolves the body the Parser skipped. Returns false if it has errors, which are
+    // reported with the syntax and resolution errors of the rest of the script.
+    bool parseBody(const FnStmt& declaration)
+    {
+        const LazyBody& lazy_body = *declaration.lazy_body;
+        Lexer lexer{lazy_body.source.substr(0u, lazy_body.end), lazy_body.begin, lazy_body.line};
+        Parser parser{lexer};
+        auto [arena, body] = parser.parse();
+        if (Error::hadError)
+        {
+            return false;
+        }
+
+        lazy_body.arena->adopt(std::move(arena));
+        declaration.body = std::move(body);
+        declaration.lazy_body.reset();
+        Resolver resolver;
+        resolver.resolveBody(declaration);
+        return !Error::hadError;
+    }
+}
+
+FunctionType::FunctionType(const FnStmt* declaration, std::vector<Value> upvalues)
+    : declaration{declaration}, upvalues{std::move(upvalues)}
 {
 }
 
@@ -11,39 +39,27 @@ size_t FunctionType::getArity() const
     return declaration->params.size();
 }
 
-std::any FunctionType::call(Interpreter& interpreter, const std::vector<std::any>& args) const
+Value FunctionType::call(Interpreter& interpreter, std::span<const Value> args) const
 {
-    auto environment = std::make_shared<Environment>(closure);
-
-    for (size_t i = 0u; i < declaration->params.size(); ++i)
-    {
-        // If the argument is of type list or string, define it's owned object in the current
-        // environment.
-        if (args[i].type() == typeid(shared_ptr_any))
-        {
-            environment->define(declaration->params[i].lexeme,
-                                std::any_cast<shared_ptr_any>(args[i]));
-        }
-        else
-        {
-            // Else create a new pointer that doesn't share ownership with the argument.
-            environment->define(declaration->params[i].lexeme, args[i]);
-        }
-    }
-
-    try
-    {
-        interpreter.executeBlock(declaration->body, std::move(environment));
-    }
-    catch (const ReturnException& return_exception)
+    if (declaration->lazy_body && !parseBody(*declaration))
     {
-        return return_exception.getReturnValue();
+        throw Interpreter::BodyErrors{};
     }
 
-    return {};
+    // The arguments were pushed onto the interpreter's call stack, where they become the parameter
+    // slots of the new frame.
+    return interpreter.callFunction(*declaration, upvalues, args.size());
 }
 
 std::string FunctionType::toString() const
 {
-    return "<fn " + declaration->identifier.lexeme + ">";
-}
\ No newline at end of file
+    return "<fn " + std::string{declaration->identifier.lexeme} + ">";
+}
+
+void FunctionType::trace(Heap& heap) const
+{
+    for (const auto& upvalue : upvalues)
+    {
+        heap.mark(upvalue);
+    }
+}
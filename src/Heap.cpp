@@ -0,0 +1,282 @@
+#include "../include/Heap.hpp"
+#include <algorithm>
+
+Heap::Heap(std::function<void(Heap&)> mark_roots) : mark_roots{std::move(mark_roots)}
+{
+    startNurseryBlock();
+}
+
+Heap::~Heap()
+{
+    for (Object* objects : {old_objects, young_objects})
+    {
+        while (objects)
+        {
+            free(std::exchange(objects, objects->next));
+        }
+    }
+    ::operator delete(nursery, std::align_val_t{BLOCK_SIZE});
+}
+
+void Heap::mark(Object* object)
+{
+    // Objects owned by the AST or a compiled program are never freed, and they don't refer to
+    // objects of the heap. A minor collection stops at old objects, the young objects they refer
+    // to are found through the remembered set.
+    if (!object->is_managed || object->is_marked || (is_minor_collection && !object->is_young))
+    {
+        return;
+    }
+
+    // Tracing is deferred to a worklist, so long chains of objects don't overflow the C++ stack.
+    object->is_marked = true;
+    gray_objects.push_back(object);
+}
+
+void Heap::collectNursery()
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    is_minor_collection = true;
+    mark_roots(*this);
+    for (Object* object : remembered_objects)
+    {
+        object->is_remembered = false;
+        object->trace(*this);
+    }
+    remembered_objects.clear();
+    traceGrayObjects();
+    sweepYoung();
+    is_minor_collection = false;
+
+    ++statistics.minor_collections;
+    recordPause(start);
+
+    if (old_bytes > next_full_collection)
+    {
+        collect();
+    }
+}
+
+void Heap::collect()
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // Every object is traced, so the remembered set isn't needed.
+    for (Object* object : remembered_objects)
+    {
+        object->is_remembered = false;
+    }
+    remembered_objects.clear();
+
+    mark_roots(*this);
+    traceGrayObjects();
+    sweepOld();
+    sweepYoung();
+
+    ++statistics.full_collections;
+    recordPause(start);
+
+    next_full_collection = std::max(old_bytes * GROWTH_FACTOR, MIN_FULL_COLLECTION_SIZE);
+}
+
+const Heap::Statistics& Heap::getStatistics() const
+{
+    return statistics;
+}
+
+void Heap::manage(Object* object, size_t size)
+{
+    object->is_managed = true;
+    object->is_young = true;
+    object->size = size;
+    object->next = young_objects;
+    young_objects = object;
+    ++nursery->live_objects;
+    ++statistics.objects_allocated;
+}
+
+void Heap::makeRoom(size_t size)
+{
+    if (useNextHole(size))
+    {
+        return;
+    }
+    collectNursery();
+    if (!useNextHole(size))
+    {
+        startNurseryBlock();
+        useNextHole(size);
+    }
+}
+
+bool Heap::useNextHole(size_t size)
+{
+    // Holes too small for the object are skipped for now, they are found again after the next
+    // collection.
+    while (next_hole < holes.size())
+    {
+        const Hole hole = holes[next_hole++];
+        if (hole.size() >= size)
+        {
+            nursery_top = hole.start;
+            nursery_end = hole.end;
+            return true;
+        }
+    }
+    return false;
+}
+
+#ifdef JLOX_STRESS_GC
+void Heap::collectForStress()
+{
+    // Minor collections catch young objects missing from the roots or the remembered set, the
+    // occasional full one catches old objects missing from them.
+    constexpr size_t FULL_COLLECTION_INTERVAL = 16u;
+    if (++stress_allocations % FULL_COLLECTION_INTERVAL == 0u)
+    {
+        collect();
+    }
+    else
+    {
+        collectNursery();
+    }
+}
+#endif
+
+void Heap::traceGrayObjects()
+{
+    while (!gray_objects.empty())
+    {
+        const Object* object = gray_objects.back();
+        gray_objects.pop_back();
+        object->trace(*this);
+    }
+}
+
+void Heap::sweepYoung()
+{
+    while (young_objects)
+    {
+        Object* object = std::exchange(young_objects, young_objects->next);
+        if (!object->is_marked)
+        {
+            ++statistics.objects_reclaimed;
+            statistics.bytes_reclaimed += sizeOf(*object);
+            free(object);
+            continue;
+        }
+
+        object->is_marked = false;
+        object->is_young = false;
+        object->next = old_objects;
+        old_objects = object;
+        old_bytes += sizeOf(*object);
+        ++statistics.objects_promoted;
+        survivors.push_back(reinterpret_cast<std::byte*>(object));
+    }
+
+    findHoles();
+    survivors.clear();
+}
+
+void Heap::sweepOld()
+{
+    // The memory of the survivors is recounted, since objects like lists grow after allocation.
+    old_bytes = 0u;
+
+    Object** link = &old_objects;
+    while (*link)
+    {
+        Object* object = *link;
+        if (object->is_marked)
+        {
+            object->is_marked = false;
+            old_bytes += sizeOf(*object);
+            link = &object->next;
+            continue;
+        }
+
+        *link = object->next;
+        ++statistics.objects_reclaimed;
+        statistics.bytes_reclaimed += sizeOf(*object);
+        free(object);
+    }
+}
+
+void Heap::free(Object* object)
+{
+    Block* block = blockOf(object);
+    object->~Object();
+    if (--block->live_objects == 0u && block != nursery)
+    {
+        ::operator delete(block, std::align_val_t{BLOCK_SIZE});
+    }
+}
+
+void Heap::startNurseryBlock()
+{
+    // The previous block stays allocated for the objects promoted in it.
+    if (nursery && nursery->live_objects == 0u)
+    {
+        ::operator delete(nursery, std::align_val_t{BLOCK_SIZE});
+    }
+    auto memory = static_cast<std::byte*>(::operator new(BLOCK_SIZE, std::align_val_t{BLOCK_SIZE}));
+    nursery = new (memory) Block{};
+    holes.assign({{memory + HEADER_SIZE, memory + BLOCK_SIZE}});
+    next_hole = 0u;
+    nursery_top = nursery_end = nullptr;
+}
+
+void Heap::findHoles()
+{
+    next_hole = 0u;
+    nursery_top = nursery_end = nullptr;
+    if (nursery->live_objects == 0u)
+    {
+        auto memory = reinterpret_cast<std::byte*>(nursery);
+        holes.assign({{memory + HEADER_SIZE, memory + BLOCK_SIZE}});
+        return;
+    }
+
+    // The young objects were all allocated in the holes, so the new holes are the previous ones
+    // minus the survivors.
+    std::sort(survivors.begin(), survivors.end());
+    const std::vector<Hole> previous_holes = std::exchange(holes, {});
+    size_t free_bytes = 0u;
+    auto addHole = [this, &free_bytes](std::byte* start, std::byte* end)
+    {
+        if (static_cast<size_t>(end - start) >= MIN_HOLE_SIZE)
+        {
+            holes.push_back({start, end});
+            free_bytes += static_cast<size_t>(end - start);
+        }
+    };
+
+    auto survivor = survivors.begin();
+    for (const auto& hole : previous_holes)
+    {
+        std::byte* start = hole.start;
+        for (; survivor != survivors.end() && *survivor < hole.end; ++survivor)
+        {
+            addHole(start, *survivor);
+            start = *survivor + reinterpret_cast<const Object*>(*survivor)->size;
+        }
+        addHole(start, hole.end);
+    }
+
+    if (free_bytes < MIN_NURSERY_SIZE)
+    {
+        startNurseryBlock();
+    }
+}
+
+void Heap::recordPause(std::chrono::steady_clock::time_point start)
+{
+    statistics.pauses.push_back(std::chrono::steady_clock::now() - start);
+}
+
+size_t Heap::sizeOf(const Object& object)
+{
+    return object.size + object.ownedBytes();
+}
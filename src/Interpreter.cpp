@@ -1,164 +1,174 @@
 #include "../include/Interpreter.hpp"
 #include "../include/BuiltIn.hpp"
+#include "../include/ListType.hpp"
 #include "../include/Logger.hpp"
-#include "../include/RuntimeException.hpp"
+#include "../include/StringTable.hpp"
+#include <utility>
 
-Interpreter::Interpreter() : global_environment{globals.get()}
+Interpreter::Interpreter()
+    : heap{[this](Heap& heap) { markRoots(heap); }}, call_stack{heap}
 {
-    globals->define("clock", ClockCallable{});
-    globals->define("print", PrintCallable{});
-    environment = std::move(globals);
+    globals.try_emplace(StringTable::intern("clock"), heap.allocate<ClockCallable>());
+    globals.try_emplace(StringTable::intern("print"), heap.allocate<PrintCallable>());
 }
 
-void Interpreter::interpret(const std::vector<unique_stmt_ptr>& statements)
+void Interpreter::interpret(const ast_vector<unique_stmt_ptr>& statements)
 {
     try
     {
         for (const auto& stmt : statements)
         {
             assert(stmt != nullptr);
-            execute(*stmt);
+            // The Resolver rejects return statements in top-level code, but stop executing if one
+            // gets through.
+            if (execute(*stmt) == ExecStatus::RETURN)
+            {
+                break;
+            }
         }
     }
     catch (const RuntimeError& error)
     {
         Error::addRuntimeError(error);
     }
-    catch (const ReturnException&)
+    catch (const BodyErrors&)
     {
-        // Do nothing.
     }
 }
 
-std::any Interpreter::evaluate(const Expr& expr)
+Value Interpreter::evaluate(const Expr& expr)
 {
     return expr.accept(*this);
 }
 
-void Interpreter::execute(const Stmt& stmt)
+ExecStatus Interpreter::execute(const Stmt& stmt)
 {
     stmt.accept(*this);
+    // Reset the status, so it only describes the statement that set it.
+    return std::exchange(status, ExecStatus::NORMAL);
 }
 
-void Interpreter::executeBlock(const std::vector<unique_stmt_ptr>& statements,
-                               std::shared_ptr<Environment> enclosing_env)
+ExecStatus Interpreter::executeStatements(const ast_vector<unique_stmt_ptr>& statements)
 {
-    // Enter a new environment.
-    EnvironmentGuard environment_guard{*this, std::move(enclosing_env)};
     for (const auto& statement : statements)
     {
         assert(statement != nullptr);
-        execute(*statement);
+        // A break, continue or return leaves the block and is passed on to the enclosing loop or
+        // function call.
+        if (const auto result = execute(*statement); result != ExecStatus::NORMAL)
+        {
+            return result;
+        }
     }
+
+    return ExecStatus::NORMAL;
 }
 
-void Interpreter::checkNumberOperand(const Token& op, const std::any& operand) const
+Value Interpreter::callFunction(const FnStmt& declaration, const std::vector<Value>& upvalues,
+                                size_t arg_count)
 {
-    if (operand.type() != typeid(double))
-    {
-        throw RuntimeError(op, "Operand must be a number.");
-    }
+    // The arguments become the first slots of the new frame. Runtime errors abort the whole
+    // program, so the caller's frame is only restored on a normal return. The caller closes the
+    // upvalues of the frame when it pops the arguments.
+    const size_t caller_base = call_stack.enterFrame(arg_count, declaration.layout.frame_size);
+    const auto caller_upvalues = std::exchange(this->upvalues, &upvalues);
+
+    const auto status = executeStatements(declaration.body);
+    this->upvalues = caller_upvalues;
+    call_stack.leaveFrame(caller_base);
+
+    // A function without a return statement returns nil.
+    return status == ExecStatus::RETURN ? std::exchange(return_value, Value{}) : Value{};
 }
 
-void Interpreter::checkNumberOperands(const Token& op, const std::any& lhs,
-                                      const std::any& rhs) const
+const Heap::Statistics& Interpreter::getHeapStatistics() const
 {
-    // Throws a runtime error if either the left-hand side or the right-hand side operand is not of
-    // type double.
-    if (lhs.type() != typeid(double) || rhs.type() != typeid(double))
-    {
-        throw RuntimeError(op, "Operands must be numbers.");
-    }
+    return heap.getStatistics();
 }
 
-bool Interpreter::isTruthy(const std::any& object) const
+void Interpreter::markRoots(Heap& heap) const
 {
-    // Checks if the passed in object is considered "truthy".
-
-    // This case would indicate a null value.
-    if (!object.has_value())
+    for (const auto& [name, value] : globals)
     {
-        return false;
+        heap.mark(value);
     }
-
-    // If the object is of type bool, return the cast value.
-    if (object.type() == typeid(bool))
-    {
-        return std::any_cast<bool>(object);
-    }
-
-    // Object has value and is not a false boolean, Therefore it is considered truthy.
-    return true;
+    // The running functions are on the call stack below their arguments, which keeps their
+    // upvalues alive.
+    call_stack.mark(heap);
+    heap.mark(return_value);
 }
 
-bool Interpreter::isEqual(const std::any& lhs, const std::any& rhs) const
+void Interpreter::checkNumberOperand(const Token& op, const Value& operand) const
 {
-    // Checks if two `std::any` objects are equal.
-    if (!lhs.has_value() && !rhs.has_value())
+    if (!operand.isNumber())
     {
-        return true;
-    }
-    if (!lhs.has_value())
-    {
-        return false;
+        throw RuntimeError(op, "Operand must be a number.");
     }
+}
 
-    if (lhs.type() != rhs.type())
+void Interpreter::checkNumberOperands(const Token& op, const Value& lhs, const Value& rhs) const
+{
+    // Throws a runtime error if either the left-hand side or the right-hand side operand is not a
+    // number.
+    if (!lhs.isNumber() || !rhs.isNumber())
     {
-        return false;
+        throw RuntimeError(op, "Operands must be numbers.");
     }
+}
 
-    if (lhs.type() == typeid(bool))
+void Interpreter::define(const Token& identifier, const VariableSlot& slot, const Value& value)
+{
+    // Top-level declarations are globals, everything else lives in the slot assigned by the
+    // Resolver.
+    if (slot.storage == VariableSlot::Storage::GLOBAL)
     {
-        return std::any_cast<bool>(lhs) == std::any_cast<bool>(rhs);
+        assert(slot.name);
+        globals.try_emplace(slot.name, value);
     }
-
-    if (lhs.type() == typeid(double))
+    else
     {
-        return std::any_cast<double>(lhs) == std::any_cast<double>(rhs);
+        lookUpVariable(identifier, slot) = value;
     }
+}
 
-    if (lhs.type() == typeid(std::string))
+Value& Interpreter::lookUpGlobal(const Token& identifier, const VariableSlot& slot)
+{
+    assert(slot.name);
+    if (auto global = globals.find(slot.name); global != globals.end())
     {
-        return std::any_cast<std::string>(lhs) == std::any_cast<std::string>(rhs);
+        return global->second;
     }
 
-    // If the type is not bool, double, or std::string, return false
-    return false;
+    throw RuntimeError(identifier,
+                       "Undefined variable '" + std::string{identifier.lexeme} + "'.");
 }
 
-void Interpreter::resolve(const Expr& expr_ptr, size_t distance)
+Value& Interpreter::lookUpVariable(const Token& identifier, const VariableSlot& slot)
 {
-    locals.try_emplace(&expr_ptr, distance);
-}
-
-shared_ptr_any Interpreter::lookUpVariable(const Token& identifier, const Expr* expr_ptr) const
-{
-    if (locals.contains(expr_ptr))
+    switch (slot.storage)
     {
-        size_t distance = locals.at(expr_ptr);
-        return environment->getAt(distance, identifier.lexeme);
+    case VariableSlot::Storage::FRAME:
+        return call_stack.local(slot.index);
+    case VariableSlot::Storage::UPVALUE:
+        assert(upvalues);
+        return *(*upvalues)[slot.index].as<Upvalue>()->location;
+    default:
+        return lookUpGlobal(identifier, slot);
     }
-
-    return global_environment->lookup(identifier);
 }
 
-void Interpreter::assignVariable(const Expr* expr_ptr, const Token& identifier,
-                                 const std::any& value)
+void Interpreter::assignVariable(const Token& identifier, const VariableSlot& slot,
+                                 const Value& value)
 {
-    // Check if the variable is defined in the local scope.
-    if (locals.contains(expr_ptr))
-    {
-        // If so, assign the value to the variable at the specific environment.
-        size_t distance = locals.at(expr_ptr);
-        environment->assignAt(distance, identifier, value);
-    }
-    // If the variable is not defined in the local scope.
-    else
+    if (slot.storage == VariableSlot::Storage::UPVALUE)
     {
-        // Assign the value to the variable in the global scope.
-        global_environment->assign(identifier, value);
+        // A closed upvalue holds the variable itself.
+        auto upvalue = (*upvalues)[slot.index].as<Upvalue>();
+        *upvalue->location = value;
+        heap.writeBarrier(upvalue, value);
+        return;
     }
+    lookUpVariable(identifier, slot) = value;
 }
 
 void Interpreter::visit(const ExprStmt& stmt)
@@ -173,7 +183,8 @@ void Interpreter::visit(const PrintStmt& stmt)
 
 void Interpreter::visit(const BlockStmt& stmt)
 {
-    executeBlock(stmt.statements, std::make_shared<Environment>(environment));
+    ScopeGuard scope_guard{*this, stmt.layout};
+    status = executeStatements(stmt.statements);
 }
 
 void Interpreter::visit(const ClassStmt& stmt)
@@ -182,7 +193,17 @@ void Interpreter::visit(const ClassStmt& stmt)
 
 void Interpreter::visit(const FnStmt& stmt)
 {
-    environment->define(stmt.identifier.lexeme, FunctionType(&stmt, environment));
+    // Capture the variables the function uses from the enclosing functions. Variables of the
+    // enclosing function are captured from its frame, the others are already upvalues of it.
+    std::vector<Value> captured;
+    captured.reserve(stmt.upvalues.size());
+    for (const auto& upvalue : stmt.upvalues)
+    {
+        captured.push_back(upvalue.is_local ? call_stack.captureUpvalue(upvalue.index)
+                                            : (*upvalues)[upvalue.index]);
+    }
+
+    define(stmt.identifier, stmt.slot, heap.allocate<FunctionType>(&stmt, std::move(captured)));
 }
 
 void Interpreter::visit(const IfStmt& stmt)
@@ -191,7 +212,7 @@ void Interpreter::visit(const IfStmt& stmt)
     if (isTruthy(evaluate(*stmt.main_branch.condition)))
     {
         // If it is, execute the statement
-        execute(*stmt.main_branch.statement);
+        status = execute(*stmt.main_branch.statement);
         return;
     }
 
@@ -201,7 +222,7 @@ void Interpreter::visit(const IfStmt& stmt)
         // If any elif branch's condition is truthy, execute its statement and return
         if (isTruthy(evaluate(*elif.condition)))
         {
-            execute(*elif.statement);
+            status = execute(*elif.statement);
             return;
         }
     }
@@ -209,43 +230,38 @@ void Interpreter::visit(const IfStmt& stmt)
     // If none of the conditions are true and there is an else branch, execute it.
     if (stmt.else_branch)
     {
-        execute(*stmt.else_branch);
+        status = execute(*stmt.else_branch);
     }
 }
 
 void Interpreter::visit(const ReturnStmt& stmt)
 {
-    std::any value;
     // If the return statement is not void, evaluate the expression.
-    if (stmt.expression)
-    {
-        value = evaluate(*stmt.expression);
-    }
-
-    throw ReturnException(value);
+    return_value = stmt.expression ? evaluate(*stmt.expression) : Value{};
+    status = ExecStatus::RETURN;
 }
 
 void Interpreter::visit(const BreakStmt& stmt)
 {
-    throw BreakException(stmt.keyword);
+    status = ExecStatus::BREAK;
 }
 
 void Interpreter::visit(const ContinueStmt& stmt)
 {
-    throw ContinueException(stmt.keyword);
+    status = ExecStatus::CONTINUE;
 }
 
 void Interpreter::visit(const VarStmt& stmt)
 {
-    std::any value;
+    Value value;
     // If the variable has an initializer, evaluate the initializer.
     if (stmt.initializer)
     {
         value = evaluate(*stmt.initializer);
     }
 
-    // Define the variable in the current environment with the given identifier and value
-    environment->define(stmt.identifier.lexeme, value);
+    // Define the variable in its slot with the given identifier and value
+    define(stmt.identifier, stmt.slot, value);
 }
 
 void Interpreter::visit(const WhileStmt& stmt)
@@ -253,19 +269,18 @@ void Interpreter::visit(const WhileStmt& stmt)
     // While the while loop condition is truthy.
     while (isTruthy(evaluate(*stmt.condition)))
     {
-        try
-        {
-            // Execute the loop's body.
-            execute(*stmt.body);
-        }
-        // If a continue statement is encountered, continue to the next iteration.
-        catch (const ContinueException&)
+        // Execute the loop's body. A continue statement simply moves on to the next iteration.
+        const auto result = execute(*stmt.body);
+
+        // If a break statement is encountered, exit the loop.
+        if (result == ExecStatus::BREAK)
         {
-            // Do nothing.
+            return;
         }
-        // If a break statement is encountered, exit the loop.
-        catch (const BreakException&)
+        // A return statement exits the loop and is passed on to the function call.
+        if (result == ExecStatus::RETURN)
         {
+            status = result;
             return;
         }
     }
@@ -273,8 +288,8 @@ void Interpreter::visit(const WhileStmt& stmt)
 
 void Interpreter::visit(const ForStmt& stmt)
 {
-    // Enter a new environment.
-    EnvironmentGuard environment_guard{*this, std::make_shared<Environment>(environment)};
+    // The loop variable lives in a scope surrounding the loop.
+    ScopeGuard scope_guard{*this, stmt.layout};
 
     // If the for loop has an initializer, we execute it.
     if (stmt.initializer)
@@ -288,48 +303,72 @@ void Interpreter::visit(const ForStmt& stmt)
     // While the for loop condition is truthy.
     while (no_condition || isTruthy(evaluate(*stmt.condition)))
     {
-        try
+        // Execute the for loop's body.
+        const auto result = execute(*stmt.body);
+
+        // If a break statement is encountered, exit the loop.
+        if (result == ExecStatus::BREAK)
         {
-            // Execute the for loop's body.
-            execute(*stmt.body);
-            // If the for loop has an increment, execute it.
-            if (stmt.increment)
-            {
-                evaluate(*stmt.increment);
-            }
+            return;
         }
-        // If a break statement is encountered, exit the loop.
-        catch (const BreakException&)
+        // A return statement exits the loop and is passed on to the function call.
+        if (result == ExecStatus::RETURN)
         {
+            status = result;
             return;
         }
-        // If a continue statement is encountered, continue to the next iteration.
-        catch (const ContinueException&)
+
+        // If the for loop has an increment, execute it. A continue statement also ends up here.
+        if (stmt.increment)
         {
-            if (stmt.increment)
-            {
-                evaluate(*stmt.increment);
-            }
+            evaluate(*stmt.increment);
         }
     }
 }
 
-std::any Interpreter::visit(const BinaryExpr& expr)
+Value Interpreter::concatenate(const Token& op, const Value& left, const Value& right)
 {
-    // Evaluate the left-hand side and right-hand side operands of the binary expression
-    auto left = evaluate(*expr.left);
-    auto right = evaluate(*expr.right);
+    if (!(left.isString() && (right.isString() || right.isNumber())) &&
+        !(left.isNumber() && right.isString()))
+    {
+        throw RuntimeError(op, "Operands must be of type string or number.");
+    }
 
-    // Dereference the pointer incase evaluate returns one
-    if (left.type() == typeid(shared_ptr_any))
+    // The new string may be a rope referring to the operands, so they are kept on the call stack
+    // while it is allocated.
+    const size_t top = call_stack.top();
+    call_stack.push(left);
+    call_stack.push(right);
+    String* result = nullptr;
+    if (left.isNumber())
+    {
+        result = heap.allocate<String>(numberToString(left.asNumber()), right.as<String>());
+    }
+    else if (right.isNumber())
     {
-        left = *(std::any_cast<shared_ptr_any>(left));
+        result = heap.allocate<String>(left.as<String>(), numberToString(right.asNumber()));
     }
+    else
+    {
+        result = heap.allocate<String>(left.as<String>(), right.as<String>());
+    }
+    call_stack.popTo(top);
+    return result;
+}
 
-    if (right.type() == typeid(shared_ptr_any))
+Value Interpreter::visit(const BinaryExpr& expr)
+{
+    // Evaluate the left-hand side and right-hand side operands of the binary expression. An
+    // object on the left is kept on the call stack while the right-hand side is evaluated, since
+    // that may collect garbage.
+    const size_t top = call_stack.top();
+    auto left = evaluate(*expr.left);
+    if (left.isObject())
     {
-        right = *(std::any_cast<shared_ptr_any>(right));
+        call_stack.push(left);
     }
+    auto right = evaluate(*expr.right);
+    call_stack.popTo(top);
 
     using enum TokenType;
     // Check the type of the operator.
@@ -337,37 +376,37 @@ std::any Interpreter::visit(const BinaryExpr& expr)
     {
     case MINUS:
         checkNumberOperands(expr.op, left, right);
-        return std::any_cast<double>(left) - std::any_cast<double>(right);
+        return left.asNumber() - right.asNumber();
 
     case SLASH:
         checkNumberOperands(expr.op, left, right);
 
         // Throw error if right operand is 0.
-        if (std::any_cast<double>(right) == 0)
+        if (right.asNumber() == 0)
         {
             throw RuntimeError(expr.op, "Division by 0.");
         }
-        return std::any_cast<double>(left) / std::any_cast<double>(right);
+        return left.asNumber() / right.asNumber();
 
     case STAR:
         checkNumberOperands(expr.op, left, right);
-        return std::any_cast<double>(left) * std::any_cast<double>(right);
+        return left.asNumber() * right.asNumber();
 
     case GREATER:
         checkNumberOperands(expr.op, left, right);
-        return std::any_cast<double>(left) > std::any_cast<double>(right);
+        return left.asNumber() > right.asNumber();
 
     case GREATER_EQUAL:
         checkNumberOperands(expr.op, left, right);
-        return std::any_cast<double>(left) >= std::any_cast<double>(right);
+        return left.asNumber() >= right.asNumber();
 
     case LESS:
         checkNumberOperands(expr.op, left, right);
-        return std::any_cast<double>(left) < std::any_cast<double>(right);
+        return left.asNumber() < right.asNumber();
 
     case LESS_EQUAL:
         checkNumberOperands(expr.op, left, right);
-        return std::any_cast<double>(left) <= std::any_cast<double>(right);
+        return left.asNumber() <= right.asNumber();
 
     case EQUAL_EQUAL:
         return isEqual(left, right);
@@ -376,49 +415,22 @@ std::any Interpreter::visit(const BinaryExpr& expr)
         return !isEqual(left, right);
 
     case PLUS:
-        if (left.type() == typeid(std::string) && right.type() == typeid(std::string))
-        {
-            return std::any_cast<std::string>(left) + std::any_cast<std::string>(right);
-        }
-        else if (left.type() == typeid(double) && right.type() == typeid(double))
-        {
-            return std::any_cast<double>(left) + std::any_cast<double>(right);
-        }
-        else if (left.type() == typeid(double) && right.type() == typeid(std::string))
-        {
-            // Remove trailing zeroes.
-            std::string num_as_string = std::to_string(std::any_cast<double>(left));
-            num_as_string.erase(num_as_string.find_last_not_of('0') + 1, std::string::npos);
-            num_as_string.erase(num_as_string.find_last_not_of('.') + 1, std::string::npos);
-            return num_as_string + std::any_cast<std::string>(right);
-        }
-        else if (left.type() == typeid(std::string) && right.type() == typeid(double))
+        if (left.isNumber() && right.isNumber())
         {
-            // Remove trailing zeroes.
-            std::string num_as_string = std::to_string(std::any_cast<double>(right));
-            num_as_string.erase(num_as_string.find_last_not_of('0') + 1, std::string::npos);
-            num_as_string.erase(num_as_string.find_last_not_of('.') + 1, std::string::npos);
-            return std::any_cast<std::string>(left) + num_as_string;
+            return left.asNumber() + right.asNumber();
         }
-
-        throw RuntimeError(expr.op, "Operands must be of type string or number.");
+        return concatenate(expr.op, left, right);
 
     default:
         return {};
     }
 }
 
-std::any Interpreter::visit(const UnaryExpr& expr)
+Value Interpreter::visit(const UnaryExpr& expr)
 {
     // Evaluate the right-hand side operand of the unary expression.
     auto right = evaluate(*expr.right);
 
-    // Dereference pointer incase evaluate returns one
-    if (right.type() == typeid(shared_ptr_any))
-    {
-        right = *(std::any_cast<shared_ptr_any>(right));
-    }
-
     // Check the type of the operator
     switch (expr.op.type)
     {
@@ -426,7 +438,7 @@ std::any Interpreter::visit(const UnaryExpr& expr)
         // Ensure that the right-hand side operand is a number.
         checkNumberOperand(expr.op, right);
         // Return the negation of the right-hand side operand.
-        return -(std::any_cast<double>(right));
+        return -right.asNumber();
 
     case TokenType::EXCLAMATION:
         // Return the negation of the truthiness of the right-hand side operand.
@@ -437,112 +449,97 @@ std::any Interpreter::visit(const UnaryExpr& expr)
     }
 }
 
-std::any Interpreter::visit(const VarExpr& expr)
+Value Interpreter::visit(const VarExpr& expr)
 {
-    // Retrieve the value associated with the identifier.
-    auto value = lookUpVariable(expr.identifier, &expr);
-
-    // If the value is of type list or string, return the pointer to the object.
-    if (const auto& value_type = std::any_cast<shared_ptr_any>(value)->type();
-        value_type == typeid(std::shared_ptr<List>) || value_type == typeid(std::string))
-    {
-        return value;
-    }
-
-    // Else return the objects value.
-    return *(std::any_cast<shared_ptr_any>(value));
+    // Retrieve the value associated with the identifier. Lists and strings are returned by
+    // reference, since the value only points to the underlying object.
+    return lookUpVariable(expr.identifier, expr.slot);
 }
 
-std::any Interpreter::visit(const GroupingExpr& expr)
+Value Interpreter::visit(const GroupingExpr& expr)
 {
     return evaluate(*expr.expression);
 }
 
-std::any Interpreter::visit(const LiteralExpr& expr)
+Value Interpreter::visit(const LiteralExpr& expr)
 {
     return expr.literal;
 }
 
-std::any Interpreter::visit(const AssignExpr& expr)
+Value Interpreter::visit(const AssignExpr& expr)
 {
     // Evaluate the assigned value.
     auto value = evaluate(*expr.value);
 
     // Assign the new value to the variable.
-    assignVariable(&expr, expr.identifier, value);
+    assignVariable(expr.identifier, expr.slot, value);
 
     return value;
 }
 
-std::any Interpreter::visit(const CallExpr& expr)
+Value Interpreter::visit(const CallExpr& expr)
 {
-    // Evaluate the callee (the function or class being called).
+    // Evaluate the callee (the function or class being called). It stays on the call stack during
+    // the call, so the garbage collector sees it.
+    const size_t callee_start = call_stack.top();
     auto callee = evaluate(*expr.callee);
+    call_stack.push(callee);
 
-    // Collect the arguments passed to the function or class.
-    std::vector<std::any> arguments;
-    arguments.reserve(expr.args.size());
+    // Push the arguments passed to the function or class onto the call stack, a function takes
+    // them as the start of its frame.
     for (const auto& arg : expr.args)
     {
-        arguments.emplace_back(evaluate(*arg));
+        call_stack.push(evaluate(*arg));
     }
+    const auto arguments = call_stack.topValues(expr.args.size());
 
     // Prevent calling objects which are not of callable type.
-    std::unique_ptr<Callable> function;
-    if (callee.type() == typeid(FunctionType))
-    {
-        function = std::make_unique<FunctionType>(std::any_cast<FunctionType>(callee));
-    }
-    else if (callee.type() == typeid(ClockCallable))
-    {
-        function = std::make_unique<ClockCallable>();
-    }
-    else if (callee.type() == typeid(PrintCallable))
-    {
-        function = std::make_unique<PrintCallable>(arguments.size());
-    }
-    else
+    if (!callee.isCallable())
     {
         // Throw an error if the callee is not callable (a function or class).
         throw RuntimeError(expr.paren,
-                           expr.paren.lexeme +
+                           std::string{expr.paren.lexeme} +
                                " is not callable. Callable object must be a function or a class.");
     }
 
+    const auto function = callee.as<Callable>();
+
     // Check that the number of arguments passed to the function or class
     // matches the expected number
-    if (arguments.size() != function->getArity())
+    if (!function->isVariadic() && arguments.size() != function->getArity())
     {
         throw RuntimeError(expr.paren, "Expected " + std::to_string(function->getArity()) +
                                            " arguments but got " +
                                            std::to_string(arguments.size()) + " .");
     }
 
-    // Return by calling the function.
-    return function->call(*this, arguments);
+    // Call the function and release its frame.
+    auto result = function->call(*this, arguments);
+    call_stack.popTo(callee_start);
+    return result;
 }
 
-std::any Interpreter::visit(const GetExpr& expr)
+Value Interpreter::visit(const GetExpr& expr)
 {
-    return std::any{};
+    return {};
 }
 
-std::any Interpreter::visit(const SetExpr& expr)
+Value Interpreter::visit(const SetExpr& expr)
 {
-    return std::any{};
+    return {};
 }
 
-std::any Interpreter::visit(const SuperExpr& expr)
+Value Interpreter::visit(const SuperExpr& expr)
 {
-    return std::any{};
+    return {};
 }
 
-std::any Interpreter::visit(const ThisExpr& expr)
+Value Interpreter::visit(const ThisExpr& expr)
 {
-    return std::any{};
+    return {};
 }
 
-std::any Interpreter::visit(const LogicalExpr& expr)
+Value Interpreter::visit(const LogicalExpr& expr)
 {
     // Evaluate the left operand of the logical expression.
     auto left = evaluate(*expr.left);
@@ -566,55 +563,53 @@ std::any Interpreter::visit(const LogicalExpr& expr)
     return evaluate(*expr.right);
 }
 
-std::any Interpreter::visit(const ListExpr& expr)
+Value Interpreter::visit(const ListExpr& expr)
 {
-    auto list = std::make_shared<List>();
-    // Evaluate each item contained in the list.
+    // Evaluate each item contained in the list. The items are kept on the call stack until the
+    // list holding them is created.
+    const size_t items_start = call_stack.top();
     for (const auto& item : expr.items)
     {
         assert(item);
-        list->append(evaluate((*item)));
+        call_stack.push(evaluate(*item));
     }
 
+    const auto items = call_stack.topValues(expr.items.size());
+    Value list{heap.allocate<List>(std::vector<Value>(items.begin(), items.end()))};
+    call_stack.popTo(items_start);
     return list;
 }
 
-std::any Interpreter::visit(const SubscriptExpr& stmt)
+Value Interpreter::visit(const SubscriptExpr& stmt)
 {
-    // Get the pointer to the list object associated with the provided identifier.
-    auto value_ptr = lookUpVariable(stmt.identifier, &stmt);
+    // Get the list object associated with the provided identifier. A copy of the value is kept on
+    // the call stack, so the list stays alive even if the index expression reassigns the variable.
+    const Value items = lookUpVariable(stmt.identifier, stmt.slot);
+    const size_t top = call_stack.top();
+    call_stack.push(items);
 
     // Check if the variable is a list, if not throw a runtime error.
-    if (value_ptr->type() != typeid(std::shared_ptr<List>))
+    if (!items.isList())
     {
         throw RuntimeError(stmt.identifier,
-                           "Object '" + stmt.identifier.lexeme + "' is not subscriptable.");
+                           "Object '" + std::string{stmt.identifier.lexeme} +
+                               "' is not subscriptable.");
     }
 
-    // Dereference the pointer to access the underlying objects pointer.
-    auto items = *(std::any_cast<shared_ptr_any>(value_ptr));
-
     // Evaluate the index expression.
     auto index = evaluate(*stmt.index);
-    double index_cast = 0;
 
     // Refers to the size of the original list object.
     size_t object_size = 0u;
 
     // Anything else than numbers for indexes are not allowed.
-    if (index.type() == typeid(int))
-    {
-        index_cast = static_cast<double>(std::any_cast<int>(index));
-    }
-    else if (index.type() == typeid(double))
-    {
-        index_cast = std::any_cast<double>(index);
-    }
-    else
+    if (!index.isNumber())
     {
         throw RuntimeError(stmt.identifier, "Indices must be integers.");
     }
 
+    double index_cast = index.asNumber();
+
     // Throw an error if index is not an integer.
     if (static_cast<int>(index_cast) != index_cast)
     {
@@ -623,7 +618,7 @@ std::any Interpreter::visit(const SubscriptExpr& stmt)
 
     try
     {
-        auto list = std::any_cast<std::shared_ptr<List>>(items);
+        auto list = items.as<List>();
         object_size = list->length();
 
         // Allows negative indexes for reverse order.
@@ -636,11 +631,15 @@ std::any Interpreter::visit(const SubscriptExpr& stmt)
         // corresponding index.
         if (stmt.value)
         {
-            list->at(index_cast) = evaluate(*stmt.value);
+            const Value value = evaluate(*stmt.value);
+            list->at(index_cast) = value;
+            heap.writeBarrier(list, value);
         }
 
         // Return the value at index.
-        return list->at(index_cast);
+        const Value item = list->at(index_cast);
+        call_stack.popTo(top);
+        return item;
     }
     catch (const std::out_of_range&)
     {
@@ -651,63 +650,66 @@ std::any Interpreter::visit(const SubscriptExpr& stmt)
     }
 }
 
-std::any Interpreter::visit(const IncrementExpr& expr)
+Value Interpreter::visit(const IncrementExpr& expr)
 {
     // Get the current value of the variable that is being incremented.
-    auto old_value = lookUpVariable(expr.identifier, &expr);
+    auto& value = lookUpVariable(expr.identifier, expr.slot);
 
-    if (old_value->type() != typeid(double))
+    if (!value.isNumber())
     {
         throw RuntimeError(expr.identifier,
-                           "Cannot increment a non integer type '" + expr.identifier.lexeme + "'.");
+                           "Cannot increment a non integer type '" +
+                               std::string{expr.identifier.lexeme} + "'.");
     }
 
     // Increment the value by 1.
-    const double new_value = std::any_cast<double>(*old_value) + 1;
+    const double new_value = value.asNumber() + 1;
 
-    // Update the object being pointed to by.
-    *old_value = std::any_cast<double>(*old_value) + 1;
+    // Update the variable in place.
+    value = new_value;
 
     // If the expression is a postfix increment, return the old value
     // otherwise return the new value.
     return expr.type == IncrementExpr::Type::POSTFIX ? new_value - 1 : new_value;
 }
 
-std::any Interpreter::visit(const DecrementExpr& expr)
+Value Interpreter::visit(const DecrementExpr& expr)
 {
     // Get the current value of the variable that is being incremented.
-    auto old_value = lookUpVariable(expr.identifier, &expr);
+    auto& value = lookUpVariable(expr.identifier, expr.slot);
 
-    if (old_value->type() != typeid(double))
+    if (!value.isNumber())
     {
         throw RuntimeError(expr.identifier,
-                           "Cannot decrement a non integer type '" + expr.identifier.lexeme + "'.");
+                           "Cannot decrement a non integer type '" +
+                               std::string{expr.identifier.lexeme} + "'.");
     }
 
     // Decrement the value by 1.
-    const double new_value = std::any_cast<double>(*old_value) - 1;
+    const double new_value = value.asNumber() - 1;
     // Assign the new value to the variable.
-    *old_value = std::any_cast<double>(*old_value) - 1;
+    value = new_value;
 
     // If the expression is a postfix increment, return the old value
     // otherwise return the new value.
     return expr.type == DecrementExpr::Type::POSTFIX ? new_value + 1 : new_value;
 }
 
-// The EnvironmentGuard class is used to manage the interpreter's environment stack. It follows the
-// RAII technique, which means that when an instance of the class is created, a copy of the current
-// environment is stored, and the current environment is moved to the new one. If a runtime error is
-// encountered and the interpreter needs to unwind the stack and return to the previous environment,
-// the EnvironmentGuard class's destructor is called, which swaps the resources back to the previous
-// environment.
-Interpreter::EnvironmentGuard::EnvironmentGuard(Interpreter& interpreter,
-                                                std::shared_ptr<Environment> enclosing_env)
-    : interpreter{interpreter}, previous_env{interpreter.environment}
+// The ScopeGuard class enters the scope of a block or a loop. It follows the RAII technique: the
+// constructor makes room for the scope's variables in the call frame, and the destructor closes the
+// upvalues of the variables captured by closures, however the scope is left. The closures keep the
+// values, while the frame slots are reused by the code that follows the scope, e.g. the next
+// iteration of a loop.
+Interpreter::ScopeGuard::ScopeGuard(Interpreter& interpreter, const ScopeLayout& layout)
+    : interpreter{interpreter}, layout{layout}
 {
-    interpreter.environment = std::move(enclosing_env);
+    interpreter.call_stack.extendFrame(layout.frame_size);
 }
 
-Interpreter::EnvironmentGuard::~EnvironmentGuard()
+Interpreter::ScopeGuard::~ScopeGuard()
 {
-    interpreter.environment = std::move(previous_env);
-}
\ No newline at end of file
+    if (layout.is_captured)
+    {
+        interpreter.call_stack.closeUpvalues(layout.first_slot);
+    }
+}
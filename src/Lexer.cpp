@@ -1,35 +1,281 @@
 #include "../include/Lexer.hpp"
 #include "../include/Logger.hpp"
+#include <array>
+#include <bit>
+#include <cstdint>
 
-const std::unordered_map<std::string, TokenType> Lexer::keywords{
-    {"and", TokenType::AND},      {"or", TokenType::OR},
-    {"class", TokenType::CLASS},  {"if", TokenType::IF},
-    {"else", TokenType::ELSE},    {"elif", TokenType::ELIF},
-    {"false", TokenType::_FALSE}, {"true", TokenType::_TRUE},
-    {"fn", TokenType::FN},        {"for", TokenType::FOR},
-    {"while", TokenType::WHILE},  {"nil", TokenType::NIL},
-    {"print", TokenType::PRINT},  {"return", TokenType::RETURN},
-    {"super", TokenType::SUPER},  {"this", TokenType::THIS},
-    {"var", TokenType::VAR},      {"lambda", TokenType::LAMBDA},
-    {"break", TokenType::BREAK},  {"continue", TokenType::CONTINUE}};
+#if defined(JLOX_SIMD_LEXER) && (defined(__AVX2__) || defined(__SSE2__))
+#include <immintrin.h>
+#define JLOX_LEXER_VECTORS
+#endif
 
-Lexer::Lexer(std::string source) : source{std::move(source)}
+namespace
+{
+#ifdef JLOX_LEXER_VECTORS
+    // Runs of characters are scanned a vector at a time. A comparison sets every byte of the
+    // characters that match to 0xFF, and its mask has one bit per character.
+#ifdef __AVX2__
+    using Vector = __m256i;
+    using Mask = uint32_t;
+
+    Vector load(const char* chars)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const Vector*>(chars));
+    }
+
+    Vector splat(char c) { return _mm256_set1_epi8(c); }
+    Vector equal(Vector a, Vector b) { return _mm256_cmpeq_epi8(a, b); }
+    Vector greater(Vector a, Vector b) { return _mm256_cmpgt_epi8(a, b); }
+    Vector either(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+    Vector both(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+    Mask mask(Vector matches) { return static_cast<Mask>(_mm256_movemask_epi8(matches)); }
+#else
+    using Vector = __m128i;
+    using Mask = uint16_t;
+
+    Vector load(const char* chars)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const Vector*>(chars));
+    }
+
+    Vector splat(char c) { return _mm_set1_epi8(c); }
+    Vector equal(Vector a, Vector b) { return _mm_cmpeq_epi8(a, b); }
+    Vector greater(Vector a, Vector b) { return _mm_cmpgt_epi8(a, b); }
+    Vector either(Vector a, Vector b) { return _mm_or_si128(a, b); }
+    Vector both(Vector a, Vector b) { return _mm_and_si128(a, b); }
+    Mask mask(Vector matches) { return static_cast<Mask>(_mm_movemask_epi8(matches)); }
+#endif
+
+    constexpr size_t VECTOR_SIZE = sizeof(Vector);
+
+    Vector equal(Vector chars, char c) { return equal(chars, splat(c)); }
+
+    // Compares as signed bytes, so characters outside of ASCII are never in the range.
+    Vector inRange(Vector chars, char low, char high)
+    {
+        return both(greater(chars, splat(static_cast<char>(low - 1))),
+                    greater(splat(static_cast<char>(high + 1)), chars));
+    }
+#endif
+
+    struct Keyword
+    {
+        std::string_view name;
+        TokenType type;
+    };
+
+    // The single list of keywords, from which the table below is generated at compile time.
+    constexpr std::array<Keyword, 20> KEYWORDS{{
+        {"and", TokenType::AND},      {"or", TokenType::OR},
+        {"class", TokenType::CLASS},  {"if", TokenType::IF},
+        {"else", TokenType::ELSE},    {"elif", TokenType::ELIF},
+        {"false", TokenType::_FALSE}, {"true", TokenType::_TRUE},
+        {"fn", TokenType::FN},        {"for", TokenType::FOR},
+        {"while", TokenType::WHILE},  {"nil", TokenType::NIL},
+        {"print", TokenType::PRINT},  {"return", TokenType::RETURN},
+        {"super", TokenType::SUPER},  {"this", TokenType::THIS},
+        {"var", TokenType::VAR},      {"lambda", TokenType::LAMBDA},
+        {"break", TokenType::BREAK},  {"continue", TokenType::CONTINUE}}};
+
+    constexpr size_t KEYWORD_TABLE_SIZE = 64u;
+
+    // Mixes the length and the first and last characters of a word, which together tell the
+    // keywords apart. A word can only be the keyword stored in the slot it hashes to.
+    constexpr size_t keywordSlot(std::string_view word, size_t multiplier)
+    {
+        return (static_cast<unsigned char>(word.front()) * multiplier +
+                static_cast<unsigned char>(word.back()) + word.size()) %
+               KEYWORD_TABLE_SIZE;
+    }
+
+    // The smallest multiplier for which no two keywords share a slot (a perfect hash), or 0.
+    constexpr size_t findKeywordMultiplier()
+    {
+        for (size_t multiplier = 1u; multiplier < 256u; ++multiplier)
+        {
+            std::array<bool, KEYWORD_TABLE_SIZE> taken{};
+            bool perfect = true;
+            for (const Keyword& keyword : KEYWORDS)
+            {
+                bool& slot = taken[keywordSlot(keyword.name, multiplier)];
+                perfect = perfect && !slot;
+                slot = true;
+            }
+            if (perfect)
+            {
+                return multiplier;
+            }
+        }
+        return 0u;
+    }
+
+    constexpr size_t KEYWORD_MULTIPLIER = findKeywordMultiplier();
+    static_assert(KEYWORD_MULTIPLIER != 0u, "Keywords collide, grow KEYWORD_TABLE_SIZE");
+
+    // Slots without a keyword have an empty name, which no word matches.
+    constexpr std::array<Keyword, KEYWORD_TABLE_SIZE> KEYWORD_TABLE = [] {
+        std::array<Keyword, KEYWORD_TABLE_SIZE> table{};
+        for (const Keyword& keyword : KEYWORDS)
+        {
+            table[keywordSlot(keyword.name, KEYWORD_MULTIPLIER)] = keyword;
+        }
+        return table;
+    }();
+
+    // Character classes skipped in runs, checked one character at a time or a vector at a time.
+    struct Whitespace
+    {
+        static bool matches(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+#ifdef JLOX_LEXER_VECTORS
+        static Vector matches(Vector chars)
+        {
+            return either(either(equal(chars, ' '), equal(chars, '\t')),
+                          either(equal(chars, '\r'), equal(chars, '\n')));
+        }
+#endif
+    };
+
+    struct Digit
+    {
+        static bool matches(char c) { return c >= '0' && c <= '9'; }
+
+#ifdef JLOX_LEXER_VECTORS
+        static Vector matches(Vector chars) { return inRange(chars, '0', '9'); }
+#endif
+    };
+
+    struct IdentifierCharacter
+    {
+        static bool matches(char c)
+        {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+                   Digit::matches(c);
+        }
+
+#ifdef JLOX_LEXER_VECTORS
+        static Vector matches(Vector chars)
+        {
+            // Setting the 0x20 bit turns upper case letters into lower case ones, and no other
+            // character into a letter.
+            return either(either(inRange(either(chars, splat(0x20)), 'a', 'z'), equal(chars, '_')),
+                          Digit::matches(chars));
+        }
+#endif
+    };
+
+    // Position of the first character at or after `position` which isn't in the class.
+    template <typename Class>
+    size_t skipWhile(std::string_view source, size_t position)
+    {
+#ifdef JLOX_LEXER_VECTORS
+        for (; position + VECTOR_SIZE <= source.size(); position += VECTOR_SIZE)
+        {
+            const Vector chars = load(source.data() + position);
+            if (const auto others = static_cast<Mask>(~mask(Class::matches(chars))))
+            {
+                return position + std::countr_zero(others);
+            }
+        }
+#endif
+        while (position < source.size() && Class::matches(source[position]))
+        {
+            ++position;
+        }
+        return position;
+    }
+
+    // Position of the first `c` at or after `position`, or the end of the source.
+    template <char C>
+    size_t find(std::string_view source, size_t position)
+    {
+#ifdef JLOX_LEXER_VECTORS
+        for (; position + VECTOR_SIZE <= source.size(); position += VECTOR_SIZE)
+        {
+            if (const Mask found = mask(equal(load(source.data() + position), C)))
+            {
+                return position + std::countr_zero(found);
+            }
+        }
+#endif
+        while (position < source.size() && source[position] != C)
+        {
+            ++position;
+        }
+        return position;
+    }
+
+    // Number of line breaks from `begin` up to `end`.
+    unsigned int countLines(std::string_view source, size_t begin, size_t end)
+    {
+        unsigned int lines = 0u;
+#ifdef JLOX_LEXER_VECTORS
+        for (; begin + VECTOR_SIZE <= end; begin += VECTOR_SIZE)
+        {
+            lines += std::popcount(mask(equal(load(source.data() + begin), '\n')));
+        }
+#endif
+        for (; begin < end; ++begin)
+        {
+            lines += source[begin] == '\n';
+        }
+        return lines;
+    }
+}
+
+Lexer::Lexer(std::string_view source) : source{source}
+{
+}
+
+Lexer::Lexer(std::string_view source, unsigned int begin, unsigned int line)
+    : source{source}, current{begin}, line{line}
 {
 }
 
 std::vector<Token> Lexer::scanTokens()
 {
-    while (!isEOF())
+    // Code averages more than 4 characters per token, whitespace included, so the tokens rarely
+    // have to be moved to a larger buffer. Pages of the reserve which are never written aren't
+    // committed.
+    std::vector<Token> tokens;
+    tokens.reserve((source.size() - current) / 4u + 1u);
+    while (true)
     {
+        skipWhitespace();
+        if (isEOF())
+        {
+            break;
+        }
         start = current;
-        scanToken();
+        if (const auto type = scanToken())
+        {
+            tokens.emplace_back(*type, getLexeme(*type), line, start);
+        }
     }
 
-    tokens.emplace_back(TokenType::_EOF, "", line);
+    tokens.emplace_back(TokenType::_EOF, "", line, current);
     return tokens;
 }
 
-void Lexer::scanToken()
+Token Lexer::nextToken()
+{
+    // Comments and invalid characters don't make a token, scanning goes on after them.
+    while (true)
+    {
+        skipWhitespace();
+        if (isEOF())
+        {
+            return {TokenType::_EOF, "", line, current};
+        }
+        start = current;
+        if (const auto type = scanToken())
+        {
+            return {*type, getLexeme(*type), line, start};
+        }
+    }
+}
+
+std::optional<TokenType> Lexer::scanToken()
 {
     char c = peek();
     advance();
@@ -38,155 +284,124 @@ void Lexer::scanToken()
     {
     // 1 character lexemes.
     case '(':
-        addToken(LEFT_PAREN);
-        break;
+        return LEFT_PAREN;
     case ')':
-        addToken(RIGHT_PAREN);
-        break;
+        return RIGHT_PAREN;
     case '{':
-        addToken(LEFT_BRACE);
-        break;
+        return LEFT_BRACE;
     case '}':
-        addToken(RIGHT_BRACE);
-        break;
+        return RIGHT_BRACE;
     case '[':
-        addToken(LEFT_BRACKET);
-        break;
+        return LEFT_BRACKET;
     case ']':
-        addToken(RIGHT_BRACKET);
-        break;
+        return RIGHT_BRACKET;
     case ',':
-        addToken(COMMA);
-        break;
+        return COMMA;
     case '.':
-        addToken(DOT);
-        break;
+        return DOT;
     case ';':
-        addToken(SEMICOLON);
-        break;
+        return SEMICOLON;
     case '*':
-        addToken(STAR);
-        break;
+        return STAR;
 
         // > 1 character lexemes.
     case '!':
-        addToken(match('=') ? EXCLAMATION_EQUAL : EXCLAMATION);
-        break;
+        return match('=') ? EXCLAMATION_EQUAL : EXCLAMATION;
     case '=':
-        addToken(match('=') ? EQUAL_EQUAL : EQUAL);
-        break;
+        return match('=') ? EQUAL_EQUAL : EQUAL;
     case '-':
-        addToken(match('-') ? MINUS_MINUS : MINUS);
-        break;
+        return match('-') ? MINUS_MINUS : MINUS;
     case '+':
-        addToken(match('+') ? PLUS_PLUS : PLUS);
-        break;
+        return match('+') ? PLUS_PLUS : PLUS;
     case '<':
-        addToken(match('=') ? LESS_EQUAL : LESS);
-        break;
+        return match('=') ? LESS_EQUAL : LESS;
     case '>':
-        addToken(match('=') ? GREATER_EQUAL : GREATER);
-        break;
+        return match('=') ? GREATER_EQUAL : GREATER;
     case '/':
         if (match('/'))
         {
-            while (peek() != '\n' && !isEOF())
-            {
-                advance();
-            }
-        }
-        else
-        {
-            addToken(SLASH);
+            // The line break is skipped with the whitespace after the comment.
+            current = static_cast<unsigned int>(find<'\n'>(source, current));
+            return std::nullopt;
         }
-
-        // ignore whitespace.
-    case ' ':
-    case '\r':
-    case '\t':
-        break;
-    case '\n':
-        line++;
-        break;
+        return SLASH;
 
         // Literals.
     case '"':
-        string();
-        break;
+        return string();
     default:
         if (isDigit(c))
         {
-            number();
-        }
-        else if (isAlpha(c))
-        {
-            identifier();
+            return number();
         }
-        else
+        if (isAlpha(c))
         {
-            Error::addError(line, "", std::string("Unexpected character: '") + c + "'.");
+            return identifier();
         }
+        Error::addError(line, "", std::string("Unexpected character: '") + c + "'.");
+        return std::nullopt;
     }
 }
 
-void Lexer::identifier()
+void Lexer::skipWhitespace()
 {
-    while (isAlphaNumeric(peek()))
-    {
-        advance();
-    }
+    const size_t end = skipWhile<Whitespace>(source, current);
+    line += countLines(source, current, end);
+    current = static_cast<unsigned int>(end);
+}
 
-    const std::string text = source.substr(start, current - start);
-    addToken(keywords.contains(text) ? keywords.at(text) : TokenType::IDENTIFIER);
+TokenType Lexer::identifier()
+{
+    current = static_cast<unsigned int>(skipWhile<IdentifierCharacter>(source, current));
+
+    return identifierType(source.substr(start, current - start));
 }
 
-void Lexer::number()
+TokenType Lexer::identifierType(std::string_view lexeme)
 {
-    while (isDigit(peek()))
+    if (lexeme.empty())
     {
-        advance();
+        return TokenType::IDENTIFIER;
     }
+    const Keyword& keyword = KEYWORD_TABLE[keywordSlot(lexeme, KEYWORD_MULTIPLIER)];
+    return keyword.name == lexeme ? keyword.type : TokenType::IDENTIFIER;
+}
+
+TokenType Lexer::number()
+{
+    current = static_cast<unsigned int>(skipWhile<Digit>(source, current));
 
     // Look for a fractional part.
     if (peek() == '.' && isDigit(peekNext()))
     {
         // Consume the "."
         advance();
-        while (isDigit(peek()))
-        {
-            advance();
-        }
+        current = static_cast<unsigned int>(skipWhile<Digit>(source, current));
     }
 
-    addToken(TokenType::NUMBER);
+    return TokenType::NUMBER;
 }
 
-void Lexer::string()
+std::optional<TokenType> Lexer::string()
 {
-    while (peek() != '"' && !isEOF())
-    {
-        if (peek() == '\n')
-        {
-            line++;
-        }
-        advance();
-    }
+    const size_t end = find<'"'>(source, current);
+    line += countLines(source, current, end);
+    current = static_cast<unsigned int>(end);
     if (isEOF())
     {
         Error::addError(line, "", "Unterminated string.");
-        return;
+        return std::nullopt;
     }
 
     // Consume the closing ".
     advance();
 
-    // Trim the surrounding quotes.
-    addToken(TokenType::STRING);
+    return TokenType::STRING;
 }
 
 bool Lexer::match(char expected)
 {
-    if (isEOF() || source.at(current) != expected)
+    if (isEOF() || source[current] != expected)
     {
         return false;
     }
@@ -197,12 +412,12 @@ bool Lexer::match(char expected)
 
 char Lexer::peek() const
 {
-    return isEOF() ? '\0' : source.at(current);
+    return isEOF() ? '\0' : source[current];
 }
 
 char Lexer::peekNext() const
 {
-    return (current + 1 >= source.length()) ? '\0' : source.at(current + 1);
+    return (current + 1 >= source.length()) ? '\0' : source[current + 1];
 }
 
 bool Lexer::isAlpha(char c) const
@@ -210,11 +425,6 @@ bool Lexer::isAlpha(char c) const
     return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c == '_'));
 }
 
-bool Lexer::isAlphaNumeric(char c) const
-{
-    return isAlpha(c) || isDigit(c);
-}
-
 bool Lexer::isDigit(char c) const
 {
     return c >= '0' && c <= '9';
@@ -230,13 +440,8 @@ void Lexer::advance()
     current++;
 }
 
-std::string Lexer::getLexeme(TokenType type) const
+std::string_view Lexer::getLexeme(TokenType type) const
 {
     return (type == TokenType::STRING) ? source.substr(start + 1, current - start - 2)
                                        : source.substr(start, current - start);
 }
-
-void Lexer::addToken(const TokenType type)
-{
-    tokens.emplace_back(type, getLexeme(type), line);
-}
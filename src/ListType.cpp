@@ -1,7 +1,13 @@
 #include "../include/ListType.hpp"
+#include "../include/Heap.hpp"
 #include "../include/RuntimeError.hpp"
 
-List::List(std::vector<std::any> values) : values{std::move(values)}, len{this->values.size()}
+List::List() : Object{ObjectType::LIST}
+{
+}
+
+List::List(std::vector<Value> values)
+    : Object{ObjectType::LIST}, values{std::move(values)}, len{this->values.size()}
 {
 }
 
@@ -10,18 +16,18 @@ size_t List::length() const noexcept
     return len;
 }
 
-std::any& List::at(int index)
+Value& List::at(int index)
 {
     return index < 0 ? values.at(len + index) : values.at(index);
 }
 
-void List::append(const std::any& value)
+void List::append(const Value& value)
 {
     values.push_back(value);
     len += 1;
 }
 
-std::any List::pop() noexcept
+Value List::pop() noexcept
 {
     const auto value = values.back();
     values.pop_back();
@@ -43,3 +49,16 @@ void List::remove(int index)
 
     len -= 1;
 }
+
+void List::trace(Heap& heap) const
+{
+    for (const auto& value : values)
+    {
+        heap.mark(value);
+    }
+}
+
+size_t List::ownedBytes() const noexcept
+{
+    return values.capacity() * sizeof(Value);
+}
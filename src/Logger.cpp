@@ -2,8 +2,8 @@
 
 namespace Error
 {
-    std::vector<ErrorInfo> exceptionList{};
-    bool hadError = false;
+    thread_local std::vector<ErrorInfo> exceptionList{};
+    thread_local bool hadError = false;
     bool hadRuntimeError = false;
 
     void addRuntimeError(const RuntimeError& error) noexcept
@@ -26,7 +26,8 @@ namespace Error
         }
         else
         {
-            exceptionList.emplace_back(token.line, "at '" + token.lexeme + "'", std::move(message));
+            exceptionList.emplace_back(token.line, "at '" + std::string{token.lexeme} + "'",
+                                       std::move(message));
         }
 
         hadError = true;
@@ -0,0 +1,81 @@
+#include "../include/MappedFile.hpp"
+#include <cerrno>
+#include <system_error>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define JLOX_MMAP
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace
+{
+    std::system_error fileError(const std::string& path)
+    {
+        return {errno, std::generic_category(), "Failed to open file " + path};
+    }
+}
+
+#ifdef JLOX_MMAP
+MappedFile::MappedFile(const std::string& path)
+{
+    const int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        throw fileError(path);
+    }
+
+    struct stat status;
+    if (fstat(descriptor, &status) < 0)
+    {
+        const auto error = fileError(path);
+        close(descriptor);
+        throw error;
+    }
+
+    // Empty files can't be mapped, nor do they need to be. The mapping stays valid once the file
+    // is closed.
+    const auto size = static_cast<size_t>(status.st_size);
+    void* data = size == 0u ? nullptr : mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (data == MAP_FAILED)
+    {
+        const auto error = fileError(path);
+        close(descriptor);
+        throw error;
+    }
+    close(descriptor);
+
+    if (data != nullptr)
+    {
+        // The lexer reads the source front to back.
+        madvise(data, size, MADV_SEQUENTIAL);
+        view = {static_cast<const char*>(data), size};
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (!view.empty())
+    {
+        munmap(const_cast<char*>(view.data()), view.size());
+    }
+}
+#else
+MappedFile::MappedFile(const std::string& path)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+    {
+        throw fileError(path);
+    }
+    buffer.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+    view = buffer;
+}
+
+MappedFile::~MappedFile() = default;
+#endif
@@ -0,0 +1,182 @@
+#include "../include/ParallelParser.hpp"
+#include "../include/Lexer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <thread>
+
+namespace
+{
+    bool isIdentifierCharacter(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+               c == '_';
+    }
+
+    bool startsStatement(std::string_view source, size_t position)
+    {
+        size_t end = position;
+        while (end < source.size() && isIdentifierCharacter(source[end]))
+        {
+            ++end;
+        }
+
+        using enum TokenType;
+        switch (Lexer::identifierType(source.substr(position, end - position)))
+        {
+        case FN:
+        case VAR:
+        case CLASS:
+        case IF:
+        case FOR:
+        case WHILE:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // What a worker made of a chunk.
+    struct ParsedChunk
+    {
+        Ast ast;
+        std::vector<Error::ErrorInfo> errors;
+    };
+}
+
+ParallelParser::ParallelParser(unsigned int threads, size_t chunk_size, bool lazy_functions)
+    : threads{std::max(threads, 1u)}, chunk_size{std::max<size_t>(chunk_size, 1u)},
+      lazy_functions{lazy_functions}
+{
+}
+
+std::vector<ParallelParser::Chunk> ParallelParser::split(std::string_view source,
+                                                         size_t chunk_size)
+{
+    std::vector<Chunk> chunks;
+    Chunk chunk{0u, 0u, 1u};
+    unsigned int line = 1u;
+    unsigned int depth = 0u;
+    // The last character of the previous token.
+    char previous = '\0';
+    for (size_t i = 0u; i < source.size(); ++i)
+    {
+        const char c = source[i];
+        switch (c)
+        {
+        case '\n':
+            ++line;
+            break;
+        case ' ':
+        case '\t':
+        case '\r':
+            break;
+        case '"':
+        {
+            const size_t end = std::min(source.find('"', i + 1u), source.size());
+            line += static_cast<unsigned int>(std::count(source.begin() + i, source.begin() + end,
+                                                         '\n'));
+            i = end;
+            previous = c;
+            break;
+        }
+        case '/':
+            if (i + 1u < source.size() && source[i + 1u] == '/')
+            {
+                // Stop before the line break, which is counted on the next iteration.
+                i = std::min(source.find('\n', i), source.size()) - 1u;
+            }
+            else
+            {
+                previous = c;
+            }
+            break;
+        case '(':
+        case '[':
+        case '{':
+            ++depth;
+            previous = c;
+            break;
+        case ')':
+        case ']':
+        case '}':
+            depth -= depth > 0u;
+            previous = c;
+            break;
+        default:
+            if (depth == 0u && (previous == ';' || previous == '}') &&
+                i - chunk.begin >= chunk_size && startsStatement(source, i))
+            {
+                chunk.end = static_cast<unsigned int>(i);
+                chunks.push_back(chunk);
+                chunk = {static_cast<unsigned int>(i), 0u, line};
+            }
+            previous = c;
+        }
+    }
+
+    chunk.end = static_cast<unsigned int>(source.size());
+    chunks.push_back(chunk);
+    return chunks;
+}
+
+Ast ParallelParser::parse(std::string_view source) const
+{
+    const std::vector<Chunk> chunks = split(source, chunk_size);
+    std::vector<ParsedChunk> parsed(chunks.size());
+
+    // The workers take the next chunk until there are none left.
+    std::atomic<size_t> next_chunk{0u};
+    std::vector<std::exception_ptr> failures(chunks.size());
+    auto work = [&]() {
+        for (size_t i = next_chunk++; i < chunks.size(); i = next_chunk++)
+        {
+            try
+            {
+                const Chunk& chunk = chunks[i];
+                Lexer lexer{source.substr(0u, chunk.end), chunk.begin, chunk.line};
+                Parser parser{lexer, lazy_functions};
+                parsed[i].ast = parser.parse();
+                parsed[i].errors = std::exchange(Error::exceptionList, {});
+                Error::hadError = false;
+            }
+            catch (...)
+            {
+                failures[i] = std::current_exception();
+            }
+        }
+    };
+
+    // The calling thread is one of the workers, its earlier errors are set aside meanwhile.
+    auto earlier_errors = std::exchange(Error::exceptionList, {});
+    const bool had_error = std::exchange(Error::hadError, false);
+    std::vector<std::jthread> pool;
+    for (size_t i = 1u; i < std::min<size_t>(threads, chunks.size()); ++i)
+    {
+        pool.emplace_back(work);
+    }
+    work();
+    pool.clear();
+    Error::exceptionList = std::move(earlier_errors);
+    Error::hadError = had_error;
+
+    Ast ast{std::make_unique<Arena>(), {}};
+    for (size_t i = 0u; i < chunks.size(); ++i)
+    {
+        if (failures[i])
+        {
+            std::rethrow_exception(failures[i]);
+        }
+        auto& [chunk_ast, errors] = parsed[i];
+        ast.arena->adopt(std::move(chunk_ast.arena));
+        std::move(chunk_ast.statements.begin(), chunk_ast.statements.end(),
+                  std::back_inserter(ast.statements));
+        Error::hadError = Error::hadError || !errors.empty();
+        for (const Error::ErrorInfo& error : errors)
+        {
+            Error::exceptionList.push_back(error);
+        }
+    }
+    return ast;
+}
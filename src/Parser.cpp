@@ -1,19 +1,38 @@
 #include "../include/Parser.hpp"
+#include "../include/StringTable.hpp"
+#include <charconv>
 #define void_cast(x) (static_cast<void>(x))
 
+Parser::Parser(Lexer& lexer, bool lazy_functions) : lexer{&lexer}, lazy_functions{lazy_functions}
+{
+    current_token.emplace(pullToken());
+}
+
 Parser::Parser(std::vector<Token> tokens) : tokens{std::move(tokens)}
 {
+    current_token.emplace(pullToken());
 }
 
-std::vector<unique_stmt_ptr> Parser::parse()
+Ast Parser::parse()
 {
-    std::vector<unique_stmt_ptr> statements;
+    ast_vector<unique_stmt_ptr> statements{arena->memoryResource()};
     while (!isAtEnd())
     {
-        statements.emplace_back(declaration());
+        statements.emplace_back(declaration(lazy_functions));
     }
 
-    return statements;
+    return {std::exchange(arena, std::make_unique<Arena>()), std::move(statements)};
+}
+
+Ast Parser::parseDeclaration()
+{
+    ast_vector<unique_stmt_ptr> statements{arena->memoryResource()};
+    if (!isAtEnd())
+    {
+        statements.emplace_back(declaration(lazy_functions));
+    }
+
+    return {std::exchange(arena, std::make_unique<Arena>()), std::move(statements)};
 }
 
 unique_stmt_ptr Parser::statement()
@@ -29,7 +48,7 @@ unique_stmt_ptr Parser::statement()
     if (match({TokenType::WHILE}))
         return whileStatement();
     if (match({TokenType::LEFT_BRACE}))
-        return std::make_unique<BlockStmt>(block());
+        return arena->create<BlockStmt>(block());
     if (match({TokenType::BREAK, TokenType::CONTINUE}))
         return controlStatement();
 
@@ -43,13 +62,13 @@ unique_stmt_ptr Parser::controlStatement()
     if (token.type == TokenType::BREAK)
     {
         void_cast(consume(TokenType::SEMICOLON, "Expect ';' after break."));
-        stmt = std::make_unique<BreakStmt>(std::move(token));
+        stmt = arena->create<BreakStmt>(std::move(token));
     }
 
     else if (token.type == TokenType::CONTINUE)
     {
         void_cast(consume(TokenType::SEMICOLON, "Expect ';' after continue)."));
-        stmt = std::make_unique<ContinueStmt>(std::move(token));
+        stmt = arena->create<ContinueStmt>(std::move(token));
     }
 
     return stmt;
@@ -92,8 +111,8 @@ unique_stmt_ptr Parser::forStatement()
     auto increment = forExpression(TokenType::RIGHT_PAREN, "Expect ')' after for clauses.");
     auto body = statement();
 
-    return std::make_unique<ForStmt>(std::move(initializer), std::move(condition),
-                                     std::move(increment), std::move(body));
+    return arena->create<ForStmt>(std::move(initializer), std::move(condition),
+                                  std::move(increment), std::move(body));
 }
 
 unique_stmt_ptr Parser::ifStatement()
@@ -104,7 +123,7 @@ unique_stmt_ptr Parser::ifStatement()
     auto then_statement = statement();
 
     IfBranch main_branch{std::move(if_condition), std::move(then_statement)};
-    std::vector<IfBranch> elif_branches;
+    ast_vector<IfBranch> elif_branches{arena->memoryResource()};
 
     while (match({TokenType::ELIF}))
     {
@@ -121,18 +140,18 @@ unique_stmt_ptr Parser::ifStatement()
         else_branch = statement();
     }
 
-    return std::make_unique<IfStmt>(std::move(main_branch), std::move(elif_branches),
-                                    std::move(else_branch));
+    return arena->create<IfStmt>(std::move(main_branch), std::move(elif_branches),
+                                 std::move(else_branch));
 }
 
-unique_stmt_ptr Parser::declaration()
+unique_stmt_ptr Parser::declaration(bool lazy_function)
 {
     try
     {
         if (match({TokenType::VAR}))
             return varDeclaration();
         if (match({TokenType::FN}))
-            return function("function");
+            return function("function", lazy_function);
 
         return statement();
     }
@@ -152,10 +171,10 @@ unique_stmt_ptr Parser::printStatement()
         throw error(identifier, "Expect '(' after 'print'.");
     }
 
-    auto expr = finishCall(std::make_unique<VarExpr>(std::move(identifier)));
+    auto expr = finishCall(arena->create<VarExpr>(std::move(identifier)));
     void_cast(consume(TokenType::SEMICOLON, "Expect ';' after print statement."));
 
-    return std::make_unique<PrintStmt>(std::move(expr));
+    return arena->create<PrintStmt>(std::move(expr));
 }
 
 unique_stmt_ptr Parser::returnStatement()
@@ -169,7 +188,7 @@ unique_stmt_ptr Parser::returnStatement()
 
     void_cast(consume(TokenType::SEMICOLON, "Expect ';' after return value."));
 
-    return std::make_unique<ReturnStmt>(std::move(keyword), std::move(value));
+    return arena->create<ReturnStmt>(std::move(keyword), std::move(value));
 }
 
 unique_stmt_ptr Parser::varDeclaration()
@@ -179,7 +198,7 @@ unique_stmt_ptr Parser::varDeclaration()
 
     void_cast(consume(TokenType::SEMICOLON, "Expect ';' after variable declaration."));
 
-    return std::make_unique<VarStmt>(std::move(identifier), std::move(initializer));
+    return arena->create<VarStmt>(std::move(identifier), std::move(initializer));
 }
 
 unique_stmt_ptr Parser::whileStatement()
@@ -189,7 +208,7 @@ unique_stmt_ptr Parser::whileStatement()
     void_cast(consume(TokenType::RIGHT_PAREN, "Expect a ')' after 'while'."));
     auto body = statement();
 
-    return std::make_unique<WhileStmt>(std::move(condition), std::move(body));
+    return arena->create<WhileStmt>(std::move(condition), std::move(body));
 }
 
 unique_stmt_ptr Parser::expressionStatement()
@@ -197,14 +216,14 @@ unique_stmt_ptr Parser::expressionStatement()
     auto expr = expression();
     void_cast(consume(TokenType::SEMICOLON, "Expect ';' after value."));
 
-    return std::make_unique<ExprStmt>(std::move(expr));
+    return arena->create<ExprStmt>(std::move(expr));
 }
 
-unique_stmt_ptr Parser::function(const std::string& kind)
+unique_stmt_ptr Parser::function(const std::string& kind, bool lazy)
 {
     auto identifier = consume(TokenType::IDENTIFIER, "Expect " + kind + " name.");
     void_cast(consume(TokenType::LEFT_PAREN, "Expect '(' after " + kind + " name."));
-    std::vector<Token> params;
+    ast_vector<Token> params{arena->memoryResource()};
     if (!check(TokenType::RIGHT_PAREN))
     {
         do
@@ -220,16 +239,54 @@ unique_stmt_ptr Parser::function(const std::string& kind)
     }
 
     void_cast(consume(TokenType::RIGHT_PAREN, "Expect ')' after parameters."));
-    void_cast(consume(TokenType::LEFT_BRACE, "Expect '{' before " + kind + " body."));
+    if (lazy)
+    {
+        return arena->create<FnStmt>(std::move(identifier), std::move(params), skipBody(kind));
+    }
 
+    void_cast(consume(TokenType::LEFT_BRACE, "Expect '{' before " + kind + " body."));
     auto body = block();
 
-    return std::make_unique<FnStmt>(std::move(identifier), std::move(params), std::move(body));
+    return arena->create<FnStmt>(std::move(identifier), std::move(params), std::move(body));
+}
+
+LazyBody Parser::skipBody(const std::string& kind)
+{
+    // The lexer errors of the body are reported when it is lexed again on the first call, so the
+    // ones found while skipping it are dropped, unless it is never closed. Lexing starts with the
+    // token after the opening brace, pulled by consuming it.
+    const size_t error_count = Error::exceptionList.size();
+    const bool had_error = Error::hadError;
+    void_cast(consume(TokenType::LEFT_BRACE, "Expect '{' before " + kind + " body."));
+
+    // The body starts after the opening brace and ends at the matching closing one.
+    const unsigned int begin = previous().offset + 1u;
+    const unsigned int line = previous().line;
+    size_t depth = 1u;
+    while (!isAtEnd() && !(check(TokenType::RIGHT_BRACE) && depth == 1u))
+    {
+        depth += check(TokenType::LEFT_BRACE);
+        depth -= check(TokenType::RIGHT_BRACE);
+        advance();
+    }
+
+    if (check(TokenType::RIGHT_BRACE))
+    {
+        while (Error::exceptionList.size() > error_count)
+        {
+            Error::exceptionList.pop_back();
+        }
+        Error::hadError = had_error;
+    }
+
+    const unsigned int end = peek().offset;
+    void_cast(consume(TokenType::RIGHT_BRACE, "Expect '}' after block."));
+    return {lexer->getSource(), begin, end, line, arena.get()};
 }
 
-std::vector<unique_stmt_ptr> Parser::block()
+ast_vector<unique_stmt_ptr> Parser::block()
 {
-    std::vector<unique_stmt_ptr> statements;
+    ast_vector<unique_stmt_ptr> statements{arena->memoryResource()};
     while (!check(TokenType::RIGHT_BRACE) && !isAtEnd())
     {
         statements.emplace_back(declaration());
@@ -249,18 +306,16 @@ unique_expr_ptr Parser::assignment()
         auto value = assignment();
 
         // Check if the left-hand side of the assign expression is a regular identifier.
-        if (dynamic_cast<VarExpr*>(expr.get()))
+        if (auto var_ptr = dynamic_cast<VarExpr*>(expr.get()))
         {
-            return std::make_unique<AssignExpr>(
-                std::move(dynamic_cast<VarExpr*>(expr.release())->identifier), std::move(value));
+            return arena->create<AssignExpr>(std::move(var_ptr->identifier), std::move(value));
         }
 
         // Check if the left-hand side expression is a subscript expression.
-        if (auto subscript_ptr = dynamic_cast<SubscriptExpr*>(expr.release()))
+        if (auto subscript_ptr = dynamic_cast<SubscriptExpr*>(expr.get()))
         {
-            return std::make_unique<SubscriptExpr>(std::move(subscript_ptr->identifier),
-                                                   std::move(subscript_ptr->index),
-                                                   std::move(value));
+            return arena->create<SubscriptExpr>(std::move(subscript_ptr->identifier),
+                                                std::move(subscript_ptr->index), std::move(value));
         }
 
         // Otherwise throw error.
@@ -286,7 +341,7 @@ unique_expr_ptr Parser::orExpression()
     {
         auto op = previous();
         auto right = andExpression();
-        expr = std::make_unique<LogicalExpr>(std::move(expr), std::move(op), std::move(right));
+        expr = arena->create<LogicalExpr>(std::move(expr), std::move(op), std::move(right));
     }
 
     return expr;
@@ -300,7 +355,7 @@ unique_expr_ptr Parser::andExpression()
     {
         auto op = previous();
         auto right = andExpression();
-        expr = std::make_unique<LogicalExpr>(std::move(expr), std::move(op), std::move(right));
+        expr = arena->create<LogicalExpr>(std::move(expr), std::move(op), std::move(right));
     }
 
     return expr;
@@ -320,7 +375,7 @@ unique_expr_ptr Parser::binary(Fn func, const std::initializer_list<TokenType>&
     {
         auto op = previous();
         auto right = func();
-        expr = std::make_unique<BinaryExpr>(std::move(expr), std::move(op), std::move(right));
+        expr = arena->create<BinaryExpr>(std::move(expr), std::move(op), std::move(right));
     }
 
     return expr;
@@ -355,7 +410,7 @@ unique_expr_ptr Parser::unary()
         auto op = previous();
         auto right = unary();
 
-        return std::make_unique<UnaryExpr>(std::move(op), std::move(right));
+        return arena->create<UnaryExpr>(std::move(op), std::move(right));
     }
 
     return prefix();
@@ -376,11 +431,11 @@ unique_expr_ptr Parser::prefix()
 
         if (op.type == TokenType::PLUS_PLUS)
         {
-            return std::make_unique<IncrementExpr>(std::move(lvalue), IncrementExpr::Type::PREFIX);
+            return arena->create<IncrementExpr>(std::move(lvalue), IncrementExpr::Type::PREFIX);
         }
         else
         {
-            return std::make_unique<DecrementExpr>(std::move(lvalue), DecrementExpr::Type::PREFIX);
+            return arena->create<DecrementExpr>(std::move(lvalue), DecrementExpr::Type::PREFIX);
         }
     }
 
@@ -406,15 +461,16 @@ unique_expr_ptr Parser::postfix()
             throw error(op, "Operators '++' and '--' cannot be concatenated.");
         }
 
+        auto identifier = std::move(static_cast<VarExpr&>(*expr).identifier);
         if (op.type == TokenType::PLUS_PLUS)
         {
-            expr = std::make_unique<IncrementExpr>(
-                dynamic_cast<VarExpr*>(expr.release())->identifier, IncrementExpr::Type::POSTFIX);
+            expr = arena->create<IncrementExpr>(std::move(identifier),
+                                                IncrementExpr::Type::POSTFIX);
         }
         else
         {
-            expr = std::make_unique<DecrementExpr>(
-                dynamic_cast<VarExpr*>(expr.release())->identifier, DecrementExpr::Type::POSTFIX);
+            expr = arena->create<DecrementExpr>(std::move(identifier),
+                                                DecrementExpr::Type::POSTFIX);
         }
     }
 
@@ -423,7 +479,7 @@ unique_expr_ptr Parser::postfix()
 
 unique_expr_ptr Parser::finishCall(unique_expr_ptr callee)
 {
-    std::vector<unique_expr_ptr> arguments;
+    ast_vector<unique_expr_ptr> arguments{arena->memoryResource()};
     if (!check(TokenType::RIGHT_PAREN))
     {
         do
@@ -439,7 +495,7 @@ unique_expr_ptr Parser::finishCall(unique_expr_ptr callee)
 
     auto paren = consume(TokenType::RIGHT_PAREN, "Except ')' after arguments.");
 
-    return std::make_unique<CallExpr>(std::move(callee), std::move(paren), std::move(arguments));
+    return arena->create<CallExpr>(std::move(callee), std::move(paren), std::move(arguments));
 }
 
 unique_expr_ptr Parser::call()
@@ -472,9 +528,9 @@ unique_expr_ptr Parser::finishSubscript(unique_expr_ptr identifier)
         throw error(peek(), "Object is not subscriptable.");
     }
 
-    auto var = dynamic_cast<VarExpr*>(identifier.release())->identifier;
+    auto var = std::move(static_cast<VarExpr&>(*identifier).identifier);
 
-    return std::make_unique<SubscriptExpr>(std::move(var), std::move(index), nullptr);
+    return arena->create<SubscriptExpr>(std::move(var), std::move(index), nullptr);
 }
 
 unique_expr_ptr Parser::subscript()
@@ -496,9 +552,9 @@ unique_expr_ptr Parser::subscript()
     return expr;
 }
 
-std::vector<unique_expr_ptr> Parser::list()
+ast_vector<unique_expr_ptr> Parser::list()
 {
-    std::vector<unique_expr_ptr> items;
+    ast_vector<unique_expr_ptr> items{arena->memoryResource()};
     // Return an empty list if there are no values.
     if (check(TokenType::RIGHT_BRACKET))
     {
@@ -530,32 +586,36 @@ unique_expr_ptr Parser::primary()
 
     if (match({NUMBER}))
     {
-        return std::make_unique<LiteralExpr>(std::strtod(previous().lexeme.c_str(), nullptr));
+        const std::string_view lexeme = previous().lexeme;
+        double number = 0.0;
+        std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), number);
+        return arena->create<LiteralExpr>(number, previous().offset);
     }
 
     if (match({STRING}))
     {
-        return std::make_unique<LiteralExpr>(previous().lexeme);
+        return arena->create<LiteralExpr>(StringTable::intern(previous().lexeme),
+                                          previous().offset);
     }
 
     if (match({_FALSE}))
     {
-        return std::make_unique<LiteralExpr>(false);
+        return arena->create<LiteralExpr>(false, previous().offset);
     }
 
     if (match({_TRUE}))
     {
-        return std::make_unique<LiteralExpr>(true);
+        return arena->create<LiteralExpr>(true, previous().offset);
     }
 
     if (match({NIL}))
     {
-        return std::make_unique<LiteralExpr>(std::any{});
+        return arena->create<LiteralExpr>(Value{}, previous().offset);
     }
 
     if (match({IDENTIFIER}))
     {
-        return std::make_unique<VarExpr>(previous());
+        return arena->create<VarExpr>(previous());
     }
 
     if (match({LEFT_PAREN}))
@@ -563,7 +623,7 @@ unique_expr_ptr Parser::primary()
         auto expr = expression();
         void_cast(consume(RIGHT_PAREN, "Expect ')' after expression."));
 
-        return std::make_unique<GroupingExpr>(std::move(expr));
+        return arena->create<GroupingExpr>(std::move(expr));
     }
 
     if (match({LEFT_BRACKET}))
@@ -572,7 +632,7 @@ unique_expr_ptr Parser::primary()
         auto expr = list();
         void_cast(consume(TokenType::RIGHT_BRACKET, "Expect ']' at the end of a list."));
 
-        return std::make_unique<ListExpr>(std::move(opening_bracket), std::move(expr));
+        return arena->create<ListExpr>(std::move(opening_bracket), std::move(expr));
     }
 
     throw error(peek(), "Expect expression.");
@@ -624,10 +684,16 @@ void Parser::advance()
     // Advance to the next token.
     if (!isAtEnd())
     {
-        current++;
+        previous_token.emplace(*current_token);
+        current_token.emplace(pullToken());
     }
 }
 
+Token Parser::pullToken()
+{
+    return lexer ? lexer->nextToken() : tokens[next_token++];
+}
+
 bool Parser::isAtEnd() const
 {
     return peek().type == TokenType::_EOF;
@@ -635,12 +701,12 @@ bool Parser::isAtEnd() const
 
 const Token& Parser::peek() const
 {
-    return tokens[current];
+    return *current_token;
 }
 
-Token Parser::previous() const
+const Token& Parser::previous() const
 {
-    return tokens[current - 1];
+    return *previous_token;
 }
 
 Parser::ParseError Parser::error(const Token& token, std::string msg) const
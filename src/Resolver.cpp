@@ -1,12 +1,15 @@
 #include "../include/Resolver.hpp"
 #include "../include/Logger.hpp"
+#include "../include/StringTable.hpp"
+#include <algorithm>
+#include <utility>
 
-Resolver::Resolver(Interpreter& interpreter) : interpreter{interpreter}
+Resolver::Resolver()
 {
     func_stack.push(FuncType::NONE);
 }
 
-void Resolver::resolve(const std::vector<unique_stmt_ptr>& statements)
+void Resolver::resolve(const ast_vector<unique_stmt_ptr>& statements)
 {
     for (const auto& stmt : statements)
     {
@@ -15,6 +18,24 @@ void Resolver::resolve(const std::vector<unique_stmt_ptr>& statements)
     }
 }
 
+void Resolver::resolveBody(const FnStmt& function)
+{
+    resolveFunction(function, FuncType::FUNCTION);
+}
+
+void Resolver::resolve(const FlatAst& ast)
+{
+    ast.slots.assign(ast.size(), VariableSlot{});
+    ast.layouts.clear();
+    ast.functions.clear();
+    resolve(ast, ast.statements());
+}
+
+const Resolver::Statistics& Resolver::getStatistics() const
+{
+    return statistics;
+}
+
 void Resolver::resolve(const Stmt& stmt)
 {
     stmt.accept(*this);
@@ -25,122 +46,395 @@ void Resolver::resolve(const Expr& expr)
     expr.accept(*this);
 }
 
-void Resolver::resolveLocal(const Expr* expr, const Token& identifier)
+void Resolver::resolve(const FlatAst& ast, std::span<const FlatAst::Index> nodes)
+{
+    for (const FlatAst::Index node : nodes)
+    {
+        resolve(ast, node);
+    }
+}
+
+void Resolver::resolve(const FlatAst& ast, FlatAst::Index node)
+{
+    using enum FlatAst::Kind;
+
+    // Same order as the visits of the tree, so both get the same slots.
+    const FlatAst::Index lhs = ast.lhs(node);
+    const FlatAst::Index rhs = ast.rhs(node);
+    switch (ast.kind(node))
+    {
+    case ASSIGN:
+        resolve(ast, lhs);
+        ast.slots[node] = resolveLocal(ast.lexeme(node));
+        break;
+    case BINARY:
+    case LOGICAL:
+        resolve(ast, lhs);
+        resolve(ast, rhs);
+        break;
+    case UNARY:
+    case GROUPING:
+    case EXPRESSION:
+    case PRINT:
+        resolve(ast, lhs);
+        break;
+    case CALL:
+        resolve(ast, lhs);
+        resolve(ast, ast.list(rhs));
+        break;
+    case NUMBER:
+    case STRING:
+    case TRUE:
+    case FALSE:
+    case NIL:
+        break;
+    case VARIABLE:
+        if (isBeingInitialized(ast.lexeme(node)))
+        {
+            Error::addError(ast.token(node), "Can't read local variable in its own initializer.");
+        }
+        ast.slots[node] = resolveLocal(ast.lexeme(node));
+        break;
+    case LIST:
+        resolve(ast, ast.list(rhs));
+        break;
+    case SUBSCRIPT:
+        resolve(ast, lhs);
+        if (rhs != FlatAst::NONE)
+        {
+            resolve(ast, rhs);
+        }
+        ast.slots[node] = resolveLocal(ast.lexeme(node));
+        break;
+    case PREFIX_INCREMENT:
+    case POSTFIX_INCREMENT:
+    case PREFIX_DECREMENT:
+    case POSTFIX_DECREMENT:
+        ast.slots[node] = resolveLocal(ast.lexeme(node));
+        break;
+    case BLOCK:
+    {
+        auto& layout = ast.layouts.emplace_back(node, ScopeLayout{}).second;
+        beginScope();
+        resolve(ast, ast.list(lhs));
+        layout = endScope();
+        break;
+    }
+    case FUNCTION:
+        declare(ast, ast.offset(node), ast.slots[node]);
+        define(ast.lexeme(node));
+        resolveFunction(ast, node, FuncType::FUNCTION);
+        break;
+    case IF:
+        // The conditions and statements of the branches, then the else branch.
+        resolve(ast, ast.list(lhs));
+        if (rhs != FlatAst::NONE)
+        {
+            resolve(ast, rhs);
+        }
+        break;
+    case RETURN:
+        if (func_stack.top() == FuncType::NONE)
+        {
+            Error::addError(ast.token(node), "Can't return from a top-level code.");
+        }
+        if (lhs != FlatAst::NONE)
+        {
+            resolve(ast, lhs);
+        }
+        break;
+    case BREAK:
+        if (loop_nesting_level == 0)
+        {
+            Error::addError(ast.token(node), "Can't break outside of a loop.");
+        }
+        break;
+    case CONTINUE:
+        if (loop_nesting_level == 0)
+        {
+            Error::addError(ast.token(node), "Can't continue outside of a loop.");
+        }
+        break;
+    case VAR:
+        declare(ast, ast.offset(node), ast.slots[node]);
+        if (lhs != FlatAst::NONE)
+        {
+            resolve(ast, lhs);
+        }
+        define(ast.lexeme(node));
+        break;
+    case WHILE:
+        ++loop_nesting_level;
+        resolve(ast, lhs);
+        resolve(ast, rhs);
+        --loop_nesting_level;
+        break;
+    case FOR:
+    {
+        auto& layout = ast.layouts.emplace_back(node, ScopeLayout{}).second;
+        ++loop_nesting_level;
+        beginScope();
+        // The initializer, condition and increment, if present.
+        for (const FlatAst::Index clause : ast.items(lhs, 3u))
+        {
+            if (clause != FlatAst::NONE)
+            {
+                resolve(ast, clause);
+            }
+        }
+        resolve(ast, rhs);
+        layout = endScope();
+        --loop_nesting_level;
+        break;
+    }
+    }
+}
+
+VariableSlot Resolver::resolveLocal(std::string_view name)
 {
-    if (scopes.empty())
-        return;
     // Look for a variable starting from the innermost scope.
     for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope)
     {
-        // If variable is found, then we resolve it.
-        if (scope->contains(identifier.lexeme))
+        // If variable is found, then we resolve it by returning its location.
+        if (auto variable = scope->variables.find(name); variable != scope->variables.end())
         {
-            interpreter.resolve(*expr, std::distance(scopes.rbegin(), scope));
-            return;
+            if (scope->function_depth == functions.size())
+            {
+                return {VariableSlot::Storage::FRAME, variable->second.frame_slot};
+            }
+
+            // A variable used by a function nested in the one declaring it is reached through an
+            // upvalue, which keeps the variable alive after its frame is gone.
+            variable->second.is_captured = true;
+            scope->is_captured = true;
+            return {VariableSlot::Storage::UPVALUE,
+                    resolveUpvalue(functions.size(), scope->function_depth,
+                                   variable->second.frame_slot)};
         }
     }
     // ... If never found, we can assume that the variable is global.
+    return {VariableSlot::Storage::GLOBAL, 0u, StringTable::intern(name)};
 }
 
-void Resolver::resolveFunction(const FnStmt& stmt, FuncType type)
+size_t Resolver::resolveUpvalue(size_t function_depth, size_t declaring_depth, size_t frame_slot)
 {
-    // Push the current function type onto the function stack.
-    func_stack.push(type);
+    // The function directly inside the declaring one captures the variable from the call frame,
+    // functions nested deeper capture the upvalue of the function around them.
+    const bool is_local = function_depth - 1u == declaring_depth;
+    const size_t index =
+        is_local ? frame_slot : resolveUpvalue(function_depth - 1u, declaring_depth, frame_slot);
 
-    // Start a new scope for the function.
-    beginScope();
+    // Every captured variable is an upvalue of the function only once.
+    auto& upvalues = *functions[function_depth - 1u].upvalues;
+    const UpvalueSlot upvalue{is_local, index};
+    if (auto existing = std::find(upvalues.begin(), upvalues.end(), upvalue);
+        existing != upvalues.end())
+    {
+        return std::distance(upvalues.begin(), existing);
+    }
+
+    upvalues.push_back(upvalue);
+    return upvalues.size() - 1u;
+}
+
+void Resolver::resolveFunction(const FnStmt& stmt, FuncType type)
+{
+    beginFunction(type, stmt.upvalues, stmt.creates_closures);
 
-    // Bind each param as variable in the function scope.
+    // Bind each param as variable in the function scope, the arguments of a call are placed in
+    // the first slots.
     for (const auto& param : stmt.params)
     {
-        declare(param);
-        define(param);
+        VariableSlot slot;
+        declare(param, slot);
+        define(param.lexeme);
     }
 
     // Resolve the statements inside the function body.
     resolve(stmt.body);
 
-    // End the current scope.
-    endScope();
+    stmt.layout = endFunction();
+}
+
+void Resolver::resolveFunction(const FlatAst& ast, FlatAst::Index node, FuncType type)
+{
+    auto& layout = ast.layouts.emplace_back(node, ScopeLayout{}).second;
+    auto& function = ast.functions.emplace_back(node, FlatAst::FunctionInfo{}).second;
+    beginFunction(type, function.upvalues, function.creates_closures);
+
+    for (const uint32_t param : ast.list(ast.lhs(node)))
+    {
+        VariableSlot slot;
+        declare(ast, param, slot);
+        define(ast.lexemeAt(param));
+    }
+
+    resolve(ast, ast.list(ast.rhs(node)));
+
+    layout = endFunction();
+}
+
+void Resolver::beginFunction(FuncType type, ast_vector<UpvalueSlot>& upvalues,
+                             bool& creates_closures)
+{
+    // Push the current function type onto the function stack.
+    func_stack.push(type);
+
+    // A function declared inside another one is created anew by every call of the enclosing one.
+    if (!functions.empty())
+    {
+        *functions.back().creates_closures = true;
+    }
+
+    // Loops around the declaration don't enclose the body, break and continue can't leave the
+    // function. The function's locals are laid out in a call frame of its own.
+    functions.push_back({&upvalues, &creates_closures, std::exchange(loop_nesting_level, 0u),
+                         std::exchange(frame, FrameLayout{})});
+    upvalues.clear();
+    creates_closures = false;
+
+    // Start a new scope for the function.
+    beginScope();
+}
+
+ScopeLayout Resolver::endFunction()
+{
+    // End the current scope. The function's scope holds both the parameters and the locals of the
+    // body.
+    const ScopeLayout layout = endScope();
 
     // Pop the current function type from the function stack.
+    const Function function = functions.back();
     func_stack.pop();
+    functions.pop_back();
+    loop_nesting_level = function.enclosing_loop_nesting_level;
+    frame = function.enclosing_frame;
+
+    ++statistics.functions;
+    statistics.closure_free_functions += !*function.creates_closures;
+    return layout;
 }
 
 void Resolver::beginScope()
 {
-    scopes.emplace_back();
+    scopes.push_back({{}, functions.size(), frame.next_slot});
 }
 
-void Resolver::endScope()
+ScopeLayout Resolver::endScope()
 {
+    const Scope& scope = scopes.back();
+    const ScopeLayout layout{scope.is_captured, scope.first_slot, frame.size};
+
+    ++statistics.scopes;
+    statistics.captured_scopes += scope.is_captured;
+    statistics.locals += scope.variables.size();
+    for (const auto& [name, variable] : scope.variables)
+    {
+        statistics.captured_locals += variable.is_captured;
+    }
+
+    // The frame slots of the scope are free for the code that follows it.
+    frame.next_slot = scope.first_slot;
     scopes.pop_back();
+    return layout;
 }
 
-void Resolver::declare(const Token& identifier)
+bool Resolver::declare(std::string_view name, VariableSlot& slot)
 {
     if (scopes.empty())
-        return;
+    {
+        slot = {VariableSlot::Storage::GLOBAL, 0u, StringTable::intern(name)};
+        return true;
+    }
+
+    // Variables are given consecutive slots in the call frame in the order they are declared. The
+    // same variable can't be declared more than once in a scope.
+    const auto [variable, inserted] =
+        scopes.back().variables.try_emplace(name, Variable{false, false, frame.next_slot});
+    if (inserted)
+    {
+        frame.size = std::max(frame.size, ++frame.next_slot);
+    }
 
-    // Get the innermost scope.
-    Scope& scope = scopes.back();
+    slot = {VariableSlot::Storage::FRAME, variable->second.frame_slot};
+    return inserted;
+}
 
-    // Don't allow the same variable declaration more than once.
-    if (scope.contains(identifier.lexeme))
+void Resolver::declare(const Token& identifier, VariableSlot& slot)
+{
+    if (!declare(identifier.lexeme, slot))
     {
-        Error::addError(identifier, "Variable with the name '" + identifier.lexeme +
+        Error::addError(identifier, "Variable with the name '" +
+                                        std::string{identifier.lexeme} +
                                         "' already exists in this scope");
     }
+}
 
-    // The value associated with a key in the scope map represents whether we have completed
-    // resolving the initializer for that variable.
-    scope.try_emplace(identifier.lexeme, false);
+void Resolver::declare(const FlatAst& ast, uint32_t offset, VariableSlot& slot)
+{
+    // The token is only needed for the error message.
+    if (!declare(ast.lexemeAt(offset), slot))
+    {
+        declare(ast.tokenAt(offset), slot);
+    }
 }
 
-void Resolver::define(const Token& identifier)
+void Resolver::define(std::string_view name)
 {
     if (scopes.empty())
         return;
 
     // Indicates that the variable has been fully initialized by setting the value to true.
-    scopes.back()[identifier.lexeme] = true;
+    scopes.back().variables.find(name)->second.is_defined = true;
 }
 
-std::any Resolver::visit(const BinaryExpr& expr)
+bool Resolver::isBeingInitialized(std::string_view name) const
+{
+    if (scopes.empty())
+        return false;
+
+    // If the variable exists in the innermost scope and its value is false, then it has been
+    // declared but not yet defined.
+    const auto& variables = scopes.back().variables;
+    const auto variable = variables.find(name);
+    return variable != variables.end() && !variable->second.is_defined;
+}
+
+Value Resolver::visit(const BinaryExpr& expr)
 {
     resolve(*expr.left);
     resolve(*expr.right);
     return {};
 }
 
-std::any Resolver::visit(const UnaryExpr& expr)
+Value Resolver::visit(const UnaryExpr& expr)
 {
     resolve(*expr.right);
     return {};
 }
 
-std::any Resolver::visit(const GroupingExpr& expr)
+Value Resolver::visit(const GroupingExpr& expr)
 {
     resolve(*expr.expression);
     return {};
 }
 
-std::any Resolver::visit(const LiteralExpr& expr)
+Value Resolver::visit(const LiteralExpr& expr)
 {
     // No need to resolve literals.
     return {};
 }
 
-std::any Resolver::visit(const AssignExpr& expr)
+Value Resolver::visit(const AssignExpr& expr)
 {
     // Resolve the value assigned to the variable.
     resolve(*expr.value);
     // Resolve the variable being assigned to.
-    resolveLocal(&expr, expr.identifier);
+    expr.slot = resolveLocal(expr.identifier.lexeme);
     return {};
 }
 
-std::any Resolver::visit(const CallExpr& expr)
+Value Resolver::visit(const CallExpr& expr)
 {
     // Resolve the callee of the call expression, e.g. the function or class being called.
     resolve(*expr.callee);
@@ -154,54 +448,46 @@ std::any Resolver::visit(const CallExpr& expr)
     return {};
 }
 
-std::any Resolver::visit(const LogicalExpr& expr)
+Value Resolver::visit(const LogicalExpr& expr)
 {
     resolve(*expr.left);
     resolve(*expr.right);
     return {};
 }
 
-std::any Resolver::visit(const SetExpr& expr)
+Value Resolver::visit(const SetExpr& expr)
 {
     return {};
 }
 
-std::any Resolver::visit(const GetExpr& expr)
+Value Resolver::visit(const GetExpr& expr)
 {
     return {};
 }
 
-std::any Resolver::visit(const SuperExpr& expr)
+Value Resolver::visit(const SuperExpr& expr)
 {
     return {};
 }
 
-std::any Resolver::visit(const ThisExpr& expr)
+Value Resolver::visit(const ThisExpr& expr)
 {
     return {};
 }
 
-std::any Resolver::visit(const VarExpr& expr)
+Value Resolver::visit(const VarExpr& expr)
 {
     // Checks to see whether variable is being accessed inside its own initializer.
-    if (!scopes.empty())
+    if (isBeingInitialized(expr.identifier.lexeme))
     {
-        // Get the innermost scope.
-        const Scope& scope = scopes.back();
-
-        // If the variable exists and its value is false,
-        // then it has been declared but not yet defined.
-        if (scope.contains(expr.identifier.lexeme) && !scope.at(expr.identifier.lexeme))
-        {
-            Error::addError(expr.identifier, "Can't read local variable in its own initializer.");
-        }
+        Error::addError(expr.identifier, "Can't read local variable in its own initializer.");
     }
 
-    resolveLocal(&expr, expr.identifier);
+    expr.slot = resolveLocal(expr.identifier.lexeme);
     return {};
 }
 
-std::any Resolver::visit(const ListExpr& expr)
+Value Resolver::visit(const ListExpr& expr)
 {
     // Resolve each item in contained in the list.
     for (const auto& item : expr.items)
@@ -212,7 +498,7 @@ std::any Resolver::visit(const ListExpr& expr)
     return {};
 }
 
-std::any Resolver::visit(const SubscriptExpr& expr)
+Value Resolver::visit(const SubscriptExpr& expr)
 {
     // Resolve the index of the subscript.
     resolve(*expr.index);
@@ -224,21 +510,21 @@ std::any Resolver::visit(const SubscriptExpr& expr)
     }
 
     // Resolve the variable being accessed.
-    resolveLocal(&expr, expr.identifier);
+    expr.slot = resolveLocal(expr.identifier.lexeme);
     return {};
 }
 
-std::any Resolver::visit(const IncrementExpr& expr)
+Value Resolver::visit(const IncrementExpr& expr)
 {
     // Resolve the variable being incremented.
-    resolveLocal(&expr, expr.identifier);
+    expr.slot = resolveLocal(expr.identifier.lexeme);
     return {};
 }
 
-std::any Resolver::visit(const DecrementExpr& expr)
+Value Resolver::visit(const DecrementExpr& expr)
 {
     // Resolve the variable being decremented.
-    resolveLocal(&expr, expr.identifier);
+    expr.slot = resolveLocal(expr.identifier.lexeme);
     return {};
 }
 
@@ -250,8 +536,9 @@ void Resolver::visit(const BlockStmt& stmt)
     // Resolve all statements within the block statement.
     resolve(stmt.statements);
 
-    // End the scope, discarding any variables defined within the block statement.
-    endScope();
+    // End the scope, discarding any variables defined within the block statement, and record
+    // where they are stored.
+    stmt.layout = endScope();
 }
 
 void Resolver::visit(const ClassStmt& stmt)
@@ -266,8 +553,8 @@ void Resolver::visit(const ExprStmt& stmt)
 
 void Resolver::visit(const FnStmt& stmt)
 {
-    declare(stmt.identifier);
-    define(stmt.identifier);
+    declare(stmt.identifier, stmt.slot);
+    define(stmt.identifier.lexeme);
     resolveFunction(stmt, FuncType::FUNCTION);
 }
 
@@ -330,13 +617,13 @@ void Resolver::visit(const ContinueStmt& stmt)
 
 void Resolver::visit(const VarStmt& stmt)
 {
-    declare(stmt.identifier);
+    declare(stmt.identifier, stmt.slot);
     if (stmt.initializer)
     {
         resolve(*stmt.initializer);
     }
 
-    define(stmt.identifier);
+    define(stmt.identifier.lexeme);
 }
 
 void Resolver::visit(const WhileStmt& stmt)
@@ -365,7 +652,8 @@ void Resolver::visit(const ForStmt& stmt)
     // Resolve the body statement
     resolve(*stmt.body);
 
-    // End the current scope, discarding any variables declared inside the for loop.
-    endScope();
+    // End the current scope, discarding any variables declared inside the for loop, and record
+    // where they are stored.
+    stmt.layout = endScope();
     --loop_nesting_level;
 }
\ No newline at end of file
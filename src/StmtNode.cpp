@@ -2,7 +2,7 @@
 #include <cassert>
 #include <utility>
 
-BlockStmt::BlockStmt(std::vector<unique_stmt_ptr> statements) : statements{std::move(statements)}
+BlockStmt::BlockStmt(ast_vector<unique_stmt_ptr> statements) : statements{std::move(statements)}
 {
 }
 
@@ -11,8 +11,8 @@ void BlockStmt::accept(StmtVisitor& visitor) const
     visitor.visit(*this);
 }
 
-ClassStmt::ClassStmt(Token identifier, std::vector<std::unique_ptr<FnStmt>> methods,
-                     std::unique_ptr<VarExpr> superclass)
+ClassStmt::ClassStmt(Token identifier, ast_vector<ast_ptr<FnStmt>> methods,
+                     ast_ptr<VarExpr> superclass)
     : identifier{std::move(identifier)}, superclass{std::move(superclass)}, methods{
                                                                                 std::move(methods)}
 {
@@ -34,8 +34,16 @@ void ExprStmt::accept(StmtVisitor& visitor) const
     visitor.visit(*this);
 }
 
-FnStmt::FnStmt(Token identifier, std::vector<Token> params, std::vector<unique_stmt_ptr> body)
-    : identifier{std::move(identifier)}, params{std::move(params)}, body{std::move(body)}
+FnStmt::FnStmt(Token identifier, ast_vector<Token> params, ast_vector<unique_stmt_ptr> body)
+    : identifier{std::move(identifier)}, params{std::move(params)}, body{std::move(body)},
+      upvalues{this->params.get_allocator()}
+{
+    assert(this->identifier.type == TokenType::IDENTIFIER);
+}
+
+FnStmt::FnStmt(Token identifier, ast_vector<Token> params, LazyBody lazy_body)
+    : identifier{std::move(identifier)}, params{std::move(params)}, lazy_body{lazy_body},
+      body{this->params.get_allocator()}, upvalues{this->params.get_allocator()}
 {
     assert(this->identifier.type == TokenType::IDENTIFIER);
 }
@@ -52,7 +60,7 @@ IfBranch::IfBranch(unique_expr_ptr condition, unique_stmt_ptr statement)
     assert(this->statement != nullptr);
 }
 
-IfStmt::IfStmt(IfBranch main_branch, std::vector<IfBranch> elif_branches,
+IfStmt::IfStmt(IfBranch main_branch, ast_vector<IfBranch> elif_branches,
                unique_stmt_ptr else_branch)
     : main_branch{std::move(main_branch)},     //
       elif_branches{std::move(elif_branches)}, //
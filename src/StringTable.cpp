@@ -0,0 +1,32 @@
+#include "../include/StringTable.hpp"
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    std::mutex mutex;
+    // Keyed by views of the strings' own contents, which never move.
+    std::unordered_map<std::string_view, std::unique_ptr<String>> strings;
+}
+
+String* StringTable::intern(std::string_view string)
+{
+    const std::lock_guard lock{mutex};
+    if (auto interned = strings.find(string); interned != strings.end())
+    {
+        return interned->second.get();
+    }
+
+    auto interned = std::make_unique<String>(std::string{string});
+    interned->is_interned = true;
+    String* created = interned.get();
+    strings.emplace(created->getValue(), std::move(interned));
+    return created;
+}
+
+size_t StringTable::size()
+{
+    const std::lock_guard lock{mutex};
+    return strings.size();
+}
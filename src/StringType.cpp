@@ -0,0 +1,125 @@
+#include "../include/StringType.hpp"
+#include "../include/Heap.hpp"
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+String::String(std::string value) : Object{ObjectType::STRING}, value{std::move(value)},
+                                    size{this->value.size()}
+{
+}
+
+String::String(String* left, String* right) : String{left, std::string{}, right}
+{
+}
+
+String::String(String* left, std::string right) : String{left, std::move(right), nullptr}
+{
+}
+
+String::String(std::string left, String* right) : String{nullptr, std::move(left), right}
+{
+}
+
+String::String(String* left, std::string text, String* right)
+    : Object{ObjectType::STRING}, value{std::move(text)}, left{left}, right{right},
+      size{(left ? left->size : 0u) + value.size() + (right ? right->size : 0u)}
+{
+    // Operands of a short concatenation are short as well, so they are flat.
+    if (size < MIN_ROPE_LENGTH)
+    {
+        std::string flat;
+        flat.reserve(size);
+        if (left)
+        {
+            flat += left->value;
+        }
+        flat += value;
+        if (right)
+        {
+            flat += right->value;
+        }
+        value = std::move(flat);
+        this->left = nullptr;
+        this->right = nullptr;
+    }
+}
+
+const std::string& String::getValue() const
+{
+    if (isRope())
+    {
+        flatten();
+    }
+    return value;
+}
+
+size_t String::getHash() const
+{
+    if (!is_hashed)
+    {
+        hash = std::hash<std::string_view>{}(getValue());
+        is_hashed = true;
+    }
+    return hash;
+}
+
+void String::flatten() const
+{
+    // Ropes built by appending in a loop are as deep as the number of appends, so they are walked
+    // with an explicit stack. A rope is visited twice: first to push its operands, then to append
+    // its own text once its left operand has been appended.
+    struct Pending
+    {
+        const String* string;
+        bool is_expanded;
+    };
+
+    std::string flat;
+    flat.reserve(size);
+    std::vector<Pending> pending{{this, false}};
+    while (!pending.empty())
+    {
+        const auto [string, is_expanded] = pending.back();
+        pending.pop_back();
+        if (is_expanded || !string->isRope())
+        {
+            flat += string->value;
+            continue;
+        }
+
+        if (string->right)
+        {
+            pending.push_back({string->right, false});
+        }
+        pending.push_back({string, true});
+        if (string->left)
+        {
+            pending.push_back({string->left, false});
+        }
+    }
+
+    // The operands aren't needed anymore, the garbage collector can free them unless they are
+    // used elsewhere.
+    value = std::move(flat);
+    left = nullptr;
+    right = nullptr;
+}
+
+void String::trace(Heap& heap) const
+{
+    if (left)
+    {
+        heap.mark(left);
+    }
+    if (right)
+    {
+        heap.mark(right);
+    }
+}
+
+size_t String::ownedBytes() const noexcept
+{
+    return value.capacity();
+}
@@ -3,17 +3,8 @@
 #include <iostream>
 #include <map>
 
-Token::Token(TokenType type, std::string lexeme, unsigned int line)
-    : type{type}, lexeme{std::move(lexeme)}, line{line}
-{
-}
-
-Token::Token(Token&& token) noexcept
-    : type{token.type}, lexeme{std::move(token.lexeme)}, line{token.line}
-{
-}
-
-Token::Token(const Token& token) : type{token.type}, lexeme{token.lexeme}, line{token.line}
+Token::Token(TokenType type, std::string_view lexeme, unsigned int line, unsigned int offset)
+    : type{type}, lexeme{lexeme}, line{line}, offset{offset}
 {
 }
 
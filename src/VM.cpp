@@ -0,0 +1,562 @@
+#include "../include/VM.hpp"
+#include "../include/BuiltIn.hpp"
+#include "../include/ListType.hpp"
+#include "../include/Logger.hpp"
+#include "../include/StringType.hpp"
+#include <utility>
+
+VM::VM()
+    : stack_top{stack.data()}, frames(1u), heap{[this](Heap& heap) { markRoots(heap); }}
+{
+}
+
+void VM::interpret(const CompiledProgram& program)
+{
+    // Globals are numbered by the Compiler, the natives are defined in the slots of their names.
+    global_names = &program.globals;
+    globals.assign(program.globals.size(), Global{});
+    defineNative("clock", heap.allocate<NativeFunction>("<native fn>", 0u, false, clockNative));
+    defineNative("print", heap.allocate<NativeFunction>("native print", 0u, true, printNative));
+
+    // The top-level code runs as a call to the script function.
+    reserveStack(program.script.as<CompiledFunction>()->max_stack_height);
+    push(heap.allocate<Closure>(program.script.as<CompiledFunction>()));
+    frames[0] = CallFrame{stack_top[-1].as<Closure>(),
+                          stack_top[-1].as<Closure>()->getFunction()->chunk.code.data(),
+                          stack.data()};
+    frame_count = 1u;
+
+    try
+    {
+        run();
+    }
+    catch (const RuntimeError& error)
+    {
+        Error::addRuntimeError(error);
+    }
+
+    resetStack();
+}
+
+void VM::push(Value value) noexcept
+{
+    *stack_top++ = std::move(value);
+}
+
+Value VM::pop() noexcept
+{
+    return std::move(*--stack_top);
+}
+
+void VM::resetStack() noexcept
+{
+    // The objects only referenced from the stack are freed by the next collection.
+    open_upvalues.clear();
+    stack_top = stack.data();
+    frame_count = 0u;
+}
+
+void VM::reserveStack(size_t size)
+{
+    const Value* previous_data = open_upvalues.reserve(stack, size);
+    if (previous_data != stack.data())
+    {
+        // The frames follow their values to the new buffer.
+        const auto relocate = [&](const Value* value)
+        { return stack.data() + (value - previous_data); };
+        stack_top = relocate(stack_top);
+        for (size_t i = 0u; i < frame_count; ++i)
+        {
+            frames[i].slots = relocate(frames[i].slots);
+        }
+    }
+}
+
+const Heap::Statistics& VM::getHeapStatistics() const
+{
+    return heap.getStatistics();
+}
+
+void VM::markRoots(Heap& heap) const
+{
+    // The closures of the call frames are on the stack as well.
+    for (const Value* slot = stack.data(); slot != stack_top; ++slot)
+    {
+        heap.mark(*slot);
+    }
+    for (const auto& global : globals)
+    {
+        heap.mark(global.value);
+    }
+    open_upvalues.mark(heap);
+}
+
+void VM::defineNative(const std::string& name, Value native)
+{
+    // Natives the program never refers to have no global slot.
+    for (size_t i = 0u; i < global_names->size(); ++i)
+    {
+        if ((*global_names)[i] == name)
+        {
+            globals[i].value = std::move(native);
+            globals[i].is_defined = true;
+            return;
+        }
+    }
+}
+
+void VM::callValue(size_t arg_count)
+{
+    // The callee sits right below its arguments.
+    Value* callee = stack_top - arg_count - 1u;
+
+    if (callee->isObjectOf(ObjectType::CLOSURE))
+    {
+        auto closure = callee->as<Closure>();
+        auto function = closure->getFunction();
+        if (arg_count != function->arity)
+        {
+            throw error("Expected " + std::to_string(function->arity) + " arguments but got " +
+                        std::to_string(arg_count) + " .");
+        }
+        if (frame_count == FRAMES_MAX)
+        {
+            throw error("Stack overflow.");
+        }
+
+        // Make room for the callee's frame, which starts at the callee.
+        const size_t first_slot = callee - stack.data();
+        reserveStack(first_slot + function->max_stack_height);
+        if (frame_count == frames.size())
+        {
+            frames.resize(frame_count * 2u);
+        }
+        frames[frame_count++] =
+            CallFrame{closure, function->chunk.code.data(), stack.data() + first_slot};
+        return;
+    }
+
+    if (callee->isObjectOf(ObjectType::NATIVE))
+    {
+        auto native = callee->as<NativeFunction>();
+        if (!native->is_variadic && arg_count != native->arity)
+        {
+            throw error("Expected " + std::to_string(native->arity) + " arguments but got " +
+                        std::to_string(arg_count) + " .");
+        }
+
+        Value result = native->function(std::span<const Value>{callee + 1, arg_count});
+        while (stack_top != callee)
+        {
+            pop();
+        }
+        push(std::move(result));
+        return;
+    }
+
+    throw error(") is not callable. Callable object must be a function or a class.");
+}
+
+RuntimeError VM::error(const std::string& message) const
+{
+    // Report the line of the instruction being executed.
+    const auto& frame = frames[frame_count - 1u];
+    const auto& chunk = frame.closure->getFunction()->chunk;
+    const size_t offset = frame.ip - chunk.code.data() - 1u;
+    return RuntimeError{Token{TokenType::_EOF, "", chunk.lines[offset]}, message};
+}
+
+void VM::run()
+{
+    // Cache the state of the innermost call frame in locals. The instruction pointer is written
+    // back to the frame before anything that needs it, calls and errors.
+    CallFrame* frame = &frames[frame_count - 1u];
+    const uint8_t* ip = frame->ip;
+    Value* slots = frame->slots;
+    const Value* constants = frame->closure->getFunction()->chunk.constants.data();
+
+#define READ_BYTE() (*ip++)
+#define READ_SHORT() (ip += 2, static_cast<uint16_t>((ip[-2] << 8u) | ip[-1]))
+#define READ_CONSTANT() (constants[READ_SHORT()])
+#define READ_NAME() (READ_CONSTANT().as<String>()->getValue())
+#define LOAD_FRAME()                                                                               \
+    frame = &frames[frame_count - 1u];                                                             \
+    ip = frame->ip;                                                                                \
+    slots = frame->slots;                                                                          \
+    constants = frame->closure->getFunction()->chunk.constants.data()
+#define RUNTIME_ERROR(message)                                                                     \
+    frame->ip = ip;                                                                                \
+    throw error(message)
+#define NUMBER_OPERANDS()                                                                          \
+    if (!stack_top[-1].isNumber() || !stack_top[-2].isNumber())                                    \
+    {                                                                                              \
+        RUNTIME_ERROR("Operands must be numbers.");                                                \
+    }
+#define BINARY_OP(op)                                                                              \
+    {                                                                                              \
+        NUMBER_OPERANDS();                                                                         \
+        const double rhs = pop().asNumber();                                                       \
+        stack_top[-1] = stack_top[-1].asNumber() op rhs;                                           \
+        NEXT();                                                                                    \
+    }
+
+    // Instructions are dispatched either by jumping straight to the address of the next handler
+    // (direct threading), or through a switch when the compiler has no computed goto support.
+    // Direct threading gives every handler its own indirect jump, which the branch predictor can
+    // learn separately instead of sharing the single jump of the switch.
+#ifdef JLOX_COMPUTED_GOTO
+    // Handler addresses, in the order of the OpCode enum.
+    static const void* const dispatch_table[] = {
+        &&op_CONSTANT,      &&op_CONSTANT_LONG, &&op_NIL,           &&op__TRUE,
+        &&op__FALSE,        &&op_POP,           &&op_GET_LOCAL,     &&op_SET_LOCAL,
+        &&op_GET_GLOBAL,    &&op_DEFINE_GLOBAL, &&op_SET_GLOBAL,    &&op_GET_UPVALUE,
+        &&op_SET_UPVALUE,   &&op_GET_SUBSCRIPT, &&op_SET_SUBSCRIPT, &&op_EQUAL,
+        &&op_GREATER,       &&op_GREATER_EQUAL, &&op_LESS,          &&op_LESS_EQUAL,
+        &&op_ADD,           &&op_SUBTRACT,      &&op_MULTIPLY,      &&op_DIVIDE,
+        &&op_NOT,           &&op_NEGATE,        &&op_INCREMENT,     &&op_DECREMENT,
+        &&op_LIST,          &&op_JUMP,          &&op_JUMP_IF_FALSE, &&op_LOOP,
+        &&op_CALL,          &&op_CLOSURE,       &&op_CLOSE_UPVALUE, &&op_RETURN};
+    static_assert(std::size(dispatch_table) == static_cast<size_t>(OpCode::RETURN) + 1u,
+                  "Every opcode needs a handler in the dispatch table.");
+
+#define DISPATCH() goto* dispatch_table[READ_BYTE()];
+#define CASE(op) op_##op
+#define NEXT() goto* dispatch_table[READ_BYTE()]
+#else
+#define DISPATCH() switch (static_cast<OpCode>(READ_BYTE()))
+#define CASE(op) case OpCode::op
+#define NEXT() break
+#endif
+
+    while (true)
+    {
+        DISPATCH()
+        {
+        CASE(CONSTANT):
+            push(READ_CONSTANT());
+            NEXT();
+
+        CASE(CONSTANT_LONG):
+        {
+            const size_t high = READ_BYTE();
+            push(constants[high << 16u | READ_SHORT()]);
+            NEXT();
+        }
+
+        CASE(NIL):
+            push(Value{});
+            NEXT();
+
+        CASE(_TRUE):
+            push(true);
+            NEXT();
+
+        CASE(_FALSE):
+            push(false);
+            NEXT();
+
+        CASE(POP):
+            pop();
+            NEXT();
+
+        CASE(GET_LOCAL):
+            push(slots[READ_BYTE()]);
+            NEXT();
+
+        CASE(SET_LOCAL):
+            slots[READ_BYTE()] = stack_top[-1];
+            NEXT();
+
+        CASE(GET_GLOBAL):
+        {
+            const uint16_t index = READ_SHORT();
+            if (!globals[index].is_defined)
+            {
+                RUNTIME_ERROR("Undefined variable '" + (*global_names)[index] + "'.");
+            }
+            push(globals[index].value);
+            NEXT();
+        }
+
+        CASE(DEFINE_GLOBAL):
+        {
+            // Like the interpreter, redeclaring a global keeps its first value.
+            auto& global = globals[READ_SHORT()];
+            Value value = pop();
+            if (!global.is_defined)
+            {
+                global.value = std::move(value);
+                global.is_defined = true;
+            }
+            NEXT();
+        }
+
+        CASE(SET_GLOBAL):
+        {
+            const uint16_t index = READ_SHORT();
+            if (!globals[index].is_defined)
+            {
+                RUNTIME_ERROR("Undefined variable '" + (*global_names)[index] + "'.");
+            }
+            globals[index].value = stack_top[-1];
+            NEXT();
+        }
+
+        CASE(GET_UPVALUE):
+            push(*frame->closure->upvalues[READ_BYTE()].as<Upvalue>()->location);
+            NEXT();
+
+        CASE(SET_UPVALUE):
+        {
+            auto upvalue = frame->closure->upvalues[READ_BYTE()].as<Upvalue>();
+            *upvalue->location = stack_top[-1];
+            heap.writeBarrier(upvalue, stack_top[-1]);
+            NEXT();
+        }
+
+        CASE(GET_SUBSCRIPT):
+        CASE(SET_SUBSCRIPT):
+        {
+            const bool is_set = ip[-1] == static_cast<uint8_t>(OpCode::SET_SUBSCRIPT);
+            const auto& name = READ_NAME();
+
+            // The stack holds the list, the index and the assigned value, if any.
+            const Value value = is_set ? pop() : Value{};
+            const Value index = pop();
+            const Value items = pop();
+
+            if (!items.isList())
+            {
+                RUNTIME_ERROR("Object '" + name + "' is not subscriptable.");
+            }
+            if (!index.isNumber() || static_cast<int>(index.asNumber()) != index.asNumber())
+            {
+                RUNTIME_ERROR("Indices must be integers.");
+            }
+
+            auto list = items.as<List>();
+            double index_cast = index.asNumber();
+
+            // Allows negative indexes for reverse order.
+            if (index_cast < 0)
+            {
+                index_cast = static_cast<int>(list->length()) + index_cast;
+            }
+
+            try
+            {
+                auto& item = list->at(static_cast<int>(index_cast));
+                if (is_set)
+                {
+                    item = value;
+                    heap.writeBarrier(list, value);
+                }
+                push(item);
+            }
+            catch (const std::out_of_range&)
+            {
+                RUNTIME_ERROR("Index out of range. Index is " +
+                              std::to_string(static_cast<int>(index_cast)) +
+                              " but object size is " + std::to_string(list->length()));
+            }
+            NEXT();
+        }
+
+        CASE(EQUAL):
+        {
+            const Value rhs = pop();
+            stack_top[-1] = isEqual(stack_top[-1], rhs);
+            NEXT();
+        }
+
+        CASE(GREATER):
+            BINARY_OP(>)
+
+        CASE(GREATER_EQUAL):
+            BINARY_OP(>=)
+
+        CASE(LESS):
+            BINARY_OP(<)
+
+        CASE(LESS_EQUAL):
+            BINARY_OP(<=)
+
+        CASE(ADD):
+        {
+            const Value& lhs = stack_top[-2];
+            const Value& rhs = stack_top[-1];
+
+            // The operands stay on the stack while a string is allocated, since it may be a rope
+            // referring to them.
+            Value result;
+            if (lhs.isNumber() && rhs.isNumber())
+            {
+                result = lhs.asNumber() + rhs.asNumber();
+            }
+            else if (lhs.isString() && rhs.isString())
+            {
+                result = heap.allocate<String>(lhs.as<String>(), rhs.as<String>());
+            }
+            else if (lhs.isNumber() && rhs.isString())
+            {
+                result = heap.allocate<String>(numberToString(lhs.asNumber()), rhs.as<String>());
+            }
+            else if (lhs.isString() && rhs.isNumber())
+            {
+                result = heap.allocate<String>(lhs.as<String>(), numberToString(rhs.asNumber()));
+            }
+            else
+            {
+                RUNTIME_ERROR("Operands must be of type string or number.");
+            }
+
+            pop();
+            stack_top[-1] = std::move(result);
+            NEXT();
+        }
+
+        CASE(SUBTRACT):
+            BINARY_OP(-)
+
+        CASE(MULTIPLY):
+            BINARY_OP(*)
+
+        CASE(DIVIDE):
+        {
+            NUMBER_OPERANDS();
+            if (stack_top[-1].asNumber() == 0)
+            {
+                RUNTIME_ERROR("Division by 0.");
+            }
+            const double rhs = pop().asNumber();
+            stack_top[-1] = stack_top[-1].asNumber() / rhs;
+            NEXT();
+        }
+
+        CASE(NOT):
+            stack_top[-1] = !isTruthy(stack_top[-1]);
+            NEXT();
+
+        CASE(NEGATE):
+            if (!stack_top[-1].isNumber())
+            {
+                RUNTIME_ERROR("Operand must be a number.");
+            }
+            stack_top[-1] = -stack_top[-1].asNumber();
+            NEXT();
+
+        CASE(INCREMENT):
+        CASE(DECREMENT):
+        {
+            const bool is_increment = ip[-1] == static_cast<uint8_t>(OpCode::INCREMENT);
+            const auto& name = READ_NAME();
+            if (!stack_top[-1].isNumber())
+            {
+                RUNTIME_ERROR(std::string{is_increment ? "Cannot increment" : "Cannot decrement"} +
+                              " a non integer type '" + name + "'.");
+            }
+            stack_top[-1] = stack_top[-1].asNumber() + (is_increment ? 1 : -1);
+            NEXT();
+        }
+
+        CASE(LIST):
+        {
+            // The items stay on the stack until the list holding them is created.
+            const uint8_t count = READ_BYTE();
+            Value list{heap.allocate<List>(std::vector<Value>(stack_top - count, stack_top))};
+            stack_top -= count;
+            push(list);
+            NEXT();
+        }
+
+        CASE(JUMP):
+        {
+            const uint16_t offset = READ_SHORT();
+            ip += offset;
+            NEXT();
+        }
+
+        CASE(JUMP_IF_FALSE):
+        {
+            const uint16_t offset = READ_SHORT();
+            if (!isTruthy(stack_top[-1]))
+            {
+                ip += offset;
+            }
+            NEXT();
+        }
+
+        CASE(LOOP):
+        {
+            const uint16_t offset = READ_SHORT();
+            ip -= offset;
+            NEXT();
+        }
+
+        CASE(CALL):
+        {
+            const uint8_t arg_count = READ_BYTE();
+            frame->ip = ip;
+            callValue(arg_count);
+            LOAD_FRAME();
+            NEXT();
+        }
+
+        CASE(CLOSURE):
+        {
+            // The closure is pushed before capturing, which allocates the upvalues.
+            auto function = READ_CONSTANT().as<CompiledFunction>();
+            push(heap.allocate<Closure>(function));
+            auto closure = stack_top[-1].as<Closure>();
+            for (auto& upvalue : closure->upvalues)
+            {
+                const bool is_local = READ_BYTE() == 1u;
+                const uint8_t index = READ_BYTE();
+                upvalue = is_local ? open_upvalues.capture(heap, slots + index)
+                                   : frame->closure->upvalues[index];
+                // Capturing may have promoted the closure.
+                heap.writeBarrier(closure, upvalue);
+            }
+            NEXT();
+        }
+
+        CASE(CLOSE_UPVALUE):
+            open_upvalues.close(heap, stack_top - 1);
+            pop();
+            NEXT();
+
+        CASE(RETURN):
+        {
+            Value result = pop();
+            open_upvalues.close(heap, slots);
+
+            // Discard the frame, including the called closure.
+            while (stack_top != slots)
+            {
+                pop();
+            }
+
+            if (--frame_count == 0u)
+            {
+                return;
+            }
+
+            push(std::move(result));
+            LOAD_FRAME();
+            NEXT();
+        }
+        }
+    }
+
+#undef READ_BYTE
+#undef READ_SHORT
+#undef READ_CONSTANT
+#undef READ_NAME
+#undef LOAD_FRAME
+#undef RUNTIME_ERROR
+#undef NUMBER_OPERANDS
+#undef BINARY_OP
+#undef DISPATCH
+#undef CASE
+#undef NEXT
+}
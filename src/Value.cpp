@@ -0,0 +1,31 @@
+#include "../include/Value.hpp"
+#include "../include/StringType.hpp"
+
+bool isEqual(const Value& lhs, const Value& rhs) noexcept
+{
+    // Values of different types are never equal.
+    if (lhs.getType() != rhs.getType())
+    {
+        return false;
+    }
+
+    switch (lhs.getType())
+    {
+    case Value::Type::NIL:
+        return true;
+    case Value::Type::BOOL:
+        return lhs.asBool() == rhs.asBool();
+    case Value::Type::NUMBER:
+        return lhs.asNumber() == rhs.asNumber();
+    case Value::Type::OBJECT:
+        break;
+    }
+
+    // Strings compare by content, other objects are never equal.
+    if (lhs.isString() && rhs.isString())
+    {
+        return lhs.as<String>()->equals(*rhs.as<String>());
+    }
+
+    return false;
+}
@@ -1,35 +1,408 @@
+#include "../include/AstPrinter.hpp"
+#include "../include/BytecodeFile.hpp"
+#include "../include/ClosureCompiler.hpp"
+#include "../include/Compiler.hpp"
 #include "../include/Interpreter.hpp"
 #include "../include/Lexer.hpp"
 #include "../include/Logger.hpp"
+#include "../include/MappedFile.hpp"
+#include "../include/ParallelParser.hpp"
 #include "../include/Parser.hpp"
 #include "../include/Resolver.hpp"
+#include "../include/VM.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <system_error>
+#include <thread>
 
-std::string readFile(std::string_view filename)
+// Execution engines selectable with --engine.
+enum class Engine
 {
-    std::ifstream file{filename.data(), std::ios::ate};
-    if (!file)
+    TREE_WALKER, // Walks the AST directly (default).
+    CLOSURE,     // Compiles the AST to a tree of specialized executable nodes.
+    VM           // Compiles to bytecode for the stack-based VM.
+};
+
+Engine engine = Engine::TREE_WALKER;
+// Print the flat AST of the program before resolving it (--dump-ast).
+bool dump_ast = false;
+// Print the Resolver's statistics before running the program (--dump-resolution).
+bool dump_resolution = false;
+// Print the garbage collector's statistics after running the program (--gc-stats).
+bool gc_stats = false;
+// Only report syntax and resolution errors, without running the program (--check).
+bool check_only = false;
+// Parse the bodies of all functions before running the program, reporting syntax errors in
+// functions that are never called (--strict-parse).
+bool strict_parse = false;
+// Threads lexing and parsing scripts of several chunks (--parse-threads=N).
+unsigned int parse_threads = std::thread::hardware_concurrency();
+// Compile the script to a bytecode file instead of running it (--compile).
+bool compile_only = false;
+// Bytecode file written by --compile, next to the script by default (-o <file>).
+std::string output_file;
+// Keep the bytecode of scripts run on the VM in the user's cache directory (--no-cache disables).
+bool use_cache = true;
+
+MappedFile openFile(const std::string& filename)
+{
+    try
+    {
+        return MappedFile{filename};
+    }
+    catch (const std::system_error& error)
+    {
+        std::cerr << error.what() << '\n';
+        std::exit(74); // I/O error
+    }
+}
+
+// Writes a whole file, exiting on I/O errors.
+void writeFile(const std::filesystem::path& path, std::string_view contents)
+{
+    std::ofstream file{path, std::ios::binary};
+    if (!file.write(contents.data(), static_cast<std::streamsize>(contents.size())))
     {
-        std::cerr << "Failed to open file " << filename.data() << '\n';
+        std::cerr << "Failed to write file " << path.string() << '\n';
         std::exit(74); // I/O error
     }
-    std::string file_contents;
-    file_contents.resize(file.tellg());
-    file.seekg(0, std::ios::beg);
-    file.read(file_contents.data(), file_contents.size());
-    file.close();
+}
+
+// Where the bytecode of scripts run on the VM is cached: $XDG_CACHE_HOME/jlox, or ~/.cache/jlox.
+std::optional<std::filesystem::path> cacheDirectory()
+{
+    if (const char* cache_home = std::getenv("XDG_CACHE_HOME"); cache_home && *cache_home)
+    {
+        return std::filesystem::path{cache_home} / "jlox";
+    }
+    if (const char* home = std::getenv("HOME"); home && *home)
+    {
+        return std::filesystem::path{home} / ".cache" / "jlox";
+    }
+    return std::nullopt;
+}
+
+// A script's entry in the bytecode cache, named after the hash of its contents.
+struct CacheEntry
+{
+    std::filesystem::path path;
+    uint64_t source_hash;
+};
+
+std::optional<CacheEntry> cacheEntry(std::string_view source)
+{
+    const auto directory = cacheDirectory();
+    if (!directory)
+    {
+        return std::nullopt;
+    }
+    const uint64_t hash = BytecodeFile::hashSource(source);
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash << ".jloxc";
+    return CacheEntry{*directory / name.str(), hash};
+}
+
+// Returns nullopt if the script isn't cached yet, or its entry is stale or unreadable.
+std::optional<CompiledProgram> loadFromCache(const CacheEntry& entry)
+{
+    std::error_code error;
+    if (!std::filesystem::exists(entry.path, error))
+    {
+        return std::nullopt;
+    }
+    try
+    {
+        const MappedFile file{entry.path.string()};
+        if (BytecodeFile::sourceHash(file.contents()) != entry.source_hash)
+        {
+            return std::nullopt;
+        }
+        return BytecodeFile::read(file.contents());
+    }
+    catch (const std::exception&)
+    {
+        // Entries of another version of the format are replaced once the script is compiled.
+        return std::nullopt;
+    }
+}
+
+// The cache is only an optimization, so failing to write to it is ignored. The entry is written
+// to a temporary file first, so that other processes never read half of it.
+void storeInCache(const CacheEntry& entry, const CompiledProgram& program)
+{
+    std::error_code error;
+    std::filesystem::create_directories(entry.path.parent_path(), error);
+    if (error)
+    {
+        return;
+    }
+
+    auto temporary = entry.path;
+    temporary += ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream file{temporary, std::ios::binary};
+        const std::string contents = BytecodeFile::write(program, entry.source_hash);
+        if (!file.write(contents.data(), static_cast<std::streamsize>(contents.size())))
+        {
+            file.close();
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, entry.path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+    }
+}
+
+// Share of `part` in `total`, as a percentage.
+double percentage(size_t part, size_t total)
+{
+    return total == 0u ? 0.0 : 100.0 * part / total;
+}
+
+void dumpResolution(const Resolver::Statistics& statistics)
+{
+    std::cerr << std::fixed << std::setprecision(1) << "Resolution statistics:\n"
+              << "  locals:    " << statistics.locals << ", " << statistics.captured_locals
+              << " captured ("
+              << percentage(statistics.captured_locals, statistics.locals) << "%)\n"
+              << "  scopes:    " << statistics.scopes << ", " << statistics.captured_scopes
+              << " captured ("
+              << percentage(statistics.captured_scopes, statistics.scopes) << "%)\n"
+              << "  functions: " << statistics.functions << ", "
+              << statistics.closure_free_functions << " create no closures ("
+              << percentage(statistics.closure_free_functions, statistics.functions) << "%)\n";
+}
+
+// Pause below which `percent` percent of the sorted `pauses` fall (nearest rank).
+std::chrono::nanoseconds percentile(const std::vector<std::chrono::nanoseconds>& pauses,
+                                    double percent)
+{
+    if (pauses.empty())
+    {
+        return std::chrono::nanoseconds{0};
+    }
+    const auto rank = static_cast<size_t>(std::ceil(percent / 100.0 * pauses.size()));
+    return pauses[std::max<size_t>(rank, 1u) - 1u];
+}
+
+void dumpHeapStatistics(const Heap::Statistics& statistics, std::chrono::nanoseconds run_time)
+{
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    using Seconds = std::chrono::duration<double>;
 
-    return file_contents;
+    auto pauses = statistics.pauses;
+    std::sort(pauses.begin(), pauses.end());
+    const auto total_pause = std::accumulate(pauses.begin(), pauses.end(),
+                                             std::chrono::nanoseconds{0});
+    const double throughput =
+        run_time.count() == 0 ? 0.0 : statistics.objects_allocated / Seconds{run_time}.count();
+
+    std::cerr << std::fixed << std::setprecision(3) << "GC statistics:\n"
+              << "  collections: " << statistics.minor_collections << " minor, "
+              << statistics.full_collections << " full\n"
+              << "  allocated:   " << statistics.objects_allocated << " objects, "
+              << std::setprecision(0) << throughput << " objects/s\n"
+              << std::setprecision(1) << "  promoted:    " << statistics.objects_promoted
+              << " objects ("
+              << percentage(statistics.objects_promoted, statistics.objects_allocated) << "%)\n"
+              << std::setprecision(3) << "  pause time:  " << Milliseconds{total_pause}.count()
+              << " ms total (" << percentage(total_pause.count(), run_time.count())
+              << "% of run time)\n"
+              << "  pauses:      " << Milliseconds{percentile(pauses, 50.0)}.count()
+              << " ms p50, " << Milliseconds{percentile(pauses, 99.0)}.count() << " ms p99, "
+              << Milliseconds{percentile(pauses, 100.0)}.count() << " ms max\n"
+              << "  reclaimed:   " << statistics.bytes_reclaimed << " bytes in "
+              << statistics.objects_reclaimed << " objects\n";
 }
 
-void run(const std::string& source)
+Ast parse(std::string_view source)
 {
+    // The tree-walking interpreter parses the bodies of top-level functions on their first call.
+    // The other engines compile the whole program before running it, and the options reporting on
+    // the whole program need it all.
+    const bool lazy_functions =
+        engine == Engine::TREE_WALKER && !strict_parse && !dump_ast && !dump_resolution;
+
+    // Scripts too small to be cut into chunks are parsed on this thread only.
+    if (parse_threads > 1u && source.size() >= 2u * ParallelParser::DEFAULT_CHUNK_SIZE)
+    {
+        return ParallelParser{parse_threads, ParallelParser::DEFAULT_CHUNK_SIZE, lazy_functions}
+            .parse(source);
+    }
+
+    // The parser pulls tokens from the lexer as it needs them, without keeping them all.
     Lexer lexer{source};
-    auto tokens = lexer.scanTokens();
+    Parser parser{lexer, lazy_functions};
+    return parser.parse();
+}
+
+// Parses the script into its flat form only, for the options that report on it without running
+// it. Each top-level declaration is flattened as soon as it is parsed and its tree released, so
+// the tree of the whole script is never kept. The tree of a script parsed on several threads is
+// released once flattened.
+FlatAst parseFlat(std::string_view source)
+{
+    FlatAst flat_ast{source};
+    if (parse_threads > 1u && source.size() >= 2u * ParallelParser::DEFAULT_CHUNK_SIZE)
+    {
+        flat_ast.append(
+            ParallelParser{parse_threads, ParallelParser::DEFAULT_CHUNK_SIZE, false}.parse(source)
+                .statements);
+    }
+    else
+    {
+        Lexer lexer{source};
+        Parser parser{lexer};
+        while (true)
+        {
+            const auto ast = parser.parseDeclaration();
+            if (ast.statements.empty())
+            {
+                break;
+            }
+            flat_ast.append(ast.statements);
+        }
+    }
+    flat_ast.finish();
+    return flat_ast;
+}
+
+// Reports the syntax and resolution errors of the script without running it (--check), working
+// on the flat AST.
+void check(std::string_view source)
+{
+    const FlatAst flat_ast = parseFlat(source);
+    if (Error::hadError)
+    {
+        Error::report();
+        return;
+    }
+
+    if (dump_ast)
+    {
+        std::cerr << AstPrinter{}.print(flat_ast) << "Flat AST: " << flat_ast.size()
+                  << " nodes, " << flat_ast.memoryUsage() << " bytes\n";
+    }
+
+    Resolver resolver;
+    resolver.resolve(flat_ast);
+    if (Error::hadError)
+    {
+        Error::report();
+        return;
+    }
+
+    if (dump_resolution)
+    {
+        dumpResolution(resolver.getStatistics());
+    }
+}
+
+// Prints the statistics of a finished run, and reports its errors if any.
+void finishRun(const Heap::Statistics& heap_statistics,
+               std::chrono::steady_clock::time_point start)
+{
+    if (gc_stats)
+    {
+        dumpHeapStatistics(heap_statistics, std::chrono::steady_clock::now() - start);
+    }
+
+    // Report all runtime errors, if any, and the errors of the function bodies parsed on their
+    // first call.
+    if (Error::hadRuntimeError || Error::hadError)
+    {
+        Error::report();
+    }
+}
 
-    Parser parser{std::move(tokens)};
-    const auto statements = parser.parse();
+void runCompiled(const CompiledProgram& program)
+{
+    const auto start = std::chrono::steady_clock::now();
+    VM vm;
+    vm.interpret(program);
+    finishRun(vm.getHeapStatistics(), start);
+}
+
+// A program loaded from a bytecode file owns all of its objects, so the file isn't needed once
+// it is loaded.
+void runBytecode(std::string_view contents)
+{
+    std::optional<CompiledProgram> program;
+    try
+    {
+        program = BytecodeFile::read(contents);
+    }
+    catch (const BytecodeFile::FormatError& error)
+    {
+        std::cerr << error.what() << '\n';
+        std::exit(65); // Data format error
+    }
+    runCompiled(*program);
+}
+
+// Compiles the script to a bytecode file instead of running it.
+void compileFile(std::string_view source, const std::filesystem::path& output)
+{
+    const auto ast = parse(source);
+    if (Error::hadError)
+    {
+        Error::report();
+        return;
+    }
+
+    Resolver resolver;
+    resolver.resolve(ast.statements);
+    if (Error::hadError)
+    {
+        Error::report();
+        return;
+    }
+
+    Compiler compiler;
+    const auto program = compiler.compile(ast.statements);
+    if (!program)
+    {
+        Error::report();
+        return;
+    }
+    writeFile(output, BytecodeFile::write(*program, BytecodeFile::hashSource(source)));
+}
+
+// Scripts run on the VM are looked up in the bytecode cache when given its `cache` entry, and
+// stored in it once compiled.
+void run(std::string_view source, const std::optional<CacheEntry>& cache = std::nullopt)
+{
+    // A cached program skips lexing, parsing, resolving and compiling altogether.
+    if (cache)
+    {
+        if (const auto program = loadFromCache(*cache))
+        {
+            runCompiled(*program);
+            return;
+        }
+    }
+
+    if (check_only)
+    {
+        check(source);
+        return;
+    }
+
+    const auto ast = parse(source);
+    const auto& statements = ast.statements;
 
     // Stop if there were any syntax errors.
     if (Error::hadError)
@@ -38,9 +411,14 @@ void run(const std::string& source)
         return;
     }
 
-    Interpreter interpreter;
+    if (dump_ast)
+    {
+        const FlatAst flat_ast{source, statements};
+        std::cerr << AstPrinter{}.print(flat_ast) << "Flat AST: " << flat_ast.size()
+                  << " nodes, " << flat_ast.memoryUsage() << " bytes\n";
+    }
 
-    Resolver resolver{interpreter};
+    Resolver resolver;
     resolver.resolve(statements);
 
     // Stop if there were any resolution errors.
@@ -50,19 +428,69 @@ void run(const std::string& source)
         return;
     }
 
-    interpreter.interpret(statements);
+    if (dump_resolution)
+    {
+        dumpResolution(resolver.getStatistics());
+    }
 
-    // Report all runtime errors, if any.
-    if (Error::hadRuntimeError)
+    Heap::Statistics heap_statistics;
+    const auto start = std::chrono::steady_clock::now();
+    if (engine == Engine::CLOSURE)
     {
-        Error::report();
+        ClosureCompiler compiler;
+        heap_statistics = compiler.compile(statements).run();
+    }
+    else if (engine == Engine::VM)
+    {
+        Compiler compiler;
+        const auto program = compiler.compile(statements);
+        if (!program)
+        {
+            Error::report();
+            return;
+        }
+
+        if (cache)
+        {
+            storeInCache(*cache, *program);
+        }
+
+        VM vm;
+        vm.interpret(*program);
+        heap_statistics = vm.getHeapStatistics();
+    }
+    else
+    {
+        Interpreter interpreter;
+        interpreter.interpret(statements);
+        heap_statistics = interpreter.getHeapStatistics();
     }
+
+    finishRun(heap_statistics, start);
 }
 
 void initFile(const std::string& filename)
 {
-    std::string file_contents = readFile(filename);
-    run(file_contents);
+    // The AST refers to the source, which stays mapped until the program has run.
+    const MappedFile file = openFile(filename);
+    const auto contents = file.contents();
+    if (BytecodeFile::isBytecode(contents))
+    {
+        runBytecode(contents);
+    }
+    else if (compile_only)
+    {
+        compileFile(contents, output_file.empty()
+                                  ? std::filesystem::path{filename}.replace_extension(".jloxc")
+                                  : std::filesystem::path{output_file});
+    }
+    else
+    {
+        // Only the VM runs bytecode, and the other options need the AST.
+        const bool cached = engine == Engine::VM && use_cache && !check_only && !dump_ast &&
+                            !dump_resolution;
+        run(contents, cached ? cacheEntry(contents) : std::nullopt);
+    }
     if (Error::hadError)
     {
         std::exit(65);
@@ -97,15 +525,106 @@ void runPrompt()
     }
 }
 
+void usage()
+{
+    std::cerr << "Usage: main [--engine=tree|closure|vm] [--dump-ast] [--dump-resolution]\n"
+                 "            [--gc-stats] [--check] [--strict-parse] [--parse-threads=N]\n"
+                 "            [--no-cache] [script]\n"
+                 "       main --compile [-o <file>] <script>\n"
+                 "\n"
+                 "  --check         report the syntax and resolution errors of the whole script\n"
+                 "                  without running it\n"
+                 "  --strict-parse  parse and resolve every function body up front. Otherwise\n"
+                 "                  the tree engine defers the errors in a body, such as a\n"
+                 "                  syntax error or a stray break, until the function is first\n"
+                 "                  called, and exits 0 if it never is; closure and vm always\n"
+                 "                  report them up front\n";
+    std::exit(64);
+}
+
 int main(int argc, char* argv[])
 {
-    if (argc > 2)
+    // Options may come before or after the script.
+    std::optional<std::string> script;
+    for (int arg = 1; arg < argc; ++arg)
     {
-        std::exit(64);
+        const std::string_view option{argv[arg]};
+        if (!option.starts_with("-"))
+        {
+            if (script)
+            {
+                usage();
+            }
+            script = argv[arg];
+        }
+        else if (option == "--engine=tree")
+        {
+            engine = Engine::TREE_WALKER;
+        }
+        else if (option == "--engine=closure")
+        {
+            engine = Engine::CLOSURE;
+        }
+        else if (option == "--engine=vm")
+        {
+            engine = Engine::VM;
+        }
+        else if (option == "--dump-ast")
+        {
+            dump_ast = true;
+        }
+        else if (option == "--dump-resolution")
+        {
+            dump_resolution = true;
+        }
+        else if (option == "--gc-stats")
+        {
+            gc_stats = true;
+        }
+        else if (option == "--check")
+        {
+            check_only = true;
+        }
+        else if (option == "--strict-parse")
+        {
+            strict_parse = true;
+        }
+        else if (option.starts_with("--parse-threads="))
+        {
+            parse_threads = static_cast<unsigned int>(
+                std::strtoul(option.substr(option.find('=') + 1u).data(), nullptr, 10));
+        }
+        else if (option == "--compile")
+        {
+            compile_only = true;
+        }
+        else if (option == "-o" && arg + 1 < argc)
+        {
+            output_file = argv[++arg];
+        }
+        else if (option == "--no-cache")
+        {
+            use_cache = false;
+        }
+        else
+        {
+            usage();
+        }
     }
-    else if (argc == 2)
+
+    if (compile_only)
+    {
+        // Functions are compiled to bytecode as a whole.
+        engine = Engine::VM;
+        if (!script)
+        {
+            usage();
+        }
+    }
+
+    if (script)
     {
-        initFile(argv[1]);
+        initFile(*script);
     }
     else
     {
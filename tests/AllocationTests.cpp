@@ -0,0 +1,125 @@
+#include "../include/Interpreter.hpp"
+#include "../include/Lexer.hpp"
+#include "../include/Parser.hpp"
+#include "../include/Resolver.hpp"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// These tests replace the global operator new to count allocations, so they are built into their
+// own executable, leaving the allocator of unit_test alone.
+namespace
+{
+    // Calls to the global operator new while an AllocationCounter exists.
+    std::atomic<bool> is_counting{false};
+    std::atomic<size_t> allocations{0u};
+
+    // Counts the allocations made during its lifetime. The operators below only count while one
+    // exists.
+    class AllocationCounter
+    {
+    public:
+        AllocationCounter()
+        {
+            allocations = 0u;
+            is_counting = true;
+        }
+
+        ~AllocationCounter() { is_counting = false; }
+
+        size_t count() const { return allocations; }
+    };
+}
+
+void* operator new(size_t size)
+{
+    if (is_counting)
+    {
+        ++allocations;
+    }
+    if (void* memory = std::malloc(size == 0u ? 1u : size))
+    {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    if (is_counting)
+    {
+        ++allocations;
+    }
+    // aligned_alloc requires the size to be a multiple of the alignment.
+    const auto align = static_cast<size_t>(alignment);
+    if (void* memory = std::aligned_alloc(align, (size + align - 1u) / align * align))
+    {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+TEST(AllocationTests, StringEqualityDoesNotAllocate)
+{
+    // The strings of tests/benchmarks/stringEquality.jlox, with one built at runtime as well, so
+    // both interned and uninterned strings are compared.
+    const std::string declarations = R"(
+        var a1 = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa1";
+        var a2 = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa2";
+        var b1 = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa" + "1";
+        var i = 0;
+        // b1 is long enough to be a rope, which its first comparison flattens.
+        b1 == a1;
+    )";
+    // The loop of the benchmark, run on its own once the strings exist.
+    const std::string loop = R"(
+        while (i++ < 1000) {
+            a1 == a1; a1 == a2; a1 == b1; b1 == a1; b1 == a2; b1 == b1; a1 != b1;
+        }
+    )";
+
+    Lexer declarations_lexer{declarations};
+    Parser declarations_parser{declarations_lexer};
+    const auto declarations_ast = declarations_parser.parse();
+    Lexer loop_lexer{loop};
+    Parser loop_parser{loop_lexer};
+    const auto loop_ast = loop_parser.parse();
+    Resolver resolver;
+    resolver.resolve(declarations_ast.statements);
+    resolver.resolve(loop_ast.statements);
+
+    Interpreter interpreter;
+    interpreter.interpret(declarations_ast.statements);
+    size_t loop_allocations = 0u;
+    {
+        const AllocationCounter counter;
+        interpreter.interpret(loop_ast.statements);
+        loop_allocations = counter.count();
+    }
+
+    EXPECT_EQ(loop_allocations, 0u);
+    EXPECT_FALSE(Error::hadError);
+    EXPECT_FALSE(Error::hadRuntimeError);
+}
@@ -0,0 +1,153 @@
+#include "../include/BytecodeFile.hpp"
+#include "../include/Lexer.hpp"
+#include "../include/Logger.hpp"
+#include "../include/Parser.hpp"
+#include "../include/Resolver.hpp"
+#include "../include/VM.hpp"
+
+#include <gtest/gtest.h>
+
+// Compiles a script, failing the test if it has errors.
+std::optional<CompiledProgram> compileProgram(const std::string& test_script)
+{
+    Lexer lexer{test_script};
+    Parser parser{lexer.scanTokens()};
+    const auto ast = parser.parse();
+
+    Resolver resolver;
+    resolver.resolve(ast.statements);
+
+    Compiler compiler;
+    auto program = compiler.compile(ast.statements);
+    if (!program)
+    {
+        ADD_FAILURE() << "The script failed to compile.";
+    }
+    return program;
+}
+
+// Compiles a script and writes it to the bytecode format.
+std::string compileToBytecode(const std::string& test_script, uint64_t source_hash = 0u)
+{
+    const auto program = compileProgram(test_script);
+    if (!program)
+    {
+        return {};
+    }
+    return BytecodeFile::write(*program, source_hash);
+}
+
+std::string runBytecode(const std::string& bytecode)
+{
+    const auto program = BytecodeFile::read(bytecode);
+    VM vm;
+    testing::internal::CaptureStdout();
+    vm.interpret(program);
+    return testing::internal::GetCapturedStdout();
+}
+
+TEST(BytecodeFileTests, RoundTrip)
+{
+    const auto test_script = R"(
+        fn makeCounter(step) {
+            var count = 0;
+            fn counter() { count = count + step; return count; }
+            return counter;
+        }
+        var counter = makeCounter(2.5);
+        counter();
+        var list = ["a", "a" + "b", true, nil];
+        print(counter(), list, list[1], -0.125);
+    )";
+
+    const std::string bytecode = compileToBytecode(test_script);
+    EXPECT_TRUE(BytecodeFile::isBytecode(bytecode));
+    EXPECT_EQ(runBytecode(bytecode), "5 [ a, ab, true, nil ] ab -0.125 \n");
+}
+
+TEST(BytecodeFileTests, KeepsLinesAndNames)
+{
+    const auto test_script = "var list = [1];\n"
+                             "fn get(i) {\n"
+                             "    return list[i];\n"
+                             "}\n"
+                             "get(3);\n";
+
+    const std::string bytecode = compileToBytecode(test_script, 42u);
+    EXPECT_EQ(BytecodeFile::sourceHash(bytecode), 42u);
+
+    runBytecode(bytecode);
+    EXPECT_TRUE(Error::hadRuntimeError);
+    ASSERT_EQ(Error::exceptionList.size(), 1u);
+    EXPECT_EQ(Error::exceptionList[0].line, 3u);
+
+    Error::exceptionList.clear();
+    Error::hadRuntimeError = false;
+}
+
+TEST(BytecodeFileTests, RejectsInvalidFiles)
+{
+    const std::string bytecode = compileToBytecode("print(1);");
+
+    EXPECT_FALSE(BytecodeFile::isBytecode("print(1);"));
+    EXPECT_THROW(BytecodeFile::read("print(1);"), BytecodeFile::FormatError);
+    EXPECT_THROW(BytecodeFile::read(std::string_view{bytecode}.substr(0u, bytecode.size() - 1u)),
+                 BytecodeFile::FormatError);
+    EXPECT_THROW(BytecodeFile::read(bytecode + '\0'), BytecodeFile::FormatError);
+
+    // The version follows the 8 byte magic number.
+    std::string other_version = bytecode;
+    other_version[8] = static_cast<char>(BytecodeFile::VERSION + 1u);
+    EXPECT_THROW(BytecodeFile::read(other_version), BytecodeFile::FormatError);
+}
+
+// Loads the script compiled from `test_script` after `corrupt` changed its code.
+CompiledProgram readCorrupted(const std::string& test_script, void (*corrupt)(Chunk& chunk))
+{
+    const auto program = compileProgram(test_script);
+    if (!program)
+    {
+        return {};
+    }
+    corrupt(program->script.as<CompiledFunction>()->chunk);
+    return BytecodeFile::read(BytecodeFile::write(*program));
+}
+
+TEST(BytecodeFileTests, RejectsInvalidCode)
+{
+    // GET_GLOBAL print, CONSTANT 1, CALL 1, POP and the implicit NIL and RETURN.
+    const std::string script = "print(1);";
+
+    EXPECT_NO_THROW(readCorrupted(script, [](Chunk&) {}));
+    EXPECT_THROW(readCorrupted(script, [](Chunk& chunk) { chunk.code[0] = 0xffu; }),
+                 BytecodeFile::FormatError);
+    // Operands out of range.
+    EXPECT_THROW(readCorrupted(script, [](Chunk& chunk) { chunk.code[2] = 9u; }),
+                 BytecodeFile::FormatError);
+    EXPECT_THROW(readCorrupted(script, [](Chunk& chunk) { chunk.code[5] = 9u; }),
+                 BytecodeFile::FormatError);
+    // Popping more than was pushed, and falling off the end of the code.
+    EXPECT_THROW(readCorrupted(script,
+                               [](Chunk& chunk)
+                               { chunk.code.end()[-2] = static_cast<uint8_t>(OpCode::POP); }),
+                 BytecodeFile::FormatError);
+    EXPECT_THROW(readCorrupted(script,
+                               [](Chunk& chunk)
+                               { chunk.code.back() = static_cast<uint8_t>(OpCode::POP); }),
+                 BytecodeFile::FormatError);
+    // Jumping into the middle of the first instruction, from a jump in front of it.
+    EXPECT_THROW(readCorrupted(script,
+                               [](Chunk& chunk)
+                               {
+                                   chunk.code.insert(chunk.code.begin(),
+                                                     {static_cast<uint8_t>(OpCode::JUMP), 0u, 1u});
+                                   chunk.lines.insert(chunk.lines.begin(), 3u, 1u);
+                               }),
+                 BytecodeFile::FormatError);
+}
+
+TEST(BytecodeFileTests, HashesSource)
+{
+    EXPECT_EQ(BytecodeFile::hashSource("print(1);"), BytecodeFile::hashSource("print(1);"));
+    EXPECT_NE(BytecodeFile::hashSource("print(1);"), BytecodeFile::hashSource("print(2);"));
+}
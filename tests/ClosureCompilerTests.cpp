@@ -0,0 +1,125 @@
+#include "../include/ClosureCompiler.hpp"
+#include "../include/Lexer.hpp"
+#include "../include/Parser.hpp"
+#include "../include/Resolver.hpp"
+
+#include <gtest/gtest.h>
+
+std::string runCompiledNodes(const std::string& test_script)
+{
+    Lexer lexer{test_script};
+    Parser parser{lexer.scanTokens()};
+    const auto ast = parser.parse();
+    const auto& statements = ast.statements;
+
+    Resolver resolver;
+    resolver.resolve(statements);
+
+    ClosureCompiler compiler;
+    const auto program = compiler.compile(statements);
+
+    testing::internal::CaptureStdout();
+    program.run();
+    return testing::internal::GetCapturedStdout();
+}
+
+TEST(ClosureCompilerTests, OperandShapes)
+{
+    const auto test_script = R"(
+        var g = 10;
+        fn f(a) {
+            var b = 2;
+            print(a + b, a - 1, 1 * b, g / a, (a + 1) * (b + 1), "s" + a, a == 4, b != 2);
+            print(a + (a = 1), a);
+        }
+        f(4);
+    )";
+
+    EXPECT_EQ(runCompiledNodes(test_script), "6 3 2 2.5 15 s4 true false \n5 1 \n");
+}
+
+TEST(ClosureCompilerTests, CallOnTheLeftOfALocal)
+{
+    // The deep recursion grows the call stack, moving the frame slot of x, which is only read once
+    // the call on the left has returned.
+    const auto test_script = R"(
+        fn g(n) { if (n == 0) return 0; return g(n - 1); }
+        fn test() { var x = 5; return g(3000) + x; }
+        print(test());
+    )";
+
+    EXPECT_EQ(runCompiledNodes(test_script), "5 \n");
+}
+
+TEST(ClosureCompilerTests, IncrementAndDecrement)
+{
+    const auto test_script = R"(
+        var n = 5;
+        print(n++, n, ++n, n--, --n, n);
+        fn f() { var m = 1; m++; return ++m; }
+        print(f());
+    )";
+
+    EXPECT_EQ(runCompiledNodes(test_script), "5 6 7 7 5 5 \n3 \n");
+}
+
+TEST(ClosureCompilerTests, ControlFlow)
+{
+    const auto test_script = R"(
+        fn find(list, item) {
+            for (var i = 0; i < 10; i++) {
+                while (true) {
+                    if (list[i] == item) return i;
+                    break;
+                }
+                if (i == 1) continue;
+                elif (i == 3) print("three");
+            }
+            return nil;
+        }
+        print(find([1, 2, 3, 4, 5], 5), find([1, 2], 2), nil or "or", 1 and 2);
+    )";
+
+    EXPECT_EQ(runCompiledNodes(test_script), "three \n4 1 or 2 \n");
+}
+
+TEST(ClosureCompilerTests, Closures)
+{
+    const auto test_script = R"(
+        fn makeCounter() {
+            var count = 0;
+            fn counter() { return ++count; }
+            return counter;
+        }
+        var first = makeCounter();
+        var second = makeCounter();
+        print(first(), first(), second());
+
+        var fns = [nil, nil];
+        for (var i = 0; i < 2; i++) {
+            var captured = i;
+            fn f() { return captured + i; }
+            fns[i] = f;
+        }
+        print(fns[0](), fns[1]());
+    )";
+
+    EXPECT_EQ(runCompiledNodes(test_script), "1 2 1 \n2 3 \n");
+}
+
+TEST(ClosureCompilerTests, SharedUpvalues)
+{
+    const auto test_script = R"(
+        fn makePair(start) {
+            fn increment() { start++; }
+            fn get() { fn read() { return start; } return read(); }
+            return [increment, get];
+        }
+        var pair = makePair(1);
+        pair[0]();
+        pair[0]();
+        print(pair[1]());
+    )";
+
+    EXPECT_EQ(runCompiledNodes(test_script), "3 \n");
+}
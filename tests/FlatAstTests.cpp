@@ -0,0 +1,151 @@
+#include "../include/AstPrinter.hpp"
+#include "../include/FlatAst.hpp"
+#include "../include/Lexer.hpp"
+#include "../include/Parser.hpp"
+#include "../include/Resolver.hpp"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+    // First node of the kind whose lexeme is `lexeme`.
+    FlatAst::Index findNode(const FlatAst& ast, FlatAst::Kind kind, std::string_view lexeme)
+    {
+        for (FlatAst::Index node = 0u; node < ast.size(); ++node)
+        {
+            if (ast.kind(node) == kind && ast.lexeme(node) == lexeme)
+            {
+                return node;
+            }
+        }
+        return FlatAst::NONE;
+    }
+}
+
+TEST(FlatAstTests, PrintsSExpressions)
+{
+    const std::string test_script = R"(
+        var list = [1, "two", nil];
+        fn add(a, b) { return a + b; }
+        for (var i = 0; i <= 2; i++) { if (i == 1) continue; else list[i] = -i; }
+        while (!false and true) { --i; }
+        print(add(1, 2.5));
+    )";
+
+    Lexer lexer{test_script};
+    Parser parser{lexer.scanTokens()};
+    const auto ast = parser.parse();
+    const FlatAst flat_ast{test_script, ast.statements};
+
+    EXPECT_EQ(AstPrinter{}.print(flat_ast),
+              "(var list (list 1 \"two\" nil))\n"
+              "(fn add (a b) (return (+ a b)))\n"
+              "(for (var i 0) (<= i 2) (i ++) (block (if (== i 1) (continue) (subscript list i "
+              "(- i)))))\n"
+              "(while (and (! false) true) (block (-- i)))\n"
+              "(call print (call add 1 2.5))\n");
+}
+
+TEST(FlatAstTests, AppendsDeclarationByDeclaration)
+{
+    const std::string test_script = R"(
+        var a = 1;
+        fn f(b) { { var c = a + b; } return b; }
+        while (a < 3) a++;
+    )";
+
+    Lexer lexer{test_script};
+    Parser parser{lexer.scanTokens()};
+    const auto ast = parser.parse();
+    const FlatAst whole{test_script, ast.statements};
+
+    // Every declaration's tree is released before the next one is parsed.
+    Lexer streamed_lexer{test_script};
+    Parser streamed_parser{streamed_lexer};
+    FlatAst streamed{test_script};
+    size_t declarations = 0u;
+    while (true)
+    {
+        const auto declaration = streamed_parser.parseDeclaration();
+        if (declaration.statements.empty())
+        {
+            break;
+        }
+        ASSERT_EQ(declaration.statements.size(), 1u);
+        streamed.append(declaration.statements);
+        ++declarations;
+    }
+    streamed.finish();
+
+    EXPECT_EQ(declarations, 3u);
+    EXPECT_EQ(streamed.size(), whole.size());
+    EXPECT_EQ(AstPrinter{}.print(streamed), AstPrinter{}.print(whole));
+}
+
+TEST(FlatAstTests, ResolvesLikeTheTree)
+{
+    const std::string test_script = R"(
+        fn outer(a, b) {
+            var c = a;
+            { var d = b; fn inner() { return b + d; } }
+            for (var i = 0; i < a; i++) { c = c + i; }
+        }
+    )";
+
+    Lexer lexer{test_script};
+    Parser parser{lexer.scanTokens()};
+    const auto ast = parser.parse();
+    Resolver tree_resolver;
+    tree_resolver.resolve(ast.statements);
+
+    const FlatAst flat_ast{test_script, ast.statements};
+    Resolver flat_resolver;
+    flat_resolver.resolve(flat_ast);
+
+    const auto& tree_statistics = tree_resolver.getStatistics();
+    const auto& flat_statistics = flat_resolver.getStatistics();
+    EXPECT_EQ(flat_statistics.locals, tree_statistics.locals);
+    EXPECT_EQ(flat_statistics.captured_locals, tree_statistics.captured_locals);
+    EXPECT_EQ(flat_statistics.scopes, tree_statistics.scopes);
+    EXPECT_EQ(flat_statistics.captured_scopes, tree_statistics.captured_scopes);
+    EXPECT_EQ(flat_statistics.functions, tree_statistics.functions);
+
+    const auto& outer = dynamic_cast<const FnStmt&>(*ast.statements[0]);
+    const auto& block = dynamic_cast<const BlockStmt&>(*outer.body[1]);
+    const auto& inner = dynamic_cast<const FnStmt&>(*block.statements[1]);
+    const FlatAst::Index flat_outer = findNode(flat_ast, FlatAst::Kind::FUNCTION, "outer");
+    const FlatAst::Index flat_inner = findNode(flat_ast, FlatAst::Kind::FUNCTION, "inner");
+    EXPECT_EQ(flat_ast.function(flat_outer).creates_closures, outer.creates_closures);
+    EXPECT_EQ(flat_ast.function(flat_inner).upvalues, inner.upvalues);
+    EXPECT_EQ(flat_ast.layout(flat_outer).frame_size, outer.layout.frame_size);
+    EXPECT_EQ(flat_ast.layout(flat_inner).frame_size, inner.layout.frame_size);
+
+    // The captured local is reached through the upvalue of the nested function.
+    using enum VariableSlot::Storage;
+    const FlatAst::Index d = findNode(flat_ast, FlatAst::Kind::VARIABLE, "d");
+    EXPECT_EQ(flat_ast.slots[d].storage, UPVALUE);
+    EXPECT_EQ(flat_ast.slots[d].index, 1u);
+    const FlatAst::Index c = findNode(flat_ast, FlatAst::Kind::ASSIGN, "c");
+    EXPECT_EQ(flat_ast.slots[c].storage, FRAME);
+    EXPECT_EQ(flat_ast.slots[c].index, 2u);
+}
+
+TEST(FlatAstTests, TokensFromSourceOffsets)
+{
+    const std::string test_script = "var text = \"a\nb\";\nvar x = 12.5 >= -3;\nx--;";
+
+    Lexer lexer{test_script};
+    Parser parser{lexer.scanTokens()};
+    const auto ast = parser.parse();
+    const FlatAst flat_ast{test_script, ast.statements};
+
+    EXPECT_EQ(flat_ast.lexeme(findNode(flat_ast, FlatAst::Kind::STRING, "a\nb")), "a\nb");
+    EXPECT_NE(findNode(flat_ast, FlatAst::Kind::NUMBER, "12.5"), FlatAst::NONE);
+    EXPECT_NE(findNode(flat_ast, FlatAst::Kind::BINARY, ">="), FlatAst::NONE);
+    EXPECT_NE(findNode(flat_ast, FlatAst::Kind::UNARY, "-"), FlatAst::NONE);
+
+    const Token token = flat_ast.token(findNode(flat_ast, FlatAst::Kind::POSTFIX_DECREMENT, "x"));
+    EXPECT_EQ(token.lexeme, "x");
+    EXPECT_EQ(token.type, TokenType::IDENTIFIER);
+    EXPECT_EQ(token.line, 4u);
+}
@@ -0,0 +1,114 @@
+#include "../include/Heap.hpp"
+#include "../include/ListType.hpp"
+#include "../include/StringType.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(HeapTests, CollectsUnreachableCycles)
+{
+    std::vector<Value> roots;
+    Heap heap{[&roots](Heap& heap)
+              {
+                  for (const auto& root : roots)
+                  {
+                      heap.mark(root);
+                  }
+              }};
+
+    // Two lists referring to each other, kept reachable only while they are linked.
+    roots.push_back(heap.allocate<List>());
+    roots.push_back(heap.allocate<List>());
+    roots[0].as<List>()->append(roots[1]);
+    roots[1].as<List>()->append(roots[0]);
+    roots.clear();
+
+    roots.push_back(heap.allocate<List>());
+    roots[0].as<List>()->append(heap.allocate<String>("kept"));
+
+    heap.collect();
+
+    const auto& statistics = heap.getStatistics();
+    EXPECT_EQ(statistics.objects_reclaimed, 2u);
+    EXPECT_GT(statistics.bytes_reclaimed, 0u);
+    EXPECT_EQ(roots[0].as<List>()->at(0).as<String>()->getValue(), "kept");
+}
+
+TEST(HeapTests, IgnoresObjectsItDoesNotOwn)
+{
+    Heap heap{[](Heap&) {}};
+
+    // A literal owned by the AST, stored in a list that becomes garbage.
+    String literal{"literal"};
+    Value list{heap.allocate<List>()};
+    list.as<List>()->append(&literal);
+
+    heap.collect();
+
+    EXPECT_EQ(heap.getStatistics().objects_reclaimed, 1u);
+    EXPECT_EQ(literal.getValue(), "literal");
+}
+
+TEST(HeapTests, PromotesSurvivorsOfMinorCollections)
+{
+    Value root;
+    Heap heap{[&root](Heap& heap) { heap.mark(root); }};
+
+    root = heap.allocate<List>();
+    heap.allocate<String>("garbage");
+
+    heap.collectNursery();
+
+    const auto& statistics = heap.getStatistics();
+    EXPECT_GE(statistics.minor_collections, 1u);
+    EXPECT_EQ(statistics.objects_promoted, 1u);
+    EXPECT_EQ(statistics.objects_reclaimed, 1u);
+}
+
+TEST(HeapTests, RemembersOldObjectsReferringToYoungOnes)
+{
+    Value root;
+    Heap heap{[&root](Heap& heap) { heap.mark(root); }};
+
+    root = heap.allocate<List>();
+    heap.collectNursery();
+
+    // The promoted list is only traced by a minor collection if the store was recorded.
+    auto list = root.as<List>();
+    list->append(heap.allocate<String>("young"));
+    heap.writeBarrier(list, list->at(0));
+
+    heap.collectNursery();
+
+    EXPECT_EQ(heap.getStatistics().objects_reclaimed, 0u);
+    EXPECT_EQ(list->at(0).as<String>()->getValue(), "young");
+}
+
+TEST(HeapTests, RopesKeepTheirOperandsUntilFlattened)
+{
+    std::vector<Value> roots;
+    Heap heap{[&roots](Heap& heap)
+              {
+                  for (const auto& root : roots)
+                  {
+                      heap.mark(root);
+                  }
+              }};
+
+    const std::string piece(String::MIN_ROPE_LENGTH, 'a');
+    roots.push_back(heap.allocate<String>(piece));
+    roots.push_back(heap.allocate<String>(roots[0].as<String>(), "b"));
+    roots.push_back(heap.allocate<String>(piece));
+    const Value rope = heap.allocate<String>(roots[1].as<String>(), roots[2].as<String>());
+    roots = {rope};
+
+    // Only the operands of the ropes can reach the other strings.
+    heap.collect();
+    EXPECT_EQ(heap.getStatistics().objects_reclaimed, 0u);
+
+    EXPECT_EQ(rope.as<String>()->length(), 2u * piece.size() + 1u);
+    EXPECT_EQ(rope.as<String>()->getValue(), piece + "b" + piece);
+
+    heap.collect();
+    EXPECT_EQ(heap.getStatistics().objects_reclaimed, 3u);
+    EXPECT_EQ(rope.as<String>()->getValue(), piece + "b" + piece);
+}
@@ -0,0 +1,334 @@
+#include "../include/Interpreter.hpp"
+#include "../include/Lexer.hpp"
+#include "../include/Parser.hpp"
+#include "../include/Resolver.hpp"
+#include "../include/StringTable.hpp"
+
+#include <gtest/gtest.h>
+
+std::string interpret(const std::string& test_script, bool lazy_functions = false)
+{
+    Lexer lexer{test_script};
+    Parser parser{lexer, lazy_functions};
+    const auto ast = parser.parse();
+    const auto& statements = ast.statements;
+
+    Resolver resolver;
+    resolver.resolve(statements);
+
+    Interpreter interpreter;
+    testing::internal::CaptureStdout();
+    interpreter.interpret(statements);
+    return testing::internal::GetCapturedStdout();
+}
+
+TEST(InterpreterTests, Arithmetic)
+{
+    const auto test_script = R"(
+        print(1 + 2, 3 - 4, 2 * 3, 7 / 2, -5);
+        print(1 < 2, 2 <= 2, 3 > 4, 4 >= 5);
+    )";
+
+    EXPECT_EQ(interpret(test_script), "3 -1 6 3.5 -5 \ntrue true false false \n");
+}
+
+TEST(InterpreterTests, Equality)
+{
+    const auto test_script = R"(
+        print(1 == 1, 1 == "1", nil == nil, nil == false, true != false);
+        print("str" == "str", "str" == "stru");
+    )";
+
+    EXPECT_EQ(interpret(test_script), "true false true false true \ntrue false \n");
+}
+
+TEST(InterpreterTests, StringEquality)
+{
+    // Literals are interned, strings built at runtime aren't, and both compare by content.
+    const auto test_script = R"(
+        var built = "a" + "b";
+        print(built == "ab", "ab" == built, built == "a" + "b", built == "ba", "ab" == "ab");
+    )";
+
+    EXPECT_EQ(interpret(test_script), "true true true false true \n");
+}
+
+TEST(InterpreterTests, StringConcatenation)
+{
+    const auto test_script = R"(
+        var s = "a" + "b";
+        print(s, 1 + s, s + 2.5);
+    )";
+
+    EXPECT_EQ(interpret(test_script), "ab 1ab ab2.5 \n");
+}
+
+TEST(InterpreterTests, NumberFormatting)
+{
+    const auto test_script = R"(
+        print(0, -0, -42, 2.5, 1 / 3, 0.1 + 0.2, 9007199254740993, 123456789 * 1000000000000);
+        print("n" + 1 / 4, -1.5 + "n");
+    )";
+
+    EXPECT_EQ(interpret(test_script), "0 -0 -42 2.5 0.3333333333333333 0.30000000000000004 "
+                                      "9007199254740992 1.23456789e+20 \nn0.25 -1.5n \n");
+}
+
+TEST(InterpreterTests, RepeatedConcatenation)
+{
+    // Long enough for the concatenations to create ropes, which are only flattened when compared
+    // or printed.
+    const auto test_script = R"(
+        var s = "";
+        var i = 0;
+        while (i < 40) {
+            s = s + "ab" + i;
+            i = i + 1;
+        }
+        var twice = s + s;
+        print(twice == s + s, twice == s, s);
+    )";
+
+    std::string expected;
+    for (int i = 0; i < 40; ++i)
+    {
+        expected += "ab" + std::to_string(i);
+    }
+    EXPECT_EQ(interpret(test_script), "true false " + expected + " \n");
+}
+
+TEST(InterpreterTests, RuntimeStringsAreNotInterned)
+{
+    const auto test_script = R"(
+        var s = "";
+        var i = 0;
+        while (i < 1000) {
+            s = "n" + i;
+            s = s + s;
+            i = i + 1;
+        }
+    )";
+
+    Lexer lexer{test_script};
+    Parser parser{lexer};
+    const auto ast = parser.parse();
+    Resolver resolver;
+    resolver.resolve(ast.statements);
+
+    // Only the literals and names of the script are interned, the strings it builds are left to
+    // the garbage collector.
+    const size_t interned = StringTable::size();
+    Interpreter interpreter;
+    interpreter.interpret(ast.statements);
+    EXPECT_EQ(StringTable::size(), interned);
+    EXPECT_FALSE(Error::hadRuntimeError);
+}
+
+TEST(InterpreterTests, ListsArePassedByReference)
+{
+    const auto test_script = R"(
+        fn modify(list) { list[0] = "changed"; list = nil; }
+        var list = [1, 2, 3];
+        modify(list);
+        print(list[0], list[-1]);
+    )";
+
+    EXPECT_EQ(interpret(test_script), "changed 3 \n");
+}
+
+TEST(InterpreterTests, Closures)
+{
+    const auto test_script = R"(
+        fn makeCounter() {
+            var count = 0;
+            fn counter() { return ++count; }
+            return counter;
+        }
+        var first = makeCounter();
+        var second = makeCounter();
+        print(first(), first(), second());
+    )";
+
+    EXPECT_EQ(interpret(test_script), "1 2 1 \n");
+}
+
+TEST(InterpreterTests, Scopes)
+{
+    const auto test_script = R"(
+        var a = "global";
+        {
+            var a = "outer";
+            var b = "b";
+            {
+                var c = "c";
+                var a = "inner";
+                print(a, b, c);
+            }
+            print(a, b);
+        }
+        fn f(x) { var y = x + 1; { var z = y + 1; x = z; } return x; }
+        print(a, f(1));
+    )";
+
+    EXPECT_EQ(interpret(test_script), "inner b c \nouter b \nglobal 3 \n");
+}
+
+TEST(InterpreterTests, ControlFlow)
+{
+    const auto test_script = R"(
+        fn find(list, item) {
+            for (var i = 0; i < 10; i++) {
+                while (true) {
+                    if (list[i] == item) return i;
+                    break;
+                }
+                if (i == 1) continue;
+                elif (i == 3) print("three");
+            }
+            return nil;
+        }
+        print(find([1, 2, 3, 4, 5], 5), find([1, 2], 2));
+        var n = 0;
+        while (n < 5) { n++; if (n == 2) continue; { if (n == 4) break; } print(n); }
+    )";
+
+    EXPECT_EQ(interpret(test_script), "three \n4 1 \n1 \n3 \n");
+}
+
+TEST(InterpreterTests, CapturedScopes)
+{
+    const auto test_script = R"(
+        fn outer(a) {
+            fn middle(b) {
+                var m = b * 2;
+                fn inner(c) { return a + c; }
+                return inner(m);
+            }
+            return middle(a);
+        }
+        fn fact(n) {
+            fn go(k) { if (k <= 1) return 1; return k * go(k - 1); }
+            return go(n);
+        }
+        print(outer(3), fact(5));
+        {
+            { var s = 1; print(s); }
+            { var r = 2; fn show() { return r; } print(show()); }
+        }
+    )";
+
+    EXPECT_EQ(interpret(test_script), "9 120 \n1 \n2 \n");
+}
+
+TEST(InterpreterTests, Upvalues)
+{
+    const auto test_script = R"(
+        fn deep(n) { if (n == 0) return 0; return deep(n - 1); }
+        fn makePair() {
+            var shared = 0;
+            fn increment() { shared++; }
+            fn get() { return shared; }
+            // The call stack grows while the upvalues are open.
+            deep(500);
+            increment();
+            return [increment, get];
+        }
+        var pair = makePair();
+        pair[0]();
+        print(pair[1]());
+    )";
+
+    EXPECT_EQ(interpret(test_script), "2 \n");
+}
+
+TEST(InterpreterTests, LazyFunctionBodies)
+{
+    const auto test_script = R"(
+        var base = 100;
+        fn unused() { this is { not valid } syntax; }
+        fn counter(start) {
+            var count = start;
+            fn next() { count++; return count; }
+            return next;
+        }
+        fn fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+        fn braces() { return "} {" + base; }
+        var next = counter(fib(10));
+        next();
+        print(next(), braces());
+    )";
+
+    // The bodies are parsed on the first call, the one of the uncalled function never is.
+    EXPECT_EQ(interpret(test_script, true), "57 } {100 \n");
+    EXPECT_FALSE(Error::hadError);
+}
+
+TEST(InterpreterTests, ErrorsInUncalledFunctions)
+{
+    const auto test_script = R"(
+        fn unused() { break; }
+        print("ran");
+    )";
+
+    // A lazily parsed body, the default of the tree-walking interpreter, is only checked when it
+    // is called.
+    EXPECT_EQ(interpret(test_script, true), "ran \n");
+    EXPECT_FALSE(Error::hadError);
+
+    // Parsed up front, as with --strict-parse, the error is reported although the function is
+    // never called.
+    interpret(test_script);
+    EXPECT_TRUE(Error::hadError);
+    ASSERT_EQ(Error::exceptionList.size(), 1u);
+    EXPECT_EQ(Error::exceptionList[0].message, "Can't break outside of a loop.");
+
+    Error::exceptionList.clear();
+    Error::hadError = false;
+}
+
+TEST(InterpreterTests, LazyFunctionBodyErrors)
+{
+    const auto test_script = R"(
+        fn broken() { var a = ; }
+        print("before");
+        broken();
+        print("after");
+    )";
+
+    // The syntax error is found when the function is first called, which stops the program
+    // without a runtime error of its own.
+    EXPECT_EQ(interpret(test_script, true), "before \n");
+    EXPECT_TRUE(Error::hadError);
+    EXPECT_FALSE(Error::hadRuntimeError);
+    ASSERT_EQ(Error::exceptionList.size(), 1u);
+    EXPECT_EQ(Error::exceptionList[0].line, 2u);
+    EXPECT_EQ(Error::exceptionList[0].message, "Expect expression.");
+
+    Error::exceptionList.clear();
+    Error::hadError = false;
+}
+
+TEST(InterpreterTests, LazyFunctionBodyLexerErrors)
+{
+    const auto test_script = R"(
+        fn broken() { var a = 1; # }
+        print("before");
+        broken();
+    )";
+
+    // Skipping the body doesn't report the unexpected character, lexing it on the call does.
+    Lexer lexer{test_script};
+    Parser parser{lexer, true};
+    const auto ast = parser.parse();
+    EXPECT_FALSE(Error::hadError);
+    EXPECT_TRUE(Error::exceptionList.empty());
+
+    EXPECT_EQ(interpret(test_script, true), "before \n");
+    EXPECT_TRUE(Error::hadError);
+    ASSERT_EQ(Error::exceptionList.size(), 1u);
+    EXPECT_EQ(Error::exceptionList[0].line, 2u);
+    EXPECT_EQ(Error::exceptionList[0].message, "Unexpected character: '#'.");
+
+    Error::exceptionList.clear();
+    Error::hadError = false;
+}
@@ -32,6 +32,7 @@ TEST(LexerTests, KEYWORDS)
     const std::vector<std::string> keywords{
         "and", "if",    "true",   "while", "return", "var", "or",    "else", "fn",
         "nil", "super", "lambda", "class", "false",  "for", "print", "this", "break",
+        "elif", "continue",
     };
     const std::unordered_map<std::string, TokenType> tokentypes{
         {"and", TokenType::AND},       {"or", TokenType::OR},         {"class", TokenType::CLASS},
@@ -39,7 +40,8 @@ TEST(LexerTests, KEYWORDS)
         {"true", TokenType::_TRUE},    {"fn", TokenType::FN},         {"for", TokenType::FOR},
         {"while", TokenType::WHILE},   {"nil", TokenType::NIL},       {"print", TokenType::PRINT},
         {"return", TokenType::RETURN}, {"super", TokenType::SUPER},   {"this", TokenType::THIS},
-        {"var", TokenType::VAR},       {"lambda", TokenType::LAMBDA}, {"break", TokenType::BREAK}};
+        {"var", TokenType::VAR},       {"lambda", TokenType::LAMBDA}, {"break", TokenType::BREAK},
+        {"elif", TokenType::ELIF},     {"continue", TokenType::CONTINUE}};
 
     std::string test_script;
     for (auto& keyword : keywords)
@@ -138,4 +140,55 @@ TEST(LexerTests, EXPRESSION)
     /* clang-format on */
 
     checkTokensEqual(expected_tokens, tokens);
-}
\ No newline at end of file
+}
+
+TEST(LexerTests, LEXEMES_VIEW_SOURCE)
+{
+    const std::string test_script = R"(var name = "text";)";
+    Lexer lexer{test_script};
+    const auto tokens = lexer.scanTokens();
+
+    // Lexemes point into the source instead of copying it, strings without their quotes.
+    ASSERT_EQ(tokens.size(), 6u);
+    EXPECT_EQ(tokens[1].lexeme.data(), test_script.data() + 4);
+    EXPECT_EQ(tokens[3].lexeme, "text");
+    EXPECT_EQ(tokens[3].lexeme.data(), test_script.data() + tokens[3].offset + 1);
+}
+
+TEST(LexerTests, LONG_RUNS)
+{
+    // Runs spanning several vectors, the last one ending with the source.
+    const std::string identifier = "Some_long_identifier_0123456789_" + std::string(40, 'x');
+    const std::string number = std::string(37, '7') + "." + std::string(35, '3');
+    const std::string text = std::string(50, 'a') + "\n\n" + std::string(20, 'b');
+    const std::string test_script =
+        std::string(45, ' ') + "\n\n\t\r\n" + identifier + "\n" + "// " + std::string(70, '-') +
+        " \"not a string\"\n" + number + std::string(33, '\n') + "\"" + text + "\"" + identifier;
+    Lexer lexer{test_script};
+    const auto tokens = lexer.scanTokens();
+
+    const std::vector<Token> expected_tokens{
+        {TokenType::IDENTIFIER, identifier, 4},
+        {TokenType::NUMBER, number, 6},
+        {TokenType::STRING, text, 41},
+        {TokenType::IDENTIFIER, identifier, 41},
+        {TokenType::_EOF, "", 41},
+    };
+    checkTokensEqual(expected_tokens, tokens);
+}
+
+TEST(LexerTests, NEAR_KEYWORDS)
+{
+    // Identifiers sharing the length, or the first and last characters, of a keyword.
+    const std::string test_script =
+        "an ande fo fox fnn elf elsif Print whilee nul thus vat lambdas continued breaks o _";
+    Lexer lexer{test_script};
+    auto tokens = lexer.scanTokens();
+
+    tokens.pop_back(); // remove EOF token
+    ASSERT_EQ(tokens.size(), 17u);
+    for (const Token& token : tokens)
+    {
+        EXPECT_EQ(token.type, TokenType::IDENTIFIER) << token.lexeme;
+    }
+}
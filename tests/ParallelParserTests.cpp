@@ -0,0 +1,91 @@
+#include "../include/AstPrinter.hpp"
+#include "../include/FlatAst.hpp"
+#include "../include/Lexer.hpp"
+#include "../include/ParallelParser.hpp"
+#include "../include/Parser.hpp"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+    const std::string test_script = R"(var a = 1;
+fn f(x) {
+    var b = x; // var c = 2;
+    if (b) { return "}; var d = 3;"; }
+    return b;
+}
+for (var i = 0; i < 2; i++) { var e = i; }
+var list = [f(1), (2)];
+{ var g = list; }
+while (a < 3) a++;
+if (a) print(a); else print("no");
+print(f(2));
+)";
+
+    std::vector<std::string> collectErrors()
+    {
+        std::vector<std::string> errors;
+        for (const auto& error : Error::exceptionList)
+        {
+            errors.push_back(std::to_string(error.line) + error.where + error.message);
+        }
+        Error::exceptionList.clear();
+        Error::hadError = false;
+        return errors;
+    }
+}
+
+TEST(ParallelParserTests, SplitsBeforeTopLevelStatements)
+{
+    // With chunks of a single byte, the script is cut before every top-level statement starting
+    // with a keyword that can't continue the previous one.
+    const auto chunks = ParallelParser::split(test_script, 1u);
+
+    std::vector<std::string_view> starts;
+    for (const auto& chunk : chunks)
+    {
+        const std::string_view text{test_script.data() + chunk.begin, chunk.end - chunk.begin};
+        starts.push_back(text.substr(0u, text.find_first_of(" (")));
+    }
+    EXPECT_EQ(starts, (std::vector<std::string_view>{"var", "fn", "for", "var", "while", "if"}));
+
+    ASSERT_EQ(chunks.size(), 6u);
+    EXPECT_EQ(chunks[0].begin, 0u);
+    EXPECT_EQ(chunks[1].line, 2u);
+    EXPECT_EQ(chunks[2].line, 7u);
+    EXPECT_EQ(chunks.back().line, 11u);
+    EXPECT_EQ(chunks.back().end, test_script.size());
+    for (size_t i = 1u; i < chunks.size(); ++i)
+    {
+        EXPECT_EQ(chunks[i].begin, chunks[i - 1u].end);
+    }
+}
+
+TEST(ParallelParserTests, ParsesLikeASingleThread)
+{
+    Lexer lexer{test_script};
+    Parser parser{lexer};
+    const auto serial = parser.parse();
+    const auto parallel = ParallelParser{4u, 1u}.parse(test_script);
+
+    ASSERT_FALSE(Error::hadError);
+    EXPECT_EQ(AstPrinter{}.print(FlatAst{test_script, parallel.statements}),
+              AstPrinter{}.print(FlatAst{test_script, serial.statements}));
+}
+
+TEST(ParallelParserTests, ReportsErrorsInSourceOrder)
+{
+    const std::string script = "var a = ;\nvar b = 1;\nfn f( {}\nvar c = @;\nprint(a;\n";
+
+    Lexer lexer{script};
+    Parser parser{lexer};
+    const auto serial = parser.parse();
+    const auto serial_errors = collectErrors();
+
+    const auto parallel = ParallelParser{3u, 1u}.parse(script);
+    EXPECT_TRUE(Error::hadError);
+    const auto parallel_errors = collectErrors();
+
+    EXPECT_EQ(parallel_errors.size(), 5u);
+    EXPECT_EQ(parallel_errors, serial_errors);
+}
@@ -1,9 +1,13 @@
+#include "../include/AstPrinter.hpp"
+#include "../include/FlatAst.hpp"
 #include "../include/Lexer.hpp"
 #include "../include/Parser.hpp"
+#include "../include/StringType.hpp"
 
 #include <gtest/gtest.h>
 
-std::vector<unique_stmt_ptr> initParser(const std::string& test_script)
+// The tokens refer to the script, which outlives the returned AST.
+Ast initParser(std::string_view test_script)
 {
     Lexer lexer{test_script};
     Parser parser{lexer.scanTokens()};
@@ -16,7 +20,8 @@ TEST(ParserTests, Expression)
         2 + 2 == 4;
     )";
 
-    const auto statements = initParser(test_script);
+    const auto ast = initParser(test_script);
+    const auto& statements = ast.statements;
     ASSERT_EQ(1, statements.size());
     auto expr_stmt = dynamic_cast<ExprStmt*>(statements[0].get());
 
@@ -50,7 +55,8 @@ TEST(ParserTests, Associativity)
     -2 * 2 + 2 * 2 > 2 == true;
     )";
 
-    const auto statements = initParser(test_script);
+    const auto ast = initParser(test_script);
+    const auto& statements = ast.statements;
 
     auto expr_stmt = dynamic_cast<ExprStmt*>(statements.at(0).get());
     ASSERT_TRUE(expr_stmt);
@@ -85,12 +91,12 @@ TEST(ParserTests, Associativity)
     // Child of '- unary' node => 2, leaf node
     auto leaf = dynamic_cast<LiteralExpr*>(unary->right.get());
     ASSERT_TRUE(leaf);
-    EXPECT_EQ(std::any_cast<double>(leaf->literal), 2);
+    EXPECT_EQ(leaf->literal.asNumber(), 2);
 
     // Right child of '*' node => 2, leaf node
     auto right_child = dynamic_cast<LiteralExpr*>(binary_multiply_left->right.get());
     ASSERT_TRUE(right_child);
-    EXPECT_EQ(std::any_cast<double>(right_child->literal), 2);
+    EXPECT_EQ(right_child->literal.asNumber(), 2);
 
     // Right child of '+' node => '*'
     auto binary_multiply_right = dynamic_cast<BinaryExpr*>(binary_add->right.get());
@@ -102,18 +108,18 @@ TEST(ParserTests, Associativity)
     right_child = dynamic_cast<LiteralExpr*>(binary_multiply_right->left.get());
     ASSERT_TRUE(left_child);
     ASSERT_TRUE(right_child);
-    EXPECT_EQ(std::any_cast<double>(left_child->literal), 2);
-    EXPECT_EQ(std::any_cast<double>(right_child->literal), 2);
+    EXPECT_EQ(left_child->literal.asNumber(), 2);
+    EXPECT_EQ(right_child->literal.asNumber(), 2);
 
     // Right child of '>' node => 2, leaf node
     auto binary_greater_right = dynamic_cast<LiteralExpr*>(binary_greater->right.get());
     ASSERT_TRUE(binary_greater_right);
-    EXPECT_EQ(std::any_cast<double>(binary_greater_right->literal), 2);
+    EXPECT_EQ(binary_greater_right->literal.asNumber(), 2);
 
     // Right child of root '=' node => true
     auto literal_true = dynamic_cast<LiteralExpr*>(binary_equal->right.get());
     ASSERT_TRUE(literal_true);
-    EXPECT_TRUE(std::any_cast<bool>(literal_true->literal));
+    EXPECT_TRUE(literal_true->literal.asBool());
 }
 
 TEST(ParserTests, FunctionDeclaration)
@@ -122,7 +128,8 @@ TEST(ParserTests, FunctionDeclaration)
         fn foo(first, second) { return first + second; }
     )";
 
-    const auto statements = initParser(test_script);
+    const auto ast = initParser(test_script);
+    const auto& statements = ast.statements;
     ASSERT_EQ(statements.size(), 1);
 
     auto fn_stmt = dynamic_cast<FnStmt*>(statements.at(0).get());
@@ -164,7 +171,8 @@ TEST(ParserTests, VariableDeclaration)
         var z = y;
     )";
 
-    const auto statements = initParser(test_script);
+    const auto ast = initParser(test_script);
+    const auto& statements = ast.statements;
     ASSERT_EQ(statements.size(), 3);
 
     const auto x = dynamic_cast<VarStmt*>(statements.at(0).get());
@@ -191,7 +199,7 @@ TEST(ParserTests, VariableDeclaration)
     ASSERT_TRUE(z_assign_val);
 
     // var x = 10;
-    EXPECT_EQ(std::any_cast<double>(x_assign_val->literal), 10);
+    EXPECT_EQ(x_assign_val->literal.asNumber(), 10);
 
     // var y = true == false;
     EXPECT_EQ(y_assign_val->op.type, TokenType::EQUAL_EQUAL);
@@ -199,8 +207,8 @@ TEST(ParserTests, VariableDeclaration)
     const auto right = dynamic_cast<LiteralExpr*>(y_assign_val->right.get());
     ASSERT_TRUE(left);
     ASSERT_TRUE(right);
-    EXPECT_TRUE(std::any_cast<bool>(left->literal));
-    EXPECT_FALSE(std::any_cast<bool>(right->literal));
+    EXPECT_TRUE(left->literal.asBool());
+    EXPECT_FALSE(right->literal.asBool());
 
     // var z = y;
     const auto var_expr = dynamic_cast<VarExpr*>(z->initializer.get());
@@ -220,7 +228,8 @@ TEST(ParserTests, IfStatement)
         }
     )";
 
-    const auto statements = initParser(test_script);
+    const auto ast = initParser(test_script);
+    const auto& statements = ast.statements;
     ASSERT_EQ(statements.size(), 1);
 
     const auto if_stmt = dynamic_cast<IfStmt*>(statements.at(0).get());
@@ -232,13 +241,13 @@ TEST(ParserTests, IfStatement)
     ASSERT_TRUE(main_condition);
     ASSERT_TRUE(main_statement);
 
-    EXPECT_FALSE(std::any_cast<bool>(main_condition->literal));
+    EXPECT_FALSE(main_condition->literal.asBool());
     EXPECT_EQ(main_statement->statements.size(), 1);
 
     const auto main_block_stmt = dynamic_cast<ExprStmt*>(main_statement->statements.at(0).get());
     ASSERT_TRUE(main_block_stmt);
-    EXPECT_FALSE(std::any_cast<bool>(
-        dynamic_cast<LiteralExpr*>(main_block_stmt->expression.get())->literal));
+    EXPECT_FALSE(
+        dynamic_cast<LiteralExpr*>(main_block_stmt->expression.get())->literal.asBool());
 
     // Elif
     const auto elif_branch = std::move(if_stmt->elif_branches.at(0));
@@ -254,12 +263,12 @@ TEST(ParserTests, IfStatement)
     // .. true
     const auto left = dynamic_cast<LiteralExpr*>(elif_condition->left.get());
     ASSERT_TRUE(left);
-    ASSERT_TRUE(std::any_cast<bool>(left->literal));
+    ASSERT_TRUE(left->literal.asBool());
 
     // .. false
     const auto right = dynamic_cast<LiteralExpr*>(elif_condition->right.get());
     ASSERT_TRUE(right);
-    ASSERT_TRUE(std::any_cast<bool>(right->literal));
+    ASSERT_TRUE(right->literal.asBool());
 
     // elif block => true;
     const auto elif_block = dynamic_cast<BlockStmt*>(elif_branch.statement.get());
@@ -269,8 +278,8 @@ TEST(ParserTests, IfStatement)
 
     const auto elif_block_stmt = dynamic_cast<ExprStmt*>(elif_block->statements.at(0).get());
     ASSERT_TRUE(elif_block_stmt);
-    EXPECT_TRUE(std::any_cast<bool>(
-        dynamic_cast<LiteralExpr*>(elif_block_stmt->expression.get())->literal));
+    EXPECT_TRUE(
+        dynamic_cast<LiteralExpr*>(elif_block_stmt->expression.get())->literal.asBool());
 
     // else branch
     const auto else_branch = std::move(if_stmt->else_branch);
@@ -285,8 +294,8 @@ TEST(ParserTests, IfStatement)
     // .. false
     const auto else_block_stmt = dynamic_cast<ExprStmt*>(else_block->statements.at(0).get());
     ASSERT_TRUE(else_block_stmt);
-    EXPECT_FALSE(std::any_cast<bool>(
-        dynamic_cast<LiteralExpr*>(else_block_stmt->expression.get())->literal));
+    EXPECT_FALSE(
+        dynamic_cast<LiteralExpr*>(else_block_stmt->expression.get())->literal.asBool());
 }
 
 TEST(ParserTests, ForStatement)
@@ -297,7 +306,8 @@ TEST(ParserTests, ForStatement)
         }
     )";
 
-    const auto statements = initParser(test_script);
+    const auto ast = initParser(test_script);
+    const auto& statements = ast.statements;
     ASSERT_EQ(statements.size(), 1);
 
     auto stmt = dynamic_cast<ForStmt*>(statements.at(0).get());
@@ -313,8 +323,8 @@ TEST(ParserTests, ForStatement)
     EXPECT_EQ(initializer->identifier.type, TokenType::IDENTIFIER);
     auto initializer_init = dynamic_cast<LiteralExpr*>(initializer->initializer.get());
     ASSERT_TRUE(initializer->initializer && initializer_init &&
-                initializer_init->literal.type() == typeid(double));
-    EXPECT_EQ(std::any_cast<double>(initializer_init->literal), 0);
+                initializer_init->literal.isNumber());
+    EXPECT_EQ(initializer_init->literal.asNumber(), 0);
 
     // condition
     // i < 10;
@@ -324,8 +334,8 @@ TEST(ParserTests, ForStatement)
     auto right = dynamic_cast<LiteralExpr*>(condition->right.get());
     ASSERT_TRUE(left && right);
     EXPECT_EQ(left->identifier.type, TokenType::IDENTIFIER);
-    ASSERT_EQ(right->literal.type(), typeid(double));
-    EXPECT_EQ(std::any_cast<double>(right->literal), 10);
+    ASSERT_TRUE(right->literal.isNumber());
+    EXPECT_EQ(right->literal.asNumber(), 10);
 
     // increment
     // i++
@@ -342,8 +352,8 @@ TEST(ParserTests, ForStatement)
     ASSERT_TRUE(block_stmt);
     auto literal = dynamic_cast<LiteralExpr*>(block_stmt->expression.get());
     ASSERT_TRUE(literal);
-    ASSERT_EQ(literal->literal.type(), typeid(bool));
-    EXPECT_FALSE(std::any_cast<bool>(literal->literal));
+    ASSERT_TRUE(literal->literal.isBool());
+    EXPECT_FALSE(literal->literal.asBool());
 }
 
 TEST(ParserTests, WhileStatement)
@@ -352,7 +362,8 @@ TEST(ParserTests, WhileStatement)
         while (x < 10) { x++; }
     )";
 
-    const auto statements = initParser(test_script);
+    const auto ast = initParser(test_script);
+    const auto& statements = ast.statements;
     ASSERT_EQ(statements.size(), 1);
 
     auto stmt = dynamic_cast<WhileStmt*>(statements.at(0).get());
@@ -367,8 +378,8 @@ TEST(ParserTests, WhileStatement)
     ASSERT_TRUE(left && right);
     EXPECT_EQ(left->identifier.type, TokenType::IDENTIFIER);
     EXPECT_EQ(left->identifier.lexeme, "x");
-    ASSERT_EQ(right->literal.type(), typeid(double));
-    EXPECT_EQ(std::any_cast<double>(right->literal), 10);
+    ASSERT_TRUE(right->literal.isNumber());
+    EXPECT_EQ(right->literal.asNumber(), 10);
 
     // Body
     ASSERT_TRUE(body);
@@ -382,7 +393,7 @@ TEST(ParserTests, WhileStatement)
     EXPECT_EQ(increment->type, IncrementExpr::Type::POSTFIX);
 }
 
-bool checkListValue(const std::any& item)
+bool checkListValue(const Value& item)
 {
     return false;
 }
@@ -393,7 +404,8 @@ TEST(ParserTests, List)
         var a = [1, "string", false, clock()];
     )";
 
-    const auto statements = initParser(test_script);
+    const auto ast = initParser(test_script);
+    const auto& statements = ast.statements;
     ASSERT_EQ(statements.size(), 1);
 
     auto var = dynamic_cast<VarStmt*>(statements.at(0).get());
@@ -408,19 +420,19 @@ TEST(ParserTests, List)
     {
         if (auto expr = dynamic_cast<LiteralExpr*>(item.get()))
         {
-            if (expr->literal.type() == typeid(bool))
+            if (expr->literal.isBool())
             {
-                EXPECT_FALSE(std::any_cast<bool>(expr->literal));
+                EXPECT_FALSE(expr->literal.asBool());
             }
 
-            else if (expr->literal.type() == typeid(double))
+            else if (expr->literal.isNumber())
             {
-                EXPECT_DOUBLE_EQ(std::any_cast<double>(expr->literal), 1);
+                EXPECT_DOUBLE_EQ(expr->literal.asNumber(), 1);
             }
 
-            else if (expr->literal.type() == typeid(std::string))
+            else if (expr->literal.isString())
             {
-                EXPECT_EQ(std::any_cast<std::string>(expr->literal), "string");
+                EXPECT_EQ(expr->literal.as<String>()->getValue(), "string");
             }
         }
         else if (auto call = dynamic_cast<CallExpr*>(item.get()))
@@ -436,4 +448,90 @@ TEST(ParserTests, List)
             EXPECT_ANY_THROW("list items dont match with expected values.");
         }
     }
-}
\ No newline at end of file
+}
+
+TEST(ParserTests, PullsTokensFromLexer)
+{
+    const std::string test_script = R"(
+        fn fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); } // comment
+        var list = ["a", 1.5, nil];
+        for (var i = 0; i < 3; i++) { while (true) { list[i] = -i; break; } }
+        print(fib(10));
+    )";
+
+    // Pulling tokens one at a time builds the same tree as scanning all of them first.
+    Lexer lexer{test_script};
+    Parser parser{lexer};
+    const auto pulled = parser.parse();
+    const auto scanned = initParser(test_script);
+
+    ASSERT_EQ(pulled.statements.size(), 4u);
+    EXPECT_EQ(AstPrinter{}.print(FlatAst{test_script, pulled.statements}),
+              AstPrinter{}.print(FlatAst{test_script, scanned.statements}));
+}
+
+TEST(ParserTests, SkipsTopLevelFunctionBodies)
+{
+    const std::string test_script = "fn outer(a) {\n    { fn inner() { return \"}\"; } }\n}\n"
+                                    "{ fn nested() { return 1; } }";
+
+    Lexer lexer{test_script};
+    Parser parser{lexer, true};
+    const auto ast = parser.parse();
+    ASSERT_EQ(ast.statements.size(), 2u);
+
+    // Only the braces of a top-level function's body are matched, its range is kept for later.
+    const auto& outer = dynamic_cast<const FnStmt&>(*ast.statements[0]);
+    ASSERT_TRUE(outer.lazy_body);
+    EXPECT_TRUE(outer.body.empty());
+    EXPECT_EQ(test_script.substr(outer.lazy_body->begin,
+                                 outer.lazy_body->end - outer.lazy_body->begin),
+              "\n    { fn inner() { return \"}\"; } }\n");
+    EXPECT_EQ(outer.lazy_body->line, 1u);
+
+    // Functions in blocks can capture the block's variables, they are parsed right away.
+    const auto& block = dynamic_cast<const BlockStmt&>(*ast.statements[1]);
+    const auto& nested = dynamic_cast<const FnStmt&>(*block.statements[0]);
+    EXPECT_FALSE(nested.lazy_body);
+    EXPECT_EQ(nested.body.size(), 1u);
+}
+
+TEST(ParserTests, InternsStringLiterals)
+{
+    const auto ast = initParser(R"(print("same", "same", "other");)");
+    ASSERT_EQ(ast.statements.size(), 1u);
+
+    const auto& print = dynamic_cast<const PrintStmt&>(*ast.statements[0]);
+    const auto& call = dynamic_cast<const CallExpr&>(*print.expression);
+    ASSERT_EQ(call.args.size(), 3u);
+    const auto literal = [&call](size_t i) {
+        return dynamic_cast<const LiteralExpr&>(*call.args[i]).literal.as<String>();
+    };
+
+    // Every occurrence of a literal is the same string.
+    EXPECT_TRUE(literal(0)->isInterned());
+    EXPECT_EQ(literal(0), literal(1));
+    EXPECT_NE(literal(0), literal(2));
+    EXPECT_EQ(literal(0)->getValue(), "same");
+}
+
+TEST(ParserTests, ListsLiveInTheArena)
+{
+    const auto ast = initParser(R"(
+        fn f(a, b) { print([a, b]); }
+    )");
+    ASSERT_EQ(ast.statements.size(), 1u);
+
+    // Releasing the arena frees the lists of the nodes too, without running their destructors.
+    std::pmr::memory_resource* const arena = ast.arena->memoryResource();
+    const auto& function = dynamic_cast<const FnStmt&>(*ast.statements[0]);
+    const auto& print = dynamic_cast<const PrintStmt&>(*function.body[0]);
+    const auto& call = dynamic_cast<const CallExpr&>(*print.expression);
+    const auto& list = dynamic_cast<const ListExpr&>(*call.args[0]);
+    EXPECT_EQ(ast.statements.get_allocator().resource(), arena);
+    EXPECT_EQ(function.params.get_allocator().resource(), arena);
+    EXPECT_EQ(function.body.get_allocator().resource(), arena);
+    EXPECT_EQ(function.upvalues.get_allocator().resource(), arena);
+    EXPECT_EQ(call.args.get_allocator().resource(), arena);
+    EXPECT_EQ(list.items.get_allocator().resource(), arena);
+}
@@ -0,0 +1,98 @@
+#include "../include/Lexer.hpp"
+#include "../include/Parser.hpp"
+#include "../include/Resolver.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(ResolverTests, CapturedVariables)
+{
+    const auto test_script = R"(
+        fn outer(a, b) {
+            var c = a;
+            var d = b;
+            fn inner() { return b + d; }
+            return inner;
+        }
+    )";
+
+    Lexer lexer{test_script};
+    Parser parser{lexer.scanTokens()};
+    const auto ast = parser.parse();
+    const auto& statements = ast.statements;
+    Resolver resolver;
+    resolver.resolve(statements);
+
+    const auto& outer = dynamic_cast<const FnStmt&>(*statements[0]);
+    EXPECT_TRUE(outer.creates_closures);
+    EXPECT_TRUE(outer.layout.is_captured);
+    EXPECT_EQ(outer.layout.first_slot, 0u);
+    EXPECT_TRUE(outer.upvalues.empty());
+
+    // The declarations stay in the frame, the nested function captures only what it uses.
+    using enum VariableSlot::Storage;
+    EXPECT_EQ(dynamic_cast<const VarStmt&>(*outer.body[1]).slot.storage, FRAME);
+    EXPECT_EQ(dynamic_cast<const VarStmt&>(*outer.body[1]).slot.index, 3u);
+
+    const auto& inner = dynamic_cast<const FnStmt&>(*outer.body[2]);
+    EXPECT_FALSE(inner.creates_closures);
+    EXPECT_FALSE(inner.layout.is_captured);
+    EXPECT_EQ(inner.layout.frame_size, 0u);
+    EXPECT_EQ(inner.upvalues, (ast_vector<UpvalueSlot>{{true, 1u}, {true, 3u}}));
+
+    const auto& sum = dynamic_cast<const BinaryExpr&>(
+        *dynamic_cast<const ReturnStmt&>(*inner.body[0]).expression);
+    EXPECT_EQ(dynamic_cast<const VarExpr&>(*sum.left).slot.storage, UPVALUE);
+    EXPECT_EQ(dynamic_cast<const VarExpr&>(*sum.right).slot.index, 1u);
+}
+
+TEST(ResolverTests, NestedUpvalues)
+{
+    const auto test_script = R"(
+        fn outer(a) {
+            fn middle() {
+                fn inner() { return a; }
+                return a;
+            }
+        }
+    )";
+
+    Lexer lexer{test_script};
+    Parser parser{lexer.scanTokens()};
+    const auto ast = parser.parse();
+    const auto& statements = ast.statements;
+    Resolver resolver;
+    resolver.resolve(statements);
+
+    // The function in between captures the variable as well and passes its upvalue on.
+    const auto& outer = dynamic_cast<const FnStmt&>(*statements[0]);
+    const auto& middle = dynamic_cast<const FnStmt&>(*outer.body[0]);
+    const auto& inner = dynamic_cast<const FnStmt&>(*middle.body[0]);
+    EXPECT_EQ(middle.upvalues, (ast_vector<UpvalueSlot>{{true, 0u}}));
+    EXPECT_EQ(inner.upvalues, (ast_vector<UpvalueSlot>{{false, 0u}}));
+}
+
+TEST(ResolverTests, Statistics)
+{
+    const auto test_script = R"(
+        fn f(n) {
+            { var x = n; print(x); }
+            for (var i = 0; i < n; i++) {
+                var y = i;
+                fn g() { return y; }
+            }
+        }
+    )";
+
+    Lexer lexer{test_script};
+    Parser parser{lexer.scanTokens()};
+    Resolver resolver;
+    resolver.resolve(parser.parse().statements);
+
+    const auto& statistics = resolver.getStatistics();
+    EXPECT_EQ(statistics.locals, 5u);
+    EXPECT_EQ(statistics.captured_locals, 1u);
+    EXPECT_EQ(statistics.scopes, 5u);
+    EXPECT_EQ(statistics.captured_scopes, 1u);
+    EXPECT_EQ(statistics.functions, 2u);
+    EXPECT_EQ(statistics.closure_free_functions, 1u);
+}
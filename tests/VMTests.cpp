@@ -0,0 +1,209 @@
+#include "../include/Compiler.hpp"
+#include "../include/Lexer.hpp"
+#include "../include/Logger.hpp"
+#include "../include/Parser.hpp"
+#include "../include/Resolver.hpp"
+#include "../include/VM.hpp"
+
+#include <gtest/gtest.h>
+
+std::optional<CompiledProgram> compileScript(const std::string& test_script)
+{
+    Lexer lexer{test_script};
+    Parser parser{lexer.scanTokens()};
+    const auto ast = parser.parse();
+
+    Resolver resolver;
+    resolver.resolve(ast.statements);
+
+    Compiler compiler;
+    return compiler.compile(ast.statements);
+}
+
+// Sums the numbers 0.5 to `count` - 0.5, each one a distinct literal.
+std::string sumOfLiterals(size_t count)
+{
+    std::string script = "var sum = 0;\n";
+    for (size_t i = 0u; i < count; ++i)
+    {
+        script += "sum = sum + " + std::to_string(i) + ".5;\n";
+    }
+    return script;
+}
+
+std::string runOnVM(const std::string& test_script)
+{
+    const auto program = compileScript(test_script);
+    if (!program)
+    {
+        ADD_FAILURE() << "The script failed to compile.";
+        return {};
+    }
+
+    VM vm;
+    testing::internal::CaptureStdout();
+    vm.interpret(*program);
+    return testing::internal::GetCapturedStdout();
+}
+
+TEST(VMTests, Arithmetic)
+{
+    const auto test_script = R"(
+        print(1 + 2, 3 - 4, 2 * 3, 7 / 2, -5);
+        print(1 < 2, 2 <= 2, 3 > 4, 4 >= 5);
+        print("a" + "b", 1 + "b", "a" + 2.5);
+    )";
+
+    EXPECT_EQ(runOnVM(test_script), "3 -1 6 3.5 -5 \ntrue true false false \nab 1b a2.5 \n");
+}
+
+TEST(VMTests, RepeatedConcatenation)
+{
+    const auto test_script = R"(
+        var s = "";
+        for (var i = 0; i < 40; i = i + 1) {
+            s = i + s + "ab";
+        }
+        print(s == s + "", s);
+    )";
+
+    std::string expected;
+    for (int i = 0; i < 40; ++i)
+    {
+        expected = std::to_string(i) + expected + "ab";
+    }
+    EXPECT_EQ(runOnVM(test_script), "true " + expected + " \n");
+}
+
+TEST(VMTests, IncrementAndDecrement)
+{
+    const auto test_script = R"(
+        var n = 5;
+        print(n++, n, ++n, n--, --n, n);
+        fn f() { var m = 1; m++; return ++m; }
+        print(f());
+    )";
+
+    EXPECT_EQ(runOnVM(test_script), "5 6 7 7 5 5 \n3 \n");
+}
+
+TEST(VMTests, Lists)
+{
+    const auto test_script = R"(
+        fn modify(list) { list[0] = "changed"; list = nil; }
+        var list = [1, 2, 3];
+        modify(list);
+        print(list, list[-1]);
+    )";
+
+    EXPECT_EQ(runOnVM(test_script), "[ changed, 2, 3 ] 3 \n");
+}
+
+TEST(VMTests, ControlFlow)
+{
+    const auto test_script = R"(
+        for (var i = 0; i < 10; i++) {
+            var j = i * 2;
+            if (i == 1) continue;
+            elif (i == 4) break;
+            else print(j);
+        }
+        var k = 0;
+        while (true) { if (k++ == 2) break; print(k, nil or "or", 1 and 2); }
+    )";
+
+    EXPECT_EQ(runOnVM(test_script), "0 \n4 \n6 \n1 or 2 \n2 or 2 \n");
+}
+
+TEST(VMTests, Closures)
+{
+    const auto test_script = R"(
+        fn makeCounter() {
+            var count = 0;
+            fn counter() { return ++count; }
+            return counter;
+        }
+        var first = makeCounter();
+        var second = makeCounter();
+        print(first(), first(), second());
+
+        var fns = [nil, nil];
+        for (var i = 0; i < 2; i++) {
+            var captured = i;
+            fn f() { return captured + i; }
+            fns[i] = f;
+        }
+        print(fns[0](), fns[1]());
+    )";
+
+    EXPECT_EQ(runOnVM(test_script), "1 2 1 \n2 3 \n");
+}
+
+TEST(VMTests, Recursion)
+{
+    const auto test_script = R"(
+        fn fib(n) { if (n < 2) return n; return fib(n - 2) + fib(n - 1); }
+        {
+            fn fact(n) { if (n < 2) return 1; return n * fact(n - 1); }
+            print(fib(20), fact(10));
+        }
+    )";
+
+    EXPECT_EQ(runOnVM(test_script), "6765 3628800 \n");
+}
+
+TEST(VMTests, DeepRecursion)
+{
+    // Every call captures its local, which the closure updates after the deeper calls have grown
+    // the stack.
+    const auto test_script = R"(
+        fn sum(n) {
+            var total = n;
+            fn add(x) { total = total + x; }
+            if (n > 0) add(sum(n - 1));
+            return total;
+        }
+        print(sum(5000));
+    )";
+
+    EXPECT_EQ(runOnVM(test_script), "12502500 \n");
+}
+
+TEST(VMTests, RepeatedLiteralsShareConstants)
+{
+    const auto program = compileScript(R"(
+        var a = "text";
+        var b = "text";
+        print(a + b, 1 + 1 + 1, a == b);
+    )");
+    ASSERT_TRUE(program.has_value());
+
+    // "text" and 1.
+    const auto* script = program->script.as<CompiledFunction>();
+    EXPECT_EQ(script->chunk.constants.size(), 2u);
+}
+
+TEST(VMTests, WideConstants)
+{
+    // More literals than a 16-bit constant index can address.
+    const size_t count = 70000u;
+    const auto test_script =
+        sumOfLiterals(count) + "print(sum == " + std::to_string(count * count / 2u) + ");";
+
+    EXPECT_EQ(runOnVM(test_script), "true \n");
+    EXPECT_FALSE(Error::hadError);
+}
+
+TEST(VMTests, TooManyConstantsIsReportedOnce)
+{
+    // The functions are loaded by 16-bit constant indices, which the literals before them have
+    // used up.
+    const auto test_script = sumOfLiterals(70000u) + "fn first() {} fn second() {}";
+
+    EXPECT_FALSE(compileScript(test_script).has_value());
+    ASSERT_EQ(Error::exceptionList.size(), 1u);
+    EXPECT_EQ(Error::exceptionList[0].message, "Too many constants in one chunk.");
+
+    Error::exceptionList.clear();
+    Error::hadError = false;
+}
@@ -0,0 +1,60 @@
+#include "../../include/Lexer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// Lexes a generated script and reports the throughput of Lexer::scanTokens in MB/s, best of a few
+// runs. The size of the script in MB can be passed as the first argument, 50 by default.
+
+namespace
+{
+    constexpr size_t MEGABYTE = 1024u * 1024u;
+    constexpr int RUNS = 5;
+
+    // Functions with the usual mix of indentation, comments, identifiers, numbers and strings,
+    // repeated with different names up to `size` bytes.
+    std::string generateSource(size_t size)
+    {
+        std::string source;
+        source.reserve(size + 1024u);
+        for (size_t i = 0u; source.size() < size; ++i)
+        {
+            const std::string n = std::to_string(i);
+            source += "// Computes the next value of sequence number " + n + ".\n"
+                      "fn next_value_" + n + "(previous_value, step_size) {\n"
+                      "    var result = previous_value * 1.5 + step_size - " + n + ";\n"
+                      "    if (result >= 1000000 and step_size != 0) {\n"
+                      "        print(\"sequence " + n + " overflowed at\", result);\n"
+                      "        return nil;\n"
+                      "    }\n"
+                      "    for (var index = 0; index < 10; index++) { result = result / 2; }\n"
+                      "    return result;\n"
+                      "}\n\n";
+        }
+        return source;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t megabytes = argc > 1 ? std::stoul(argv[1]) : 50u;
+    const std::string source = generateSource(megabytes * MEGABYTE);
+
+    size_t tokens = 0u;
+    auto best = std::chrono::duration<double>::max();
+    for (int run = 0; run < RUNS; ++run)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        Lexer lexer{source};
+        tokens = lexer.scanTokens().size();
+        best = std::min<std::chrono::duration<double>>(best,
+                                                       std::chrono::steady_clock::now() - start);
+    }
+
+    const double size = static_cast<double>(source.size()) / MEGABYTE;
+    std::cout << "Lexed " << size << " MB into " << tokens << " tokens in " << best.count()
+              << " s: " << size / best.count() << " MB/s\n";
+    return 0;
+}